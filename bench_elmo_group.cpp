@@ -0,0 +1,106 @@
+//
+//  bench_elmo_group.cpp
+//  am2b
+//
+//  Compares the per-object unit conversion of ElmoGold (getPosition(),
+//  setDesiredPosition(), ...) with ElmoGroup. No bus is needed, the drives
+//  are not connected to a master.
+//
+//  Usage: bench_elmo_group --drives 24 --cycles 100000
+//
+//  Copyright 2015 Chair of Applied Mechanics, TUM
+//  https://www.amm.mw.tum.de/
+//
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <math.h>
+
+#include "AcEcFixedSlaveInstanceMapper.hpp"
+#include "BusSlave.hpp"
+#include "ElmoGold.hpp"
+#include "ElmoGroup.hpp"
+
+#include <xstdio.h>
+#include <progopt.hpp>
+
+using namespace std;
+using namespace am2b;
+using namespace ec;
+
+typedef ElmoGold<BusSlave<AcEcFixedSlaveInstanceMapper > > Drive;
+
+// ns per cycle of f, run cycles times
+template<class F>
+static double measure(unsigned int cycles, F f) {
+  auto start = chrono::steady_clock::now();
+  for (unsigned int c = 0; c < cycles; c++) {
+    f(c);
+  }
+  auto end = chrono::steady_clock::now();
+  return chrono::duration_cast<chrono::nanoseconds>(end - start).count() / (double) cycles;
+}
+
+// benchmark of the drive group conversion
+int main (int argc, char *argv[]) {
+
+  ProgOpt opt(argv[0], "benchmark of ElmoGold vs. ElmoGroup unit conversion.",
+              argc,argv);
+  opt.add(' ',"drives", false, "number of drives", "24");
+  opt.add(' ',"cycles", false, "number of control cycles", "100000");
+  opt.std_parse();
+
+  unsigned int numDrives  = opt.val<unsigned int>("drives");
+  unsigned int cycles     = opt.val<unsigned int>("cycles");
+
+  vector<unique_ptr<Drive> > drives;
+  ElmoGroup<BusSlave<AcEcFixedSlaveInstanceMapper > > group;
+  for (unsigned int i = 0; i < numDrives; i++) {
+    drives.emplace_back(new Drive(ElmoHomingType::ABS_ENCODER, 4000 + 1000*(i%3), 65535, 5000 + 100*i));
+    group.add(drives.back().get());
+  }
+
+  // keeps the compiler from dropping the loops
+  volatile double sink = 0.0;
+
+  double tObject = measure(cycles, [&](unsigned int c) {
+    double sum = 0.0;
+    for (auto& d : drives) {
+      double pos = d->getPosition();
+      sum += pos + d->getVelocity() + d->getCurrent() + d->getAbsPosition();
+      d->setDesiredPosition(pos + 1e-6*c);
+      d->setVelocityOffset(0.1);
+      d->setCurrentOffset(0.5);
+    }
+    sink = sink + sum;
+  });
+
+  double tGroup = measure(cycles, [&](unsigned int c) {
+    group.readInputs();
+    double sum = 0.0;
+    const double* pos = group.getPosition();
+    const double* vel = group.getVelocity();
+    const double* cur = group.getCurrent();
+    const double* abs = group.getAbsPosition();
+    double* desPos = group.desiredPosition();
+    double* velOffset = group.velocityOffset();
+    double* curOffset = group.currentOffset();
+    for (size_t i = 0; i < group.size(); i++) {
+      sum += pos[i] + vel[i] + cur[i] + abs[i];
+      desPos[i] = pos[i] + 1e-6*c;
+      velOffset[i] = 0.1;
+      curOffset[i] = 0.5;
+    }
+    group.writeOutputs();
+    sink = sink + sum;
+  });
+
+  pmsg("%u drives, %u cycles, %s kernels\n", numDrives, cycles, simdConvertName());
+  pmsg("per object: %8.1f ns/cycle\n", tObject);
+  pmsg("group:      %8.1f ns/cycle (%.2fx)\n", tGroup, tObject / tGroup);
+
+  return 0;
+}
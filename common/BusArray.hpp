@@ -12,12 +12,66 @@
 
 #include <mutex>
 #include <typeinfo>
+#include <array>
+#include <type_traits>
+#include <string.h>
+#if __cplusplus >= 202002L
+  #include <span>
+#endif
 
 #include "BusVarType.hpp"
 #include <xdebug.h>
 
 namespace ec {
 
+  /*! Locked view on the data of a BusArray (see BusArray::view()).
+      The array mutex is held until the view is destroyed, keep it short-lived.
+      U is const T for read-only views. */
+  template<typename U>
+  class BusArrayView {
+
+  public:
+
+    BusArrayView(std::timed_mutex& mutex, U* data, std::size_t size) : m_lock(mutex), m_data(data), m_size(size) {
+    }
+
+    //! Pointer to the first element
+    U* data() const {
+      return m_data;
+    }
+
+    //! Number of elements
+    std::size_t size() const {
+      return m_size;
+    }
+
+    U& operator[](std::size_t idx) const {
+      return m_data[idx];
+    }
+
+    U* begin() const {
+      return m_data;
+    }
+
+    U* end() const {
+      return m_data + m_size;
+    }
+
+  #if __cplusplus >= 202002L
+    //! The elements as std::span, valid while the view exists
+    std::span<U> span() const {
+      return std::span<U>(m_data, m_size);
+    }
+  #endif
+
+  private:
+
+    std::unique_lock<std::timed_mutex>  m_lock;
+    U*                                  m_data;
+    std::size_t                         m_size;
+
+  };
+
   /*! Provides interface for user data access to arrays on the bus.
       
       Implements locking and abstraction of low-level data exchange with the BusMaster.
@@ -31,6 +85,11 @@ namespace ec {
     const bool isArray() const {
       return true;
     }
+
+    /*! Returns the mutex to lock access to the data area */
+    std::timed_mutex& getMutex() {
+      return m_mutex;
+    }
   
     //! Constructor
     BusArray() {
@@ -49,23 +108,20 @@ namespace ec {
     }
   
     //! copy constructor
-    BusArray (const BusArray& other) {
+    BusArray (const BusArray& other) : BusArray() {
     
   #ifdef DEBUG
       // write not allowed on input
       XASSERT(this->isOutput());
   #endif
     
-      // scoped lock
-      std::lock_guard<std::timed_mutex> lock(this->m_mutex);
-    
-      // copy data 
-      other.copyTo(this->m_data, Size);
+      // copy data (this is not shared yet)
+      const_cast<BusArray&>(other).read(m_data, Size);
     
     }
   
     //! type based constructor (thread-safe)
-    BusArray(const T& value) {
+    BusArray(const T& value) : BusArray() {
     
   #ifdef DEBUG
       // write not allowed on input
@@ -95,12 +151,11 @@ namespace ec {
   #endif
     
       if (this != &other) {
-      
-        // scoped lock
-        std::lock_guard<std::timed_mutex> lock(this->m_mutex);
-    
-        // copy data
-        other.copyTo(this->m_data, Size);
+
+        // copy data, one lock at a time
+        T tmp[Size];
+        const_cast<BusArray&>(other).read(tmp, Size);
+        write(tmp, Size);
       
       }
     
@@ -146,25 +201,105 @@ namespace ec {
       this->m_data[idx] = value;
     }
   
-    /*! Copy data to given buffer (thread-safe) */
+    /*! Copy up to count elements to dest with one lock (thread-safe).
+        Returns the number of copied elements */
+    std::size_t read(T* dest, std::size_t count) {
+
+      std::size_t n = count < Size ? count : Size;
+
+      // scoped lock
+      std::lock_guard<std::timed_mutex> lock(this->m_mutex);
+      memcpy(dest, m_data, n * sizeof(T));
+      return n;
+    }
+
+    /*! Copy up to count elements from src with one lock (thread-safe).
+        Returns the number of copied elements */
+    std::size_t write(const T* src, std::size_t count) {
+
+  #ifdef DEBUG
+      // write not allowed on input
+      XASSERT(this->isOutput());
+  #endif
+
+      std::size_t n = count < Size ? count : Size;
+
+      // scoped lock
+      std::lock_guard<std::timed_mutex> lock(this->m_mutex);
+      memcpy(m_data, src, n * sizeof(T));
+      return n;
+    }
+
+    /*! Copy the whole array (thread-safe) */
+    void read(std::array<T, Size>& dest) {
+      read(dest.data(), Size);
+    }
+
+    /*! Set the whole array (thread-safe) */
+    void write(const std::array<T, Size>& src) {
+      write(src.data(), Size);
+    }
+
+  #if __cplusplus >= 202002L
+    /*! Copy up to dest.size() elements (thread-safe) */
+    std::size_t read(std::span<T> dest) {
+      return read(dest.data(), dest.size());
+    }
+
+    /*! Copy up to src.size() elements (thread-safe) */
+    std::size_t write(std::span<const T> src) {
+      return write(src.data(), src.size());
+    }
+  #endif
+
+    /*! Lock the array and access the elements in place.
+        The array stays locked (also for the job task) until the view is destroyed */
+    BusArrayView<T> view() {
+
+  #ifdef DEBUG
+      // write not allowed on input
+      XASSERT(this->isOutput());
+  #endif
+
+      return BusArrayView<T>(m_mutex, m_data, Size);
+    }
+
+    /*! Read-only variant of view() */
+    BusArrayView<const T> constView() {
+      return BusArrayView<const T>(m_mutex, m_data, Size);
+    }
+
+    /*! Copy data to given buffer (thread-safe).
+        Elements are converted to uint8_t, use read() for other types */
     void copyTo(uint8_t* dest, unsigned int size) {
-    
+
+      if (std::is_same<T, uint8_t>::value) {
+        read((T*) dest, size);
+        return;
+      }
+
       // scoped lock
       std::lock_guard<std::timed_mutex> lock(this->m_mutex);
     
-      int sizeMin = Size;
+      unsigned int sizeMin = Size;
       if (size < Size) {
         sizeMin = size;
       }
     
-      for (int i=0; i < sizeMin; i++) {
+      for (unsigned int i=0; i < sizeMin; i++) {
         dest[i] = m_data[i];
       }
     
     }
   
-    /*! Copy data from given buffer (thread-safe) */
+    /*! Copy data from given buffer (thread-safe).
+        Elements are converted from uint8_t, use write() for other types */
     void copyFrom(uint8_t* src, unsigned int size) {
+
+      if (std::is_same<T, uint8_t>::value) {
+        write((const T*) src, size);
+        return;
+      }
     
   #ifdef DEBUG
       // write not allowed on input
@@ -174,12 +309,12 @@ namespace ec {
       // scoped lock
       std::lock_guard<std::timed_mutex> lock(this->m_mutex);
     
-      int sizeMin = Size;
+      unsigned int sizeMin = Size;
       if (size < Size) {
         sizeMin = size;
       }
     
-      for (int i=0; i < sizeMin; i++) {
+      for (unsigned int i=0; i < sizeMin; i++) {
         m_data[i] = src[i];
       }
     
@@ -190,6 +325,9 @@ namespace ec {
     T     m_data[Size];
     std::size_t sz;
 
+    //! for thread safety (PDO data is accessed from within JobTask thread)
+    std::timed_mutex  m_mutex;
+
   };
 
 
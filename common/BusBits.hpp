@@ -0,0 +1,166 @@
+//
+//  BusBits.hpp
+//  am2b
+//
+//  Contiguous run of boolean PDO entries (digital I/O channels) as one
+//  packed word. Linked with linkPDOBits(), the job task copies all channels
+//  with a single masked EC_GETBITS / EC_SETBITS.
+//
+//  Copyright 2015 Chair of Applied Mechanics, TUM
+//  https://www.amm.mw.tum.de/
+//
+
+#ifndef BUSBITS_HPP_E25A0C87
+#define BUSBITS_HPP_E25A0C87
+
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <typeinfo>
+
+#include "BusVarType.hpp"
+#include "BusVarGroup.hpp"
+#include <xdebug.h>
+
+namespace ec {
+
+  /*! N boolean channels stored as bits 0..N-1 of a lock-free std::atomic<uint64_t>.
+      Bit i is the i-th variable name passed to linkPDOBits(). */
+  template<std::size_t N, class BusVarDirection>
+  class BusBits : public BusVarDirection {
+
+    static_assert(N > 0 && N <= 64, "BusBits supports 1 to 64 channels");
+
+  public:
+
+    //! Constructor
+    BusBits() {
+
+      m_ptr = &m_data;
+      this->m_dataPtr = (void*) m_ptr;
+      this->m_typeid = &typeid(BusBits);
+      this->m_lockFree = true;
+      m_ptr->store(0, std::memory_order_relaxed);
+    }
+
+    /*! Returns the size of the variable in bits */
+    const unsigned int getSize() const {
+      return N;
+    }
+
+    /*! Number of channels */
+    static constexpr std::size_t size() {
+      return N;
+    }
+
+    /*! Returns the state of channel idx */
+    bool test(std::size_t idx) {
+      return (m_ptr->load(std::memory_order_acquire) >> idx) & 1;
+    }
+
+    /*! Set channel idx to value (thread-safe, other channels are not affected) */
+    void set(std::size_t idx, bool value = true) {
+
+  #ifdef DEBUG
+      // write not allowed on input
+      XASSERT(this->isOutput());
+  #endif
+
+      if (value) {
+        m_ptr->fetch_or(bit(idx), std::memory_order_acq_rel);
+      } else {
+        m_ptr->fetch_and(~bit(idx), std::memory_order_acq_rel);
+      }
+    }
+
+    /*! Clear channel idx */
+    void reset(std::size_t idx) {
+      set(idx, false);
+    }
+
+    /*! Toggle channel idx */
+    void flip(std::size_t idx) {
+
+  #ifdef DEBUG
+      // write not allowed on input
+      XASSERT(this->isOutput());
+  #endif
+
+      m_ptr->fetch_xor(bit(idx), std::memory_order_acq_rel);
+    }
+
+    /*! All channels, bit i is channel i */
+    uint64_t getBits() {
+      return m_ptr->load(std::memory_order_acquire);
+    }
+
+    /*! Set all channels at once */
+    void setBits(uint64_t bits) {
+
+  #ifdef DEBUG
+      // write not allowed on input
+      XASSERT(this->isOutput());
+  #endif
+
+      m_ptr->store(bits & mask(), std::memory_order_release);
+    }
+
+    /*! Mutex of the group of this variable, or the mutex shared by all
+        ungrouped lock-free variables. Only for generic code, the channels
+        are not protected by it */
+    std::timed_mutex& getMutex() {
+      BusVarGroup* group = this->getGroup();
+      return group != nullptr ? group->getMutex() : BusVarGroup::getUngroupedMutex();
+    }
+
+    /*! Copy the channels to dst (job task, outputs, 8 bytes) */
+    void loadLockFree(void* dst) {
+      uint64_t bits = m_ptr->load(std::memory_order_acquire);
+      memcpy(dst, &bits, sizeof(bits));
+    }
+
+    /*! Set the channels from src (job task, inputs, 8 bytes) */
+    void storeLockFree(const void* src) {
+      uint64_t bits;
+      memcpy(&bits, src, sizeof(bits));
+      m_ptr->store(bits & mask(), std::memory_order_release);
+    }
+
+    /*! Size of the storage, which can be moved to a BusVarArena */
+    size_t getStorageSize() const {
+      return sizeof(std::atomic<uint64_t>);
+    }
+
+    /*! Move the value to storage (see BusVarArena) */
+    void relocate(void* storage) {
+      m_ptr = new (storage) std::atomic<uint64_t>(m_ptr->load(std::memory_order_acquire));
+      this->m_dataPtr = (void*) m_ptr;
+    }
+
+  private:
+
+    static constexpr uint64_t bit(std::size_t idx) {
+      return ((uint64_t) 1) << idx;
+    }
+
+    static constexpr uint64_t mask() {
+      return (N == 64) ? ~((uint64_t) 0) : (bit(N) - 1);
+    }
+
+    //! Current storage of the channels, m_data or a slot in a BusVarArena
+    std::atomic<uint64_t>*  m_ptr;
+
+    //! The channels (until relocated)
+    std::atomic<uint64_t>   m_data;
+
+  };
+
+  // no mutex per variable, only the pointer and the channels on top of the base
+  static_assert(sizeof(BusBits<64, BusInput>) == sizeof(BusInput) + sizeof(void*) + sizeof(std::atomic<uint64_t>),
+                "BusBits must not grow beyond its channels and storage pointer");
+
+}
+
+#endif /* end of include guard: BUSBITS_HPP_E25A0C87 */
@@ -20,6 +20,8 @@ namespace ec {
 
 #include "BusSlave.hpp"
 #include "BusVarType.hpp"
+#include "BusVarGroup.hpp"
+#include "BusTimestamp.hpp"
 
 namespace ec {
 
@@ -59,6 +61,12 @@ namespace ec {
       return m_cycleCounter;
     }
     
+    /*! Returns the stamp of the latest input exchange. All bus variables
+        outside of groups hold the inputs of this cycle or a later one */
+    BusTimestamp getInputStamp() const {
+      return m_inputStamp.load();
+    }
+
     /* Returns the bus cycle time in microseconds */
     virtual uint32_t getBusCycleTimeUs() = 0;
 
@@ -84,6 +92,12 @@ namespace ec {
       return false;
     }
   
+    /*! virtual method for linking a run of boolean PDO variables to one BusBits */
+    virtual bool linkPDOBits(BusSlave<SlaveInstanceMapperPolicy>* const slave, const std::vector<std::string>& varNames,
+                             BusVarType* ptr) {
+      return BusMaster<SlaveInstanceMapperPolicy>::linkPDOVar(slave, varNames.empty() ? std::string() : varNames[0], ptr);
+    }
+
     /*! virtual method for linking to SDO variables */
     virtual bool linkSDOVar(BusSlave<SlaveInstanceMapperPolicy>* const slave, const int& objIndex, 
                             const char& objSubIndex, BusVarType* ptr) {
@@ -104,10 +118,21 @@ namespace ec {
     virtual void setRequestedState(const BusState& reqState, const bool& blocking=true) = 0;
     
     /*! Registers a slave for this master - this triggers call of process() method by the master */
-    void registerSlave(BusSlave<SlaveInstanceMapperPolicy>* slave) {
+    virtual void registerSlave(BusSlave<SlaveInstanceMapperPolicy>* slave) {
       m_slaves.push_back(slave);
     }
     
+    /*! Registers a group of linked PDO variables, which is exchanged as a unit.
+        Returns true if the group contains unlinked variables (not registered) */
+    bool registerGroup(BusVarGroup* group) {
+      if (!group->isLinked()) {
+        perr("BusMaster: group with unlinked PDO variables not registered\n");
+        return true;
+      }
+      m_groups.push_back(group);
+      return false;
+    }
+
     friend class BusSlave<SlaveInstanceMapperPolicy>;
     
     /*! Wrapper to call process() on a slave */
@@ -129,6 +154,9 @@ namespace ec {
     /*! pointers to registered SDO variables for all slaves */
     std::vector<BusVarType*> m_variablesSDO;
     
+    /*! groups of PDO variables, exchanged as a unit */
+    std::vector<BusVarGroup*> m_groups;
+
     /*! slaves registered with this master instance */
     std::vector<BusSlave<SlaveInstanceMapperPolicy>* > m_slaves;
   
@@ -137,6 +165,9 @@ namespace ec {
       
     //! Cycle counter
     volatile uint64_t               m_cycleCounter = 0;
+
+    //! stamp of the latest input exchange, set by the job task
+    BusTimestampLatch               m_inputStamp;
   };
 
 }
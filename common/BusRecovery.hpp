@@ -0,0 +1,129 @@
+//
+//  BusRecovery.hpp
+//  am2b
+//
+//  Timeline of a bus recovery. A slave which dropped out is brought back
+//  through its state machine phase by phase (incremental recovery), the
+//  duration of every phase is recorded. The bus-wide fallback (all slaves
+//  through INIT) is recorded in the same way.
+//
+//  Copyright 2015 Chair of Applied Mechanics, TUM
+//  https://www.amm.mw.tum.de/
+//
+
+#ifndef BUSRECOVERY_HPP_3E8B0C52
+#define BUSRECOVERY_HPP_3E8B0C52
+
+#include <stdint.h>
+#include <string.h>
+
+namespace ec {
+
+  /*! Phases of a recovery, in the order of the slave recovery */
+  enum BusRecoveryPhase {
+    BUS_RECOVERY_RECONNECT = 0,   //!< waiting for the slave (bus-wide: all slaves) to be present again
+    BUS_RECOVERY_INIT,            //!< slave to INIT (resets and acknowledges the slave)
+    BUS_RECOVERY_PREOP,           //!< slave to PREOP (init commands, mailbox)
+    BUS_RECOVERY_SAFEOP,          //!< slave to SAFEOP (PDO, DC sync), bus-wide: bus held in SAFEOP
+    BUS_RECOVERY_FAULT_RESET,     //!< waiting for the application to reset the fault
+    BUS_RECOVERY_OP,              //!< slave / bus back to OP
+    BUS_RECOVERY_NUM_PHASES
+  };
+
+  //! Short name of a recovery phase
+  inline const char* busRecoveryPhaseName(int phase) {
+    static const char* names[BUS_RECOVERY_NUM_PHASES] = {
+      "reconnect", "init", "preop", "safeop", "faultreset", "op"
+    };
+    return (phase >= 0 && phase < BUS_RECOVERY_NUM_PHASES) ? names[phase] : "?";
+  }
+
+  /*! Result of one recovery */
+  struct BusRecoveryRecord {
+    uint16_t  stationAddress;                     //!< recovered slave, 0 for the bus-wide recovery
+    bool      busWide;                            //!< all slaves through INIT
+    bool      success;                            //!< back in OP, false if aborted (e.g. fallback to bus-wide)
+    uint32_t  retries;                            //!< restarts after a phase timeout
+    uint64_t  startNs;                            //!< detection time (busStatsNowNs())
+    uint32_t  phaseMs[BUS_RECOVERY_NUM_PHASES];   //!< time spent in each phase, 0 if skipped
+    uint32_t  totalMs;                            //!< detection until OP or abort
+  };
+
+  /*! Timing of a recovery in progress */
+  class BusRecoveryTimeline {
+
+  public:
+
+    /*! Start a recovery at detection time nowNs in phase RECONNECT */
+    void start(uint16_t stationAddress, bool busWide, uint64_t nowNs) {
+      memset(&m_record, 0, sizeof(m_record));
+      memset(m_phaseNs, 0, sizeof(m_phaseNs));
+      m_record.stationAddress = stationAddress;
+      m_record.busWide = busWide;
+      m_record.startNs = nowNs;
+      m_phase = BUS_RECOVERY_RECONNECT;
+      m_phaseStartNs = nowNs;
+      m_active = true;
+    }
+
+    /*! Close the current phase and enter the given one.
+        Phases entered several times (retries) are accumulated */
+    void enter(BusRecoveryPhase phase, uint64_t nowNs) {
+      close(nowNs);
+      m_phase = phase;
+      m_phaseStartNs = nowNs;
+    }
+
+    /*! Count a restart after a timeout */
+    void retry() {
+      m_record.retries++;
+    }
+
+    /*! End the recovery, returns the record */
+    const BusRecoveryRecord& finish(bool success, uint64_t nowNs) {
+      close(nowNs);
+      m_record.success = success;
+      m_record.totalMs = (uint32_t) ((nowNs - m_record.startNs) / 1000000);
+      m_active = false;
+      return m_record;
+    }
+
+    bool isActive() const {
+      return m_active;
+    }
+
+    BusRecoveryPhase getPhase() const {
+      return m_phase;
+    }
+
+    uint64_t getPhaseStartNs() const {
+      return m_phaseStartNs;
+    }
+
+    /*! Time in the current phase in ms */
+    uint32_t getPhaseMs(uint64_t nowNs) const {
+      return (uint32_t) ((nowNs - m_phaseStartNs) / 1000000);
+    }
+
+    const BusRecoveryRecord& getRecord() const {
+      return m_record;
+    }
+
+  private:
+
+    void close(uint64_t nowNs) {
+      m_phaseNs[m_phase] += nowNs - m_phaseStartNs;
+      m_record.phaseMs[m_phase] = (uint32_t) (m_phaseNs[m_phase] / 1000000);
+    }
+
+    BusRecoveryRecord   m_record = BusRecoveryRecord();
+    BusRecoveryPhase    m_phase = BUS_RECOVERY_RECONNECT;
+    uint64_t            m_phaseStartNs = 0;
+    uint64_t            m_phaseNs[BUS_RECOVERY_NUM_PHASES] = {};
+    bool                m_active = false;
+
+  };
+
+}
+
+#endif /* end of include guard: BUSRECOVERY_HPP_3E8B0C52 */
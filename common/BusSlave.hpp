@@ -89,6 +89,33 @@ namespace ec {
     void resetFault() {
       m_fault = false;
     }
+
+    /*! Return true if process() must not run concurrently with the process()
+        of other slaves (shared state, not thread-safe libraries). Such slaves
+        are processed in the thread calling master.process(), see
+        AcEcMaster::enableParallelProcess() */
+    virtual bool requiresSerialProcess() {
+      return false;
+    }
+
+    /*! Call process() only in every divisor-th call of master.process(), for
+        slow devices or drives which only synchronize parameters.
+        phase selects the call (0..divisor-1), -1 lets the master choose it
+        to spread the slaves evenly. Set before the first master.process() */
+    void setProcessRate(uint32_t divisor, int32_t phase = -1) {
+      m_processDivisor = (divisor == 0) ? 1 : divisor;
+      m_processPhase = phase;
+    }
+
+    /*! process() rate divisor, see setProcessRate() */
+    uint32_t getProcessDivisor() const {
+      return m_processDivisor;
+    }
+
+    /*! Requested process() phase, -1 if chosen by the master */
+    int32_t getProcessPhase() const {
+      return m_processPhase;
+    }
     
     /* The static methods in the following can be used for callbacks from outside the templated world */
 
@@ -175,6 +202,15 @@ namespace ec {
       return m_master->linkPDOVar(this, name, ptr);
     }
   
+    /*!
+    Links a BusBits to a run of boolean PDO variables, one name per bit.
+    The entries must be contiguous in the process image.
+    Returns true if an error occurs
+    */
+    bool linkPDOBits(const std::vector<std::string>& names, BusVarType* const ptr) {
+      return m_master->linkPDOBits(this, names, ptr);
+    }
+
     /*!
     Links the given SDO BusVar to the given slave variable.
     Returns true if an error occurs
@@ -183,6 +219,16 @@ namespace ec {
       return m_master->linkSDOVar(this, objIndex, objSubIndex, ptr);
     }
   
+    /*!
+    Registers a group of linked PDO variables, which the master exchanges as a
+    unit (consistent inputs and outputs of one cycle, see BusVarGroup.hpp).
+    Add the variables to the group after linking them.
+    Returns true if an error occurs
+    */
+    bool registerGroup(BusVarGroup* const group) {
+      return m_master->registerGroup(group);
+    }
+
     /*! Called by the BusSlave, sets the fault flag */
     void setFaultFlag() {
       m_fault = true;
@@ -200,6 +246,10 @@ namespace ec {
         necessity for a safety reaction */
     volatile bool m_fault = false;
 
+    //! process() rate, see setProcessRate()
+    uint32_t m_processDivisor = 1;
+    int32_t  m_processPhase = -1;
+
   };
 
 }
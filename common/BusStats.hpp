@@ -0,0 +1,362 @@
+//
+//  BusStats.hpp
+//  am2b
+//
+//  Statistics page in POSIX shared memory. The master updates the page
+//  once per cycle (seqlock), local monitoring tools map it read-only and
+//  copy it at any rate without touching the real-time threads.
+//
+//  Copyright 2015 Chair of Applied Mechanics, TUM
+//  https://www.amm.mw.tum.de/
+//
+
+#ifndef BUSSTATS_HPP_C84E1F07
+#define BUSSTATS_HPP_C84E1F07
+
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+
+#include <xstdio.h>
+
+//! Magic number at the beginning of the page
+#define BUSSTATS_MAGIC          0x45435354  // "ECST"
+//! Layout version, increment on every change of BusStatsPage
+#define BUSSTATS_VERSION        3
+//! Maximum number of slaves in the page
+#define BUSSTATS_MAX_SLAVES     64
+//! Length of the slave names (including terminating zero)
+#define BUSSTATS_NAME_SIZE      32
+//! Entries of the station address lookup (power of 2, at least twice BUSSTATS_MAX_SLAVES)
+#define BUSSTATS_SLAVE_MAP_SIZE 128
+
+namespace ec {
+
+  /*! Phases of the job task cycle */
+  enum BusStatsPhase {
+    BUSSTATS_PHASE_RX = 0,        //!< process received frames
+    BUSSTATS_PHASE_INPUTS,        //!< copy inputs to the bus variables
+    BUSSTATS_PHASE_CALLBACK,      //!< cycle callbacks (see CycleCallback.hpp)
+    BUSSTATS_PHASE_OUTPUTS,       //!< copy outputs from the bus variables
+    BUSSTATS_PHASE_SEND_CYC,      //!< send cyclic frames
+    BUSSTATS_PHASE_MASTER_TIMER,  //!< master timer (administration)
+    BUSSTATS_PHASE_SEND_ACYC,     //!< send acyclic frames
+    BUSSTATS_PHASE_COMPANION,     //!< companion thread: master timer and acyclic frames
+    BUSSTATS_PHASE_TOTAL,         //!< complete cycle
+    BUSSTATS_NUM_PHASES
+  };
+
+  //! Short name of a phase (ec_stats, CycleTracer)
+  inline const char* busStatsPhaseName(int phase) {
+    static const char* names[BUSSTATS_NUM_PHASES] = {
+      "rx", "inputs", "callback", "outputs", "sendcyc", "mastertimer", "sendacyc", "companion", "total"
+    };
+    return (phase >= 0 && phase < BUSSTATS_NUM_PHASES) ? names[phase] : "?";
+  }
+
+  //! Monotonic time in ns for the phase and latency measurements
+  inline uint64_t busStatsNowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  /*! Statistics of one slave */
+  struct BusStatsSlave {
+    char      name[BUSSTATS_NAME_SIZE];
+    uint16_t  stationAddress;
+    uint16_t  state;              //!< last reported EtherCAT state
+    uint32_t  wkcErrors;          //!< working counter errors reported for this slave
+    uint32_t  errors;             //!< error status notifications
+    uint32_t  sdoPending;         //!< asynchronous SDO transfers in progress
+    uint32_t  sdoTransfers;       //!< completed asynchronous SDO transfers
+    uint32_t  sdoFailed;          //!< failed asynchronous SDO transfers
+    uint32_t  sdoLastLatencyUs;   //!< latency of the last SDO transfer
+    uint32_t  sdoMaxLatencyUs;    //!< maximum SDO latency
+  };
+
+  /*! Layout of the shared memory page */
+  struct BusStatsPage {
+
+    uint32_t              magic;            //!< BUSSTATS_MAGIC
+    uint32_t              version;          //!< BUSSTATS_VERSION
+    uint32_t              size;             //!< sizeof(BusStatsPage)
+
+    //! Sequence number, odd while the page is written
+    std::atomic<uint32_t> seq;
+
+    uint64_t  cycleCounter;
+    uint32_t  busCycleTimeUs;
+    uint32_t  busState;                     //!< EtherCAT state of the master
+    uint32_t  fault;                        //!< master fault flag
+    uint32_t  overloadCounter;              //!< job task overload counter
+    uint64_t  lostFrames;                   //!< cycles without valid response
+    uint64_t  cycCmdWkcErrors;              //!< cyclic command working counter errors
+
+    uint32_t  phaseUs[BUSSTATS_NUM_PHASES];     //!< duration of the phases in the last cycle
+    uint32_t  phaseMaxUs[BUSSTATS_NUM_PHASES];  //!< maximum duration since start
+
+    uint32_t  numSlaves;
+    BusStatsSlave slaves[BUSSTATS_MAX_SLAVES];
+  };
+
+  /*! Writes the statistics page. The counters may be updated from any thread,
+      publish() must only be called from one thread (the job task). */
+  class BusStatsPublisher {
+
+  public:
+
+    ~BusStatsPublisher() {
+      close();
+    }
+
+    /*! Create and map the shared memory object. Returns true if an error occurs */
+    bool open(const std::string& name, uint32_t busCycleTimeUs) {
+
+      if (m_page) {
+        return false;
+      }
+
+      int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0644);
+      if (fd < 0) {
+        perr_errno_ffl("Cannot create shared memory %s\n", name.c_str());
+        return true;
+      }
+
+      if (ftruncate(fd, sizeof(BusStatsPage)) != 0) {
+        perr_errno_ffl("Cannot resize shared memory %s\n", name.c_str());
+        ::close(fd);
+        return true;
+      }
+
+      void* ptr = mmap(NULL, sizeof(BusStatsPage), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      ::close(fd);
+      if (ptr == MAP_FAILED) {
+        perr_errno_ffl("Cannot map shared memory %s\n", name.c_str());
+        return true;
+      }
+
+      m_name = name;
+      m_page = (BusStatsPage*) ptr;
+
+      memset((void*) m_page, 0, sizeof(BusStatsPage));
+      m_page->size = sizeof(BusStatsPage);
+      m_page->version = BUSSTATS_VERSION;
+      m_page->busCycleTimeUs = busCycleTimeUs;
+      m_page->seq.store(0, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+      m_page->magic = BUSSTATS_MAGIC;   // readers check the magic last
+      return false;
+    }
+
+    /*! Unmap and remove the shared memory object */
+    void close() {
+      if (!m_page) {
+        return;
+      }
+      munmap(m_page, sizeof(BusStatsPage));
+      shm_unlink(m_name.c_str());
+      m_page = NULL;
+    }
+
+    /*! Returns true if the page is mapped */
+    bool isOpen() const {
+      return m_page != NULL;
+    }
+
+    /*! Add a slave, before the bus is started. Returns the index or -1 */
+    int addSlave(const std::string& name, uint16_t stationAddress) {
+
+      if (m_numSlaves >= BUSSTATS_MAX_SLAVES) {
+        return -1;
+      }
+
+      Slave& s = m_slaves[m_numSlaves];
+      strncpy(s.name, name.c_str(), BUSSTATS_NAME_SIZE - 1);
+      s.name[BUSSTATS_NAME_SIZE - 1] = '\0';
+      s.stationAddress = stationAddress;
+
+      // the first slave with an address is found by findSlave()
+      uint32_t pos = slaveMapPos(stationAddress);
+      while (m_slaveMap[pos].index != 0 && m_slaveMap[pos].stationAddress != stationAddress) {
+        pos = (pos + 1) & (BUSSTATS_SLAVE_MAP_SIZE - 1);
+      }
+      if (m_slaveMap[pos].index == 0) {
+        m_slaveMap[pos].stationAddress = stationAddress;
+        m_slaveMap[pos].index = (int16_t) (m_numSlaves + 1);
+      }
+
+      return (int) m_numSlaves++;
+    }
+
+    /*! Returns the index of the slave with the given station address, -1 if unknown.
+        Hash lookup, used in the notification callback */
+    int findSlave(uint16_t stationAddress) const {
+      for (uint32_t pos = slaveMapPos(stationAddress); m_slaveMap[pos].index != 0;
+           pos = (pos + 1) & (BUSSTATS_SLAVE_MAP_SIZE - 1)) {
+        if (m_slaveMap[pos].stationAddress == stationAddress) {
+          return m_slaveMap[pos].index - 1;
+        }
+      }
+      return -1;
+    }
+
+    /* Counters, thread-safe. Negative indices are ignored */
+
+    void countWkcError(int slave) {
+      if (slave >= 0) m_slaves[slave].wkcErrors.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void countCycCmdWkcError() {
+      m_cycCmdWkcErrors.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void countError(int slave) {
+      if (slave >= 0) m_slaves[slave].errors.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void setState(int slave, uint16_t state) {
+      if (slave >= 0) m_slaves[slave].state.store(state, std::memory_order_relaxed);
+    }
+
+    void sdoStarted(int slave) {
+      if (slave >= 0) m_slaves[slave].sdoPending.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void sdoCompleted(int slave, bool failed, uint32_t latencyUs) {
+      if (slave < 0) {
+        return;
+      }
+      Slave& s = m_slaves[slave];
+      s.sdoPending.fetch_sub(1, std::memory_order_relaxed);
+      (failed ? s.sdoFailed : s.sdoTransfers).fetch_add(1, std::memory_order_relaxed);
+      s.sdoLastLatencyUs.store(latencyUs, std::memory_order_relaxed);
+      uint32_t max = s.sdoMaxLatencyUs.load(std::memory_order_relaxed);
+      while (latencyUs > max && !s.sdoMaxLatencyUs.compare_exchange_weak(max, latencyUs, std::memory_order_relaxed)) {
+      }
+    }
+
+    /*! Set the duration of a phase of the current cycle. Each phase
+        is set by one thread (job task or companion thread) */
+    void setPhase(BusStatsPhase phase, uint32_t us) {
+      m_phaseUs[phase].store(us, std::memory_order_relaxed);
+      if (us > m_phaseMaxUs[phase].load(std::memory_order_relaxed)) {
+        m_phaseMaxUs[phase].store(us, std::memory_order_relaxed);
+      }
+    }
+
+    /* Job task only */
+
+    /*! Write the page (seqlock). Called once per cycle */
+    void publish(uint64_t cycleCounter, uint32_t busState, bool fault, uint32_t overloadCounter, uint64_t lostFrames) {
+
+      if (!m_page) {
+        return;
+      }
+
+      uint32_t seq = m_page->seq.load(std::memory_order_relaxed);
+      m_page->seq.store(seq + 1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+
+      m_page->cycleCounter = cycleCounter;
+      m_page->busState = busState;
+      m_page->fault = fault;
+      m_page->overloadCounter = overloadCounter;
+      m_page->lostFrames = lostFrames;
+      m_page->cycCmdWkcErrors = m_cycCmdWkcErrors.load(std::memory_order_relaxed);
+      for (int i = 0; i < BUSSTATS_NUM_PHASES; i++) {
+        m_page->phaseUs[i] = m_phaseUs[i].load(std::memory_order_relaxed);
+        m_page->phaseMaxUs[i] = m_phaseMaxUs[i].load(std::memory_order_relaxed);
+      }
+
+      m_page->numSlaves = m_numSlaves;
+      for (uint32_t i = 0; i < m_numSlaves; i++) {
+        const Slave& s = m_slaves[i];
+        BusStatsSlave& p = m_page->slaves[i];
+        memcpy(p.name, s.name, BUSSTATS_NAME_SIZE);
+        p.stationAddress = s.stationAddress;
+        p.state = s.state.load(std::memory_order_relaxed);
+        p.wkcErrors = s.wkcErrors.load(std::memory_order_relaxed);
+        p.errors = s.errors.load(std::memory_order_relaxed);
+        p.sdoPending = s.sdoPending.load(std::memory_order_relaxed);
+        p.sdoTransfers = s.sdoTransfers.load(std::memory_order_relaxed);
+        p.sdoFailed = s.sdoFailed.load(std::memory_order_relaxed);
+        p.sdoLastLatencyUs = s.sdoLastLatencyUs.load(std::memory_order_relaxed);
+        p.sdoMaxLatencyUs = s.sdoMaxLatencyUs.load(std::memory_order_relaxed);
+      }
+
+      m_page->seq.store(seq + 2, std::memory_order_release);
+    }
+
+    /*! Consistent copy of a mapped page (reader side). Returns false if the
+        page is not (yet) valid or the writer did not finish within maxRetries */
+    static bool read(const BusStatsPage* page, BusStatsPage& copy, int maxRetries = 1000) {
+
+      if (page->magic != BUSSTATS_MAGIC || page->version != BUSSTATS_VERSION || page->size != sizeof(BusStatsPage)) {
+        return false;
+      }
+
+      for (int i = 0; i < maxRetries; i++) {
+        uint32_t seq1 = page->seq.load(std::memory_order_acquire);
+        if (seq1 & 1) {
+          continue;
+        }
+        memcpy((void*) &copy, (const void*) page, sizeof(BusStatsPage));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (page->seq.load(std::memory_order_relaxed) == seq1) {
+          return true;
+        }
+      }
+      return false;
+    }
+
+  private:
+
+    //! Slave counters, updated by the master threads
+    struct Slave {
+      char                    name[BUSSTATS_NAME_SIZE];
+      uint16_t                stationAddress = 0;
+      std::atomic<uint16_t>   state{0};
+      std::atomic<uint32_t>   wkcErrors{0};
+      std::atomic<uint32_t>   errors{0};
+      std::atomic<uint32_t>   sdoPending{0};
+      std::atomic<uint32_t>   sdoTransfers{0};
+      std::atomic<uint32_t>   sdoFailed{0};
+      std::atomic<uint32_t>   sdoLastLatencyUs{0};
+      std::atomic<uint32_t>   sdoMaxLatencyUs{0};
+    };
+
+    static_assert(BUSSTATS_SLAVE_MAP_SIZE >= 2 * BUSSTATS_MAX_SLAVES &&
+                  (BUSSTATS_SLAVE_MAP_SIZE & (BUSSTATS_SLAVE_MAP_SIZE - 1)) == 0,
+                  "BUSSTATS_SLAVE_MAP_SIZE must be a power of 2 with free entries");
+
+    //! Station address to slave index, open addressing
+    struct SlaveMapEntry {
+      uint16_t  stationAddress;
+      int16_t   index;            //!< slave index + 1, 0: empty
+    };
+
+    static uint32_t slaveMapPos(uint16_t stationAddress) {
+      return ((uint32_t) stationAddress * 40503u >> 4) & (BUSSTATS_SLAVE_MAP_SIZE - 1);
+    }
+
+    BusStatsPage*           m_page = NULL;
+    std::string             m_name;
+
+    Slave                   m_slaves[BUSSTATS_MAX_SLAVES];
+    uint32_t                m_numSlaves = 0;
+    SlaveMapEntry           m_slaveMap[BUSSTATS_SLAVE_MAP_SIZE] = {};
+    std::atomic<uint64_t>   m_cycCmdWkcErrors{0};
+
+    std::atomic<uint32_t>   m_phaseUs[BUSSTATS_NUM_PHASES] = {};
+    std::atomic<uint32_t>   m_phaseMaxUs[BUSSTATS_NUM_PHASES] = {};
+
+  };
+
+}
+
+#endif /* end of include guard: BUSSTATS_HPP_C84E1F07 */
@@ -0,0 +1,123 @@
+//
+//  BusTimestamp.hpp
+//  am2b
+//
+//  Stamp of one input exchange: cycle counter, distributed clock bus time
+//  and host monotonic time of the frame. The job task stamps every input
+//  copy, the stamp can be read together with the inputs of a variable
+//  group (BusVarGroup) or for the whole bus (BusMaster::getInputStamp()).
+//
+//  Copyright 2015 Chair of Applied Mechanics, TUM
+//  https://www.amm.mw.tum.de/
+//
+
+#ifndef BUSTIMESTAMP_HPP_7F2D91A6
+#define BUSTIMESTAMP_HPP_7F2D91A6
+
+#include <stdint.h>
+#include <atomic>
+
+namespace ec {
+
+  /*! Time stamp of the inputs of one bus cycle */
+  struct BusTimestamp {
+    uint64_t  cycle;          //!< cycle counter of the received frame (BusMaster::getCycleCounter())
+    uint64_t  busTimeNs;      //!< DC bus time in ns, 0 without distributed clocks or BusTime variable
+    uint64_t  monotonicNs;    //!< host steady clock in ns when the frame was processed (busStatsNowNs())
+  };
+
+  /*! Extends the 32 bit bus time of the process image to 64 bit.
+
+      Seeded with the 64 bit bus time of the stack, the result is the DC
+      system time. Without a seed, the extension starts at the first 32 bit
+      value and is only monotonic, not the absolute bus time.
+      Has to be updated at least every 2.1 s (half a wrap).
+   */
+  class BusTimeExtender {
+
+  public:
+
+    /*! Align with the 64 bit bus time of the stack, read close to the
+        next update() (earlier or later by less than half a wrap) */
+    void seed(uint64_t busTime64) {
+      m_time = busTime64;
+      m_seeded = true;
+      m_valid = true;
+    }
+
+    /*! True if seed() has been called */
+    bool isSeeded() const {
+      return m_seeded;
+    }
+
+    /*! Returns the 64 bit bus time for the 32 bit value of this cycle */
+    uint64_t update(uint32_t busTime) {
+
+      if (!m_valid) {
+        m_time = busTime;
+        m_valid = true;
+        return m_time;
+      }
+
+      // signed distance to the last value, handles the wrap in both directions
+      m_time += (int64_t) (int32_t) (busTime - (uint32_t) m_time);
+      return m_time;
+    }
+
+  private:
+
+    uint64_t  m_time = 0;
+    bool      m_seeded = false;
+    bool      m_valid = false;
+
+  };
+
+  /*! Latest stamp with a single writer (job task) and any number of readers.
+      Sequence lock, the readers never block the job task. */
+  class BusTimestampLatch {
+
+  public:
+
+    /*! Publish a stamp (job task) */
+    void store(const BusTimestamp& stamp) {
+
+      uint64_t seq = m_seq.load(std::memory_order_relaxed);
+      m_seq.store(seq + 1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+
+      m_cycle.store(stamp.cycle, std::memory_order_relaxed);
+      m_busTimeNs.store(stamp.busTimeNs, std::memory_order_relaxed);
+      m_monotonicNs.store(stamp.monotonicNs, std::memory_order_relaxed);
+
+      m_seq.store(seq + 2, std::memory_order_release);
+    }
+
+    /*! Latest stamp, all fields of the same cycle */
+    BusTimestamp load() const {
+
+      BusTimestamp stamp;
+      uint64_t seq;
+
+      do {
+        seq = m_seq.load(std::memory_order_acquire);
+        stamp.cycle = m_cycle.load(std::memory_order_relaxed);
+        stamp.busTimeNs = m_busTimeNs.load(std::memory_order_relaxed);
+        stamp.monotonicNs = m_monotonicNs.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+      } while ((seq & 1) || seq != m_seq.load(std::memory_order_relaxed));
+
+      return stamp;
+    }
+
+  private:
+
+    std::atomic<uint64_t>   m_seq{0};
+    std::atomic<uint64_t>   m_cycle{0};
+    std::atomic<uint64_t>   m_busTimeNs{0};
+    std::atomic<uint64_t>   m_monotonicNs{0};
+
+  };
+
+}
+
+#endif /* end of include guard: BUSTIMESTAMP_HPP_7F2D91A6 */
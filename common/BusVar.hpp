@@ -14,6 +14,7 @@
 #include <typeinfo>
 
 #include "BusVarType.hpp"
+#include "BusVarAtomic.hpp"
 #include <xdebug.h>
 
 namespace ec {
@@ -75,6 +76,11 @@ namespace ec {
     const unsigned int getSize() const {
       return BusVarTypeSize<T>();
     }
+
+    /*! Returns the mutex to lock access to the data area */
+    std::timed_mutex& getMutex() {
+      return m_mutex;
+    }
   
     //! assignment from other
     BusVar& operator=(const BusVar& other) {
@@ -329,6 +335,9 @@ namespace ec {
   
     //! The internal representation of the bus variable data
     T     m_data;
+
+    //! for thread safety (PDO data is accessed from within JobTask thread)         
+    std::timed_mutex  m_mutex;
   
   };
 
@@ -352,6 +361,11 @@ namespace ec {
       const unsigned int getSize() const {
         return 8*8;
       }
+
+      /*! Returns the mutex to lock access to the data area */
+      std::timed_mutex& getMutex() {
+        return m_mutex;
+      }
       
       //! Return the error code
       const uint16_t getErrorCode() {
@@ -397,60 +411,69 @@ namespace ec {
       
       //! stores the CoE emergency data
       CoEEmergency m_data;
+
+      //! for thread safety (written by the notification callback)
+      std::timed_mutex m_mutex;
       
   };
 
+  /*! Scalar bus variable with the storage selected at compile time:
+      BusVarAtomic for lock-free capable PDO variables, BusVar otherwise */
+  template <typename T, class BusVarDir>
+  using BusScalar = typename std::conditional< BusVarIsLockFree<T, BusVarDir>::value,
+                                               BusVarAtomic<T, BusVarDir>, BusVar<T, BusVarDir> >::type;
+
   /* Specific type aliases */
   template <class BusVarDir>
-  using BusBool = BusVar< bool, BusVarDir >;
+  using BusBool = BusScalar< bool, BusVarDir >;
 
   template <class BusVarDir>
-  using BusInt8 = BusVar< int8_t, BusVarDir >;
+  using BusInt8 = BusScalar< int8_t, BusVarDir >;
 
   template <class BusVarDir>
   using BusSint = BusInt8<BusVarDir>;
 
   template <class BusVarDir>
-  using BusUInt8 = BusVar< uint8_t, BusVarDir >;
+  using BusUInt8 = BusScalar< uint8_t, BusVarDir >;
 
   template <class BusVarDir>
   using BusUint = BusUInt8<BusVarDir>;
 
   template <class BusVarDir>
-  using BusInt16 = BusVar< int16_t, BusVarDir >;
+  using BusInt16 = BusScalar< int16_t, BusVarDir >;
 
   template <class BusVarDir>
   using BusInt = BusInt16<BusVarDir>;
 
   template <class BusVarDir>
-  using BusUInt16 = BusVar< uint16_t, BusVarDir >;
+  using BusUInt16 = BusScalar< uint16_t, BusVarDir >;
 
   template <class BusVarDir>
   using BusUInt = BusUInt16<BusVarDir>;
 
   template <class BusVarDir>
-  using BusInt32 = BusVar< int32_t, BusVarDir >;
+  using BusInt32 = BusScalar< int32_t, BusVarDir >;
 
   template <class BusVarDir>
   using BusDInt = BusInt32<BusVarDir>;
 
   template <class BusVarDir>
-  using BusUInt32 = BusVar< uint32_t, BusVarDir >;
+  using BusUInt32 = BusScalar< uint32_t, BusVarDir >;
 
   template <class BusVarDir>
   using BusUDInt = BusUInt32<BusVarDir>;
 
   template <class BusVarDir>
-  using BusInt64 = BusVar< int64_t, BusVarDir >;
+  using BusInt64 = BusScalar< int64_t, BusVarDir >;
 
   template <class BusVarDir>
-  using BusUInt64 = BusVar< uint64_t, BusVarDir >;
+  using BusUInt64 = BusScalar< uint64_t, BusVarDir >;
 
   template <class BusVarDir>
-  using BusReal32 = BusVar< float, BusVarDir >;
+  using BusReal32 = BusScalar< float, BusVarDir >;
 
   template <class BusVarDir>
-  using BusReal64 = BusVar< double, BusVarDir >;
+  using BusReal64 = BusScalar< double, BusVarDir >;
 
 }
 
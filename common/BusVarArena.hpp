@@ -0,0 +1,118 @@
+//
+//  BusVarArena.hpp
+//  am2b
+//
+//  Contiguous storage for the values of the linked PDO variables. The job
+//  task then walks through a few cache lines in process image order instead
+//  of the device objects. Inputs and outputs are placed in separate cache
+//  lines, so the job task does not share lines between both directions.
+//
+//  Copyright 2015 Chair of Applied Mechanics, TUM
+//  https://www.amm.mw.tum.de/
+//
+
+#ifndef BUSVARARENA_HPP_D0E7295B
+#define BUSVARARENA_HPP_D0E7295B
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "BusVarType.hpp"
+
+//! Alignment of the arena and of its regions (cache line size)
+#define BUSVAR_ARENA_ALIGN   64
+
+namespace ec {
+
+  /*! Arena for the storage of relocatable bus variables (getStorageSize() > 0).
+
+      Variables without relocatable storage (mutex based, arrays) are skipped.
+      The arena must outlive all accesses to the relocated variables.
+   */
+  class BusVarArena {
+
+  public:
+
+    ~BusVarArena() {
+      free(m_memory);
+    }
+
+    /*! Move the variables into the arena, the inputs first, then the outputs
+        starting at a new cache line. Call only once, while the variables are
+        not accessed by any other thread. Returns true if an error occurs */
+    bool build(const std::vector<BusVarType*>& inputs, const std::vector<BusVarType*>& outputs) {
+
+      if (m_memory) {
+        return true;
+      }
+
+      // layout: offsets of inputs and outputs
+      size_t size = 0;
+      size_t outputsBegin = 0;
+      std::vector<size_t> offsets;
+      for (int region = 0; region < 2; region++) {
+
+        const std::vector<BusVarType*>& vars = (region == 0) ? inputs : outputs;
+        for (BusVarType* var : vars) {
+          size_t s = var->getStorageSize();
+          if (s > 0) {
+            size = (size + s - 1) / s * s;
+            offsets.push_back(size);
+            size += s;
+          }
+        }
+
+        size = (size + BUSVAR_ARENA_ALIGN - 1) / BUSVAR_ARENA_ALIGN * BUSVAR_ARENA_ALIGN;
+        if (region == 0) {
+          outputsBegin = size;
+        }
+      }
+
+      if (size == 0) {
+        return false;
+      }
+
+      if (posix_memalign(&m_memory, BUSVAR_ARENA_ALIGN, size) != 0) {
+        m_memory = NULL;
+        return true;
+      }
+      memset(m_memory, 0, size);
+      m_size = size;
+      m_inputSize = outputsBegin;
+
+      // move the values
+      size_t i = 0;
+      for (const std::vector<BusVarType*>* vars : {&inputs, &outputs}) {
+        for (BusVarType* var : *vars) {
+          if (var->getStorageSize() > 0) {
+            var->relocate((uint8_t*) m_memory + offsets[i++]);
+          }
+        }
+      }
+
+      return false;
+    }
+
+    /*! Size of the arena in bytes */
+    size_t size() const {
+      return m_size;
+    }
+
+    /*! Size of the input region in bytes, the outputs follow */
+    size_t inputSize() const {
+      return m_inputSize;
+    }
+
+  private:
+
+    void*   m_memory = NULL;
+    size_t  m_size = 0;
+    size_t  m_inputSize = 0;
+
+  };
+
+}
+
+#endif /* end of include guard: BUSVARARENA_HPP_D0E7295B */
@@ -0,0 +1,281 @@
+//
+//  BusVarAtomic.hpp
+//  am2b
+//
+//  Lock-free storage for scalar PDO variables. The value is a std::atomic<T>,
+//  the job task copies it without locking (see AcEcMaster::runJobTask).
+//
+//  Copyright 2015 Chair of Applied Mechanics, TUM
+//  https://www.amm.mw.tum.de/
+//
+
+#ifndef BUSVARATOMIC_HPP_8C2E5B71
+#define BUSVARATOMIC_HPP_8C2E5B71
+
+#include <mutex>
+#include <atomic>
+#include <new>
+#include <typeinfo>
+#include <type_traits>
+#include <string.h>
+
+#include "BusVarType.hpp"
+#include "BusVarGroup.hpp"
+#include <xdebug.h>
+
+namespace ec {
+
+  /*! True if BusVar<T, BusVarDirection> is stored lock-free: scalar types up to the
+      native word size in PDO directions. SDO variables keep the mutex, their data
+      is written by the stack via the mailbox transfer objects.
+      Define HWL_BUSVAR_NO_ATOMIC to use the mutex-based BusVar for all types. */
+  template<typename T, class BusVarDirection>
+  struct BusVarIsLockFree {
+#ifdef HWL_BUSVAR_NO_ATOMIC
+    static const bool value = false;
+#else
+    static const bool value = std::is_arithmetic<T>::value && sizeof(T) <= sizeof(void*) &&
+                              (std::is_same<BusVarDirection, BusInput>::value ||
+                               std::is_same<BusVarDirection, BusOutput>::value);
+#endif
+  };
+
+  /*! Bus variable backed by std::atomic<T>.
+
+      Same interface as BusVar. Plain reads and writes are single acquire loads
+      and release stores, compound operators use compare-exchange loops.
+      Multiple variables are not updated consistently within one cycle.
+   */
+  template<typename T, class BusVarDirection>
+  class BusVarAtomic : public BusVarDirection {
+
+    static_assert(std::is_arithmetic<T>::value, "BusVarAtomic requires a scalar type");
+
+  public:
+
+    //! Constructor
+    BusVarAtomic() {
+
+      // set pointer address to member of parent
+      m_ptr = &m_data;
+      this->m_dataPtr = (void*) m_ptr;
+
+      // set the typeid
+      this->m_typeid = &typeid(T);
+
+      this->m_lockFree = true;
+
+      // zero is always defined
+      m_ptr->store(0, std::memory_order_relaxed);
+    }
+
+    //! copy constructor
+    BusVarAtomic(const BusVarAtomic& other) : BusVarAtomic() {
+
+  #ifdef DEBUG
+      // write not allowed on input
+      XASSERT(this->isOutput());
+  #endif
+
+      m_ptr->store(other.m_ptr->load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+    //! type based constructor
+    BusVarAtomic(const T& value) : BusVarAtomic() {
+
+  #ifdef DEBUG
+      // write not allowed on input
+      XASSERT(this->isOutput());
+  #endif
+
+      m_ptr->store(value, std::memory_order_release);
+    }
+
+    /*! Returns the size of the variable in bits */
+    const unsigned int getSize() const {
+      return BusVarTypeSize<T>();
+    }
+
+    /*! Size of the storage, which can be moved to a BusVarArena */
+    size_t getStorageSize() const {
+      return sizeof(std::atomic<T>);
+    }
+
+    /*! Move the value to storage (see BusVarArena). Not thread-safe, the variable
+        must not be accessed concurrently */
+    void relocate(void* storage) {
+      m_ptr = new (storage) std::atomic<T>(m_ptr->load(std::memory_order_acquire));
+      this->m_dataPtr = (void*) m_ptr;
+    }
+
+    /*! Mutex of the group of this variable, or the mutex shared by all
+        ungrouped lock-free variables. Only for generic code (e.g. the SDO
+        transfer flags), the value is not protected by it */
+    std::timed_mutex& getMutex() {
+      BusVarGroup* group = this->getGroup();
+      return group != nullptr ? group->getMutex() : BusVarGroup::getUngroupedMutex();
+    }
+
+    /*! Copy the value to dst (job task, outputs) */
+    void loadLockFree(void* dst) {
+      T value = m_ptr->load(std::memory_order_acquire);
+      if (std::is_same<T, bool>::value) {
+        *((uint8_t*) dst) = value ? 1 : 0;
+      } else {
+        memcpy(dst, &value, sizeof(T));
+      }
+    }
+
+    /*! Set the value from src (job task, inputs) */
+    void storeLockFree(const void* src) {
+      T value;
+      if (std::is_same<T, bool>::value) {
+        value = (*((const uint8_t*) src) != 0);
+      } else {
+        memcpy(&value, src, sizeof(T));
+      }
+      m_ptr->store(value, std::memory_order_release);
+    }
+
+    //! assignment from other
+    BusVarAtomic& operator=(const BusVarAtomic& other) {
+
+  #ifdef DEBUG
+      // write not allowed on input
+      XASSERT(this->isOutput());
+  #endif
+
+      if (this != &other) {
+        m_ptr->store(other.m_ptr->load(std::memory_order_acquire), std::memory_order_release);
+      }
+
+      return *this;
+    }
+
+    //! assignment operator from type T
+    BusVarAtomic& operator=(const T& value) {
+
+  #ifdef DEBUG
+      // write not allowed on input
+      XASSERT(this->isOutput());
+  #endif
+
+      m_ptr->store(value, std::memory_order_release);
+      return *this;
+    }
+
+    //! type assignment operator
+    operator T() {
+      return m_ptr->load(std::memory_order_acquire);
+    }
+
+    BusVarAtomic& operator+=(const T& value) {
+      update([&](T v) { return (T) (v + value); });
+      return *this;
+    }
+
+    BusVarAtomic& operator-=(const T& value) {
+      update([&](T v) { return (T) (v - value); });
+      return *this;
+    }
+
+    BusVarAtomic& operator*=(const T& value) {
+      update([&](T v) { return (T) (v * value); });
+      return *this;
+    }
+
+    BusVarAtomic& operator/=(const T& value) {
+      update([&](T v) { return (T) (v / value); });
+      return *this;
+    }
+
+    BusVarAtomic& operator%=(const T& value) {
+      update([&](T v) { return (T) (v % value); });
+      return *this;
+    }
+
+    BusVarAtomic& operator&=(const T& value) {
+      update([&](T v) { return (T) (v & value); });
+      return *this;
+    }
+
+    BusVarAtomic& operator|=(const T& value) {
+      update([&](T v) { return (T) (v | value); });
+      return *this;
+    }
+
+    BusVarAtomic& operator^=(const T& value) {
+      update([&](T v) { return (T) (v ^ value); });
+      return *this;
+    }
+
+    BusVarAtomic& operator<<=(const T& value) {
+      update([&](T v) { return (T) (v << value); });
+      return *this;
+    }
+
+    BusVarAtomic& operator>>=(const T& value) {
+      update([&](T v) { return (T) (v >> value); });
+      return *this;
+    }
+
+    T operator++() {
+      // pre-increment
+      return update([](T v) { return (T) (v + 1); });
+    }
+
+    T operator++(int) {
+      // post-increment
+      return update([](T v) { return (T) (v + 1); }, true);
+    }
+
+    T operator--() {
+      // pre-decrement
+      return update([](T v) { return (T) (v - 1); });
+    }
+
+    T operator--(int) {
+      // post-decrement
+      return update([](T v) { return (T) (v - 1); }, true);
+    }
+
+    //! get value method
+    const T getValue() {
+      return m_ptr->load(std::memory_order_acquire);
+    }
+
+  private:
+
+    /*! Atomically replace the value by op(value).
+        Returns the new value, or the previous value if returnPrevious is set */
+    template<class Op>
+    T update(Op op, bool returnPrevious = false) {
+
+  #ifdef DEBUG
+      // write not allowed on input
+      XASSERT(this->isOutput());
+  #endif
+
+      T cur = m_ptr->load(std::memory_order_relaxed);
+      T next;
+      do {
+        next = op(cur);
+      } while (!m_ptr->compare_exchange_weak(cur, next, std::memory_order_acq_rel, std::memory_order_relaxed));
+      return returnPrevious ? cur : next;
+    }
+
+    //! Current storage of the value, m_data or a slot in a BusVarArena
+    std::atomic<T>* m_ptr;
+
+    //! The internal representation of the bus variable data (until relocated)
+    std::atomic<T>  m_data;
+
+  };
+
+  // no mutex per variable, only the pointer and the value on top of the base
+  static_assert(sizeof(BusVarAtomic<uint64_t, BusInput>) == sizeof(BusInput) + sizeof(void*) + sizeof(std::atomic<uint64_t>),
+                "BusVarAtomic must not grow beyond its value and storage pointer");
+
+}
+
+#endif /* end of include guard: BUSVARATOMIC_HPP_8C2E5B71 */
@@ -0,0 +1,123 @@
+//
+//  BusVarGroup.hpp
+//  am2b
+//
+//  Group of PDO variables of one device, which is exchanged by the job task
+//  as a unit. All inputs of a group stem from the same cycle and all outputs
+//  are written to the same frame.
+//
+//  Copyright 2015 Chair of Applied Mechanics, TUM
+//  https://www.amm.mw.tum.de/
+//
+
+#ifndef BUSVARGROUP_HPP_3B9F61C4
+#define BUSVARGROUP_HPP_3B9F61C4
+
+#include <vector>
+#include <mutex>
+
+#include <xstdio.h>
+
+#include "BusVarType.hpp"
+#include "BusTimestamp.hpp"
+
+namespace ec {
+
+  /*! Group of linked PDO variables with a common mutex.
+
+      The job task skips grouped variables in its per-variable loops and
+      copies all of them at once while holding the group mutex. Lock the
+      mutex (getMutex()) to read or write several variables consistently,
+      single variables may still be accessed without it.
+      If the mutex cannot be acquired in time, the group keeps the data of
+      the previous cycle.
+   */
+  class BusVarGroup {
+
+  public:
+
+    /*! Add a linked PDO variable to the group. Must be called
+        after linkPDOVar() and before the bus is started.
+        Returns true if the variable is not linked (not added) */
+    bool add(BusVarType* const var) {
+
+      if (!isLinked(var)) {
+        perr("BusVarGroup: cannot add a PDO variable which is not linked\n");
+        return true;
+      }
+
+      var->m_group = this;
+
+      if (var->isOutput()) {
+        m_outputs.push_back(var);
+      } else {
+        m_inputs.push_back(var);
+      }
+      return false;
+    }
+
+    /*! True if the variable has been linked to the process image */
+    static bool isLinked(const BusVarType* const var) {
+      return var->m_offset >= 0;
+    }
+
+    /*! True if all variables of the group are linked */
+    bool isLinked() const {
+      for (const BusVarType* var : m_inputs) {
+        if (!isLinked(var)) return false;
+      }
+      for (const BusVarType* var : m_outputs) {
+        if (!isLinked(var)) return false;
+      }
+      return true;
+    }
+
+    /*! Returns the mutex for the whole group */
+    std::timed_mutex& getMutex() {
+      return m_mutex;
+    }
+
+    /*! Mutex shared by all ungrouped lock-free variables, which have no
+        mutex of their own (see BusVarAtomic::getMutex()) */
+    static std::timed_mutex& getUngroupedMutex() {
+      static std::timed_mutex mutex;
+      return mutex;
+    }
+
+    /*! Stamp of the grouped inputs. Read it while holding the
+        group mutex to get the stamp of the inputs read along with it */
+    const BusTimestamp& getInputStamp() const {
+      return m_inputStamp;
+    }
+
+    /*! Set the stamp of the grouped inputs (job task, group mutex held) */
+    void setInputStamp(const BusTimestamp& stamp) {
+      m_inputStamp = stamp;
+    }
+
+    /*! Grouped input variables */
+    const std::vector<BusVarType*>& getInputs() const {
+      return m_inputs;
+    }
+
+    /*! Grouped output variables */
+    const std::vector<BusVarType*>& getOutputs() const {
+      return m_outputs;
+    }
+
+  private:
+
+    //! held by the job task while the group is exchanged
+    std::timed_mutex          m_mutex;
+
+    std::vector<BusVarType*>  m_inputs;
+    std::vector<BusVarType*>  m_outputs;
+
+    //! cycle of the grouped inputs, protected by m_mutex
+    BusTimestamp              m_inputStamp = {0, 0, 0};
+
+  };
+
+}
+
+#endif /* end of include guard: BUSVARGROUP_HPP_3B9F61C4 */
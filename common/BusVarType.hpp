@@ -12,8 +12,12 @@
 
 #include <mutex>
 #include <typeinfo>
+#include <stddef.h>
 
 namespace ec {
+
+  // prototype, see BusVarGroup.hpp
+  class BusVarGroup;
   
 // This is the address of the emergency object for a slave
 // to link against the async CoE emergency SDO
@@ -46,16 +50,49 @@ namespace ec {
       return m_dataPtr;
     }
   
-    /*! Returns the mutex to lock access to the data area */
-    std::timed_mutex& getMutex() {
-      return m_mutex;
+    /*! Returns the mutex to lock access to the data area.
+        Lock-free variables (isLockFree()) are accessed with
+        loadLockFree() / storeLockFree() instead. */
+    virtual std::timed_mutex& getMutex() = 0;
+
+    /*! Returns true if the value is stored in a lock-free std::atomic (see BusVarAtomic.hpp) */
+    bool isLockFree() const {
+      return m_lockFree;
+    }
+
+    /*! Lock-free variables only: copy the value to dst (getSize() bits) */
+    virtual void loadLockFree(void* dst) {
+    }
+
+    /*! Lock-free variables only: set the value from src (getSize() bits) */
+    virtual void storeLockFree(const void* src) {
+    }
+
+    /*! Size of the storage in bytes, which can be moved to a BusVarArena.
+        Zero if the data cannot be moved */
+    virtual size_t getStorageSize() const {
+      return 0;
+    }
+
+    /*! Move the data to storage (getStorageSize() bytes, aligned to the size) */
+    virtual void relocate(void* storage) {
+    }
+
+    /*! Returns true if the variable is exchanged with a BusVarGroup (see BusVarGroup.hpp) */
+    bool isGrouped() const {
+      return m_group != nullptr;
+    }
+
+    /*! Returns the group of the variable, NULL if not grouped */
+    BusVarGroup* getGroup() const {
+      return m_group;
     }
   
     /*! Returns true, if an SDO transfer is in progress */
     bool transferInProgress() {
     
       // scoped lock
-      std::lock_guard<std::timed_mutex> lock(this->m_mutex);
+      std::lock_guard<std::timed_mutex> lock(this->getMutex());
 
       return m_SDOTransferInProgress;
     
@@ -68,7 +105,7 @@ namespace ec {
       bool ret;
     
       // scoped lock
-      std::lock_guard<std::timed_mutex> lock(this->m_mutex);
+      std::lock_guard<std::timed_mutex> lock(this->getMutex());
     
 
       if (!m_SDOTransferInProgress) {
@@ -91,7 +128,7 @@ namespace ec {
       bool ret;
       
       // scoped lock
-      std::lock_guard<std::timed_mutex> lock(this->m_mutex);
+      std::lock_guard<std::timed_mutex> lock(this->getMutex());
       
       if (!m_SDOTransferInProgress) {
 
@@ -139,11 +176,18 @@ namespace ec {
     //! ptr to the data assigned to the variable
     void*                   m_dataPtr;
   
-    //! for thread safety (PDO data is accessed from within JobTask thread)         
-    std::timed_mutex        m_mutex;
+    //! true if the data is a lock-free std::atomic, the derived classes without own mutex set this
+    bool                    m_lockFree = false;
   
     //! to identify type after cast to this parent class           
     const std::type_info*   m_typeid;
+
+  private:
+
+    friend class BusVarGroup;
+
+    //! group the variable is exchanged with, set by BusVarGroup::add()
+    BusVarGroup*            m_group = nullptr;
   };
 
 
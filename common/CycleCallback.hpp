@@ -0,0 +1,64 @@
+//
+//  CycleCallback.hpp
+//  am2b
+//
+//  User callbacks executed by the job task once per cycle, after the inputs
+//  have been copied and before the outputs are copied. A controller running
+//  there sends its setpoints with the frame following the inputs it used.
+//
+//  Copyright 2015 Chair of Applied Mechanics, TUM
+//  https://www.amm.mw.tum.de/
+//
+
+#ifndef CYCLECALLBACK_HPP_94F1B2D7
+#define CYCLECALLBACK_HPP_94F1B2D7
+
+#include <stdint.h>
+#include <atomic>
+
+#include "BusTimestamp.hpp"
+
+namespace ec {
+
+  /*! Data passed to a cycle callback */
+  struct CycleContext {
+    uint64_t        cycle;          //!< cycle counter of the received frame
+    BusTimestamp    stamp;          //!< bus and host time of the inputs
+    bool            inputsValid;    //!< false if the frame of this cycle was lost
+    const uint8_t*  inputImage;     //!< input process image (see StaticPdo.hpp)
+    uint8_t*        outputImage;    //!< output process image, sent after the callback (see below)
+  };
+
+  /*! Cycle callback. Runs in the job task: must not block, allocate or log
+      and has to finish within its budget. The bus variables hold the inputs
+      of this cycle, outputs set here are sent with the next frame.
+      The output copy runs after the callbacks: outputs linked to bus variables
+      or part of a static PDO block are written through them, a raw write to
+      CycleContext::outputImage is overwritten there. Use outputImage only
+      for outputs which are not linked. */
+  typedef void (*CycleCallbackFn)(void* userData, const CycleContext& ctx);
+
+  /*! Registered callback with its execution time statistics */
+  struct CycleCallbackEntry {
+
+    CycleCallbackEntry(CycleCallbackFn fn_, void* userData_, uint32_t budgetUs_, const char* name_)
+      : fn(fn_), userData(userData_), budgetUs(budgetUs_), name(name_) {
+    }
+
+    CycleCallbackEntry(const CycleCallbackEntry& other)
+      : fn(other.fn), userData(other.userData), budgetUs(other.budgetUs), name(other.name) {
+    }
+
+    CycleCallbackFn         fn;
+    void*                   userData;
+    uint32_t                budgetUs;                 //!< allowed execution time
+    const char*             name;                     //!< for messages and the timeline
+
+    std::atomic<uint32_t>   lastUs{0};                //!< last execution time
+    std::atomic<uint32_t>   maxUs{0};                 //!< maximum execution time
+    std::atomic<uint64_t>   overruns{0};              //!< calls exceeding the budget
+  };
+
+}
+
+#endif /* end of include guard: CYCLECALLBACK_HPP_94F1B2D7 */
@@ -0,0 +1,238 @@
+//
+//  CycleTracer.hpp
+//  am2b
+//
+//  Opt-in timeline tracer for the master threads. Events are recorded into
+//  preallocated per-thread rings (the most recent events are kept) and
+//  written on demand as Chrome Trace Event JSON, which can be opened in
+//  chrome://tracing or https://ui.perfetto.dev
+//
+//  Copyright 2015 Chair of Applied Mechanics, TUM
+//  https://www.amm.mw.tum.de/
+//
+
+#ifndef CYCLETRACER_HPP_5E0A7D13
+#define CYCLETRACER_HPP_5E0A7D13
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <chrono>
+
+#include <xstdio.h>
+
+//! Maximum number of threads recording events
+#define CYCLE_TRACE_MAX_THREADS     8
+//! Default number of events per thread (ring, the oldest events are overwritten)
+#define CYCLE_TRACE_EVENTS          16384
+
+namespace ec {
+
+  /*! One trace event */
+  struct CycleTraceEvent {
+    uint64_t      tsNs;     //!< start time (monotonic)
+    uint64_t      durNs;    //!< duration for complete events
+    const char*   name;     //!< must stay valid until the trace is written
+    uint64_t      arg;      //!< event argument (cycle counter, object index, ...)
+    uint32_t      id;       //!< id of asynchronous events
+    char          ph;       //!< Chrome event type: 'X' complete, 'i' instant, 'b'/'e' async begin/end
+  };
+
+  /*! Timeline tracer with one preallocated event ring per thread.
+
+      Recording is lock-free and does not allocate. The first event of a thread
+      claims one of the CYCLE_TRACE_MAX_THREADS rings, further threads are ignored.
+      The rings are allocated by enable(true), nothing is recorded before.
+   */
+  class CycleTracer {
+
+  public:
+
+    /*!
+      \param eventsPerThread Size of the event ring of each thread
+    */
+    CycleTracer(uint32_t eventsPerThread = CYCLE_TRACE_EVENTS) : m_size(eventsPerThread) {
+    }
+
+    /*! Enable or disable recording. The rings are allocated on the first call
+        with enable=true, must not be called concurrently with recording threads
+        during the first enable. */
+    void enable(bool enable) {
+      if (enable && m_threads[0].events.empty()) {
+        for (uint32_t i = 0; i < CYCLE_TRACE_MAX_THREADS; i++) {
+          m_threads[i].events.resize(m_size);
+        }
+      }
+      m_enabled.store(enable, std::memory_order_release);
+    }
+
+    /*! Returns true if events are recorded */
+    bool isEnabled() const {
+      return m_enabled.load(std::memory_order_relaxed);
+    }
+
+    /*! Monotonic time in ns, time base of all events */
+    static uint64_t nowNs() {
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    /*! Record an event with known start and end time */
+    void complete(const char* name, uint64_t startNs, uint64_t endNs, uint64_t arg = 0) {
+      record('X', name, startNs, endNs - startNs, arg, 0);
+    }
+
+    /*! Record an instant event */
+    void instant(const char* name, uint64_t arg = 0) {
+      record('i', name, nowNs(), 0, arg, 0);
+    }
+
+    /*! Begin an asynchronous event, which may end in another thread */
+    void asyncBegin(const char* name, uint32_t id, uint64_t arg = 0) {
+      record('b', name, nowNs(), 0, arg, id);
+    }
+
+    /*! End an asynchronous event */
+    void asyncEnd(const char* name, uint32_t id, uint64_t arg = 0) {
+      record('e', name, nowNs(), 0, arg, id);
+    }
+
+    /*! Write the recorded events as Chrome Trace Event JSON.
+        May be called while recording, events overwritten during the
+        dump are skipped. Returns true if an error occurs */
+    bool dump(const std::string& fileName) {
+
+      FILE* f = fopen(fileName.c_str(), "w");
+      if (!f) {
+        perr_errno_ffl("Cannot open trace file %s\n", fileName.c_str());
+        return true;
+      }
+
+      fprintf(f, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+      bool first = true;
+      int pid = getpid();
+      std::vector<CycleTraceEvent> copy;
+
+      for (uint32_t t = 0; t < CYCLE_TRACE_MAX_THREADS; t++) {
+
+        ThreadBuffer& b = m_threads[t];
+        int tid = b.tid.load(std::memory_order_acquire);
+        if (tid <= 0 || b.events.empty()) {
+          continue;
+        }
+
+        fprintf(f, "%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                first ? "" : ",\n", pid, tid, b.name);
+        first = false;
+
+        // copy the valid part of the ring, then drop what was overwritten meanwhile
+        uint64_t head = b.head.load(std::memory_order_acquire);
+        uint64_t begin = head > m_size ? head - m_size : 0;
+        copy.resize(head - begin);
+        for (uint64_t i = begin; i < head; i++) {
+          copy[i - begin] = b.events[i % m_size];
+        }
+        uint64_t headAfter = b.head.load(std::memory_order_acquire);
+        uint64_t valid = headAfter > m_size ? headAfter - m_size : 0;
+
+        for (uint64_t i = (valid > begin ? valid : begin); i < head; i++) {
+          const CycleTraceEvent& e = copy[i - begin];
+          fprintf(f, ",\n{\"ph\":\"%c\",\"name\":\"%s\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f",
+                  e.ph, e.name ? e.name : "?", pid, tid, e.tsNs * 1e-3);
+          if (e.ph == 'X') {
+            fprintf(f, ",\"dur\":%.3f", e.durNs * 1e-3);
+          } else if (e.ph == 'i') {
+            fprintf(f, ",\"s\":\"t\"");
+          } else {
+            fprintf(f, ",\"cat\":\"async\",\"id\":%u", e.id);
+          }
+          fprintf(f, ",\"args\":{\"arg\":%llu}}", (unsigned long long) e.arg);
+        }
+      }
+
+      fprintf(f, "\n]}\n");
+      if (fclose(f) != 0) {
+        perr_errno_ffl("Cannot write trace file %s\n", fileName.c_str());
+        return true;
+      }
+      return false;
+    }
+
+  private:
+
+    //! tid of a ring, which is being claimed
+    static const int CLAIMING = -1;
+
+    struct ThreadBuffer {
+      std::atomic<int>              tid{0};     //!< owner thread, 0 if unused
+      char                          name[16];   //!< owner thread name
+      std::atomic<uint64_t>         head{0};    //!< number of recorded events
+      std::vector<CycleTraceEvent>  events;
+    };
+
+    //! Write one event to the ring of the calling thread
+    void record(char ph, const char* name, uint64_t tsNs, uint64_t durNs, uint64_t arg, uint32_t id) {
+
+      if (!m_enabled.load(std::memory_order_relaxed)) {
+        return;
+      }
+
+      ThreadBuffer* b = threadBuffer();
+      if (!b) {
+        return;
+      }
+
+      uint64_t head = b->head.load(std::memory_order_relaxed);
+      CycleTraceEvent& e = b->events[head % m_size];
+      e.tsNs = tsNs;
+      e.durNs = durNs;
+      e.name = name;
+      e.arg = arg;
+      e.id = id;
+      e.ph = ph;
+      b->head.store(head + 1, std::memory_order_release);
+    }
+
+    //! Find or claim the ring of the calling thread, NULL if all rings are used
+    ThreadBuffer* threadBuffer() {
+
+      static thread_local int tid = 0;
+      if (tid == 0) {
+        tid = (int) syscall(SYS_gettid);
+      }
+
+      for (uint32_t i = 0; i < CYCLE_TRACE_MAX_THREADS; i++) {
+
+        ThreadBuffer& b = m_threads[i];
+        int owner = b.tid.load(std::memory_order_acquire);
+
+        if (owner == tid) {
+          return &b;
+        }
+        if (owner == 0 && b.tid.compare_exchange_strong(owner, CLAIMING, std::memory_order_acq_rel)) {
+          // set the name before the tid is published, dump() reads it after the tid
+          if (pthread_getname_np(pthread_self(), b.name, sizeof(b.name)) != 0) {
+            snprintf(b.name, sizeof(b.name), "%d", tid);
+          }
+          b.tid.store(tid, std::memory_order_release);
+          return &b;
+        }
+      }
+      return NULL;
+    }
+
+    const uint32_t          m_size;
+    std::atomic<bool>       m_enabled{false};
+    ThreadBuffer            m_threads[CYCLE_TRACE_MAX_THREADS];
+
+  };
+
+}
+
+#endif /* end of include guard: CYCLETRACER_HPP_5E0A7D13 */
@@ -0,0 +1,212 @@
+//
+//  DcmLog.hpp
+//  am2b
+//
+//  Binary log of the distributed clocks master synchronization (DCM).
+//  The job task pushes one fixed-size record per cycle into a preallocated
+//  ring, a low-priority thread writes the records to a file. Use
+//  dcm_decode to convert the file to CSV.
+//
+//  Copyright 2015 Chair of Applied Mechanics, TUM
+//  https://www.amm.mw.tum.de/
+//
+
+#ifndef DCMLOG_HPP_A3F1C62E
+#define DCMLOG_HPP_A3F1C62E
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <chrono>
+
+#include <xstdio.h>
+#include <iface_prio.hpp>
+
+//! Magic number at the beginning of a DCM log file
+#define DCMLOG_MAGIC          "ECDCMLOG"
+//! File format version
+#define DCMLOG_VERSION        1
+//! Period of the drain thread in ms
+#define DCMLOG_DRAIN_PERIOD_MS  100
+
+namespace ec {
+
+  /*! One DCM status record (one bus cycle) */
+  struct DcmLogRecord {
+    uint64_t  cycle;          //!< master cycle counter
+    uint32_t  busTime;        //!< bus time in ns (lower 32 bit, Inputs.BusTime)
+    int32_t   ctlErrorCur;    //!< current controller error in ns
+    int32_t   ctlErrorAvg;    //!< average controller error in ns
+    int32_t   ctlErrorMax;    //!< maximum controller error in ns
+    int32_t   ctlSetVal;      //!< controller set value in ns
+    uint32_t  status;         //!< DCM status (error code, 0 if in sync)
+    uint8_t   inSync;         //!< 1 if the DCM is in sync
+    uint8_t   reserved[7];
+  };
+
+  static_assert(sizeof(DcmLogRecord) == 40, "DcmLogRecord must not contain padding");
+
+  /*! Header of a DCM log file, followed by the records */
+  struct DcmLogFileHeader {
+    char      magic[8];       //!< DCMLOG_MAGIC
+    uint32_t  version;        //!< DCMLOG_VERSION
+    uint32_t  recordSize;     //!< sizeof(DcmLogRecord)
+    uint32_t  busCycleTimeUs; //!< bus cycle time
+    uint32_t  reserved;
+  };
+
+  /*! Preallocated single-producer/single-consumer ring for DCM records
+      with a low-priority writer thread.
+   */
+  class DcmLog {
+
+  public:
+
+    /*!
+      \param capacity Number of records in the ring, rounded up to a power of 2
+    */
+    DcmLog(uint32_t capacity = 8192) {
+      uint32_t size = 1;
+      while (size < capacity) {
+        size <<= 1;
+      }
+      m_ring.resize(size);
+      m_mask = size - 1;
+    }
+
+    ~DcmLog() {
+      stop();
+    }
+
+    /*! Open the file and start the writer thread. Returns true if an error occurs */
+    bool start(const std::string& file, uint32_t busCycleTimeUs) {
+
+      if (m_running) {
+        return false;
+      }
+
+      m_file = fopen(file.c_str(), "wb");
+      if (!m_file) {
+        perr_ffl("Cannot open DCM log file %s\n", file.c_str());
+        return true;
+      }
+
+      DcmLogFileHeader header;
+      memset(&header, 0, sizeof(header));
+      memcpy(header.magic, DCMLOG_MAGIC, sizeof(header.magic));
+      header.version = DCMLOG_VERSION;
+      header.recordSize = sizeof(DcmLogRecord);
+      header.busCycleTimeUs = busCycleTimeUs;
+      fwrite(&header, sizeof(header), 1, m_file);
+
+      m_head = 0;
+      m_tail = 0;
+      m_lost = 0;
+      m_running = true;
+      m_thread = std::thread(&DcmLog::run, this);
+      return false;
+    }
+
+    /*! Write the remaining records, stop the thread and close the file */
+    void stop() {
+
+      if (!m_running) {
+        return;
+      }
+
+      m_running = false;
+      m_thread.join();
+
+      if (m_lost) {
+        pwrn("DCM log: %llu records lost\n", (unsigned long long) m_lost.load());
+      }
+
+      fclose(m_file);
+      m_file = NULL;
+    }
+
+    /*! Add a record. Real-time safe (no locks, no allocation, no I/O).
+        The record is dropped and counted if the ring is full. */
+    void push(const DcmLogRecord& record) {
+
+      if (!m_running) {
+        return;
+      }
+
+      uint64_t head = m_head.load(std::memory_order_relaxed);
+      if (head - m_tail.load(std::memory_order_acquire) > m_mask) {
+        m_lost.fetch_add(1, std::memory_order_relaxed);
+        return;
+      }
+
+      m_ring[head & m_mask] = record;
+      m_head.store(head + 1, std::memory_order_release);
+    }
+
+    /*! Returns the number of dropped records */
+    uint64_t getLost() const {
+      return m_lost.load(std::memory_order_relaxed);
+    }
+
+    /*! Returns true if logging is active */
+    bool isRunning() const {
+      return m_running;
+    }
+
+  private:
+
+    //! Writer thread
+    void run() {
+
+      SET_PRIO(PRIO_LOG());
+
+      while (m_running) {
+        drain();
+        std::this_thread::sleep_for(std::chrono::milliseconds(DCMLOG_DRAIN_PERIOD_MS));
+      }
+      drain();
+      fflush(m_file);
+    }
+
+    //! Write all pending records to the file
+    void drain() {
+
+      uint64_t tail = m_tail.load(std::memory_order_relaxed);
+      uint64_t head = m_head.load(std::memory_order_acquire);
+
+      while (tail != head) {
+        // contiguous block up to the end of the ring
+        uint64_t idx = tail & m_mask;
+        uint64_t n = head - tail;
+        if (idx + n > m_ring.size()) {
+          n = m_ring.size() - idx;
+        }
+
+        fwrite(&m_ring[idx], sizeof(DcmLogRecord), n, m_file);
+        tail += n;
+        m_tail.store(tail, std::memory_order_release);
+      }
+    }
+
+    std::vector<DcmLogRecord>   m_ring;
+    uint64_t                    m_mask;
+
+    //! written by the job task
+    std::atomic<uint64_t>       m_head{0};
+    //! written by the writer thread
+    std::atomic<uint64_t>       m_tail{0};
+    std::atomic<uint64_t>       m_lost{0};
+
+    std::atomic<bool>           m_running{false};
+    std::thread                 m_thread;
+    FILE*                       m_file = NULL;
+
+  };
+
+}
+
+#endif /* end of include guard: DCMLOG_HPP_A3F1C62E */
@@ -0,0 +1,488 @@
+//
+//  EniVarDirectory.hpp
+//  am2b
+//
+//  Streaming reader for EtherCAT network information (ENI) files.
+//  Extracts the process variable table and the slave list into
+//  a compact hashed directory, independent of the master stack.
+//
+//  Copyright 2015 Chair of Applied Mechanics, TUM
+//  https://www.amm.mw.tum.de/
+//
+
+#ifndef ENIVARDIRECTORY_HPP_3C81E0B7
+#define ENIVARDIRECTORY_HPP_3C81E0B7
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include <xstdio.h>
+
+namespace ec {
+
+  /* CoE data type codes (identical to the DEFTYPE_* values of the stack) */
+  #define ENI_DEFTYPE_NULL          0x0000
+  #define ENI_DEFTYPE_BOOLEAN       0x0001
+  #define ENI_DEFTYPE_INTEGER8      0x0002
+  #define ENI_DEFTYPE_INTEGER16     0x0003
+  #define ENI_DEFTYPE_INTEGER32     0x0004
+  #define ENI_DEFTYPE_UNSIGNED8     0x0005
+  #define ENI_DEFTYPE_UNSIGNED16    0x0006
+  #define ENI_DEFTYPE_UNSIGNED32    0x0007
+  #define ENI_DEFTYPE_REAL32        0x0008
+  #define ENI_DEFTYPE_REAL64        0x0011
+  #define ENI_DEFTYPE_INTEGER64     0x0015
+  #define ENI_DEFTYPE_UNSIGNED64    0x001B
+
+  //! Read buffer size of the streaming XML reader
+  #define ENI_READ_BUFFER_SIZE      0x4000
+
+  /*! Process variable entry of the ENI process image */
+  struct EniVar {
+    uint32_t  nameOffset;   //!< offset of the full name in the name pool
+    uint32_t  nameLength;   //!< length of the full name
+    uint32_t  bitOffset;    //!< bit offset in the input or output process image
+    uint32_t  bitSize;      //!< size in bits
+    uint16_t  dataType;     //!< CoE data type code (ENI_DEFTYPE_*)
+    bool      isOutput;     //!< output (true) or input (false) process image
+  };
+
+  /*! Slave entry of the ENI configuration */
+  struct EniSlave {
+    std::string name;           //!< slave name (prefix of the variable names)
+    uint16_t    physAddr;       //!< station address
+    uint16_t    autoIncAddr;    //!< auto increment address
+    uint32_t    vendorId;       //!< vendor id
+    uint32_t    productCode;    //!< product code
+  };
+
+  /*! Hashed directory of the ENI process variables
+
+      Variables are looked up with the slave name and the variable name
+      separately, so linking a variable neither allocates nor builds the
+      fully qualified identifier.
+   */
+  class EniVarDirectory {
+
+  public:
+
+    /*! Parse the given ENI file. Returns true if an error occurs */
+    bool load(const std::string& eniFile) {
+
+      clear();
+
+      FILE* f = fopen(eniFile.c_str(), "r");
+      if (f == NULL) {
+        perr("EniVarDirectory: Cannot open ENI file %s: %s\n", eniFile.c_str(), strerror(errno));
+        return true;
+      }
+
+      bool err = parse(f);
+      fclose(f);
+
+      if (err) {
+        perr("EniVarDirectory: Error parsing ENI file %s\n", eniFile.c_str());
+        clear();
+        return true;
+      }
+
+      buildHashTable();
+      m_loaded = true;
+      return false;
+    }
+
+    /*! Remove all entries */
+    void clear() {
+      m_vars.clear();
+      m_slaves.clear();
+      m_names.clear();
+      m_table.clear();
+      m_inputByteSize = 0;
+      m_outputByteSize = 0;
+      m_loaded = false;
+    }
+
+    /*! Returns true if an ENI file was loaded successfully */
+    bool isLoaded() const {
+      return m_loaded;
+    }
+
+    /*! Find the variable <slaveName>.<varName> in the input or output image.
+        Returns NULL if not found. */
+    const EniVar* find(const std::string& slaveName, const std::string& varName, bool isOutput) const {
+
+      if (m_table.empty()) {
+        return NULL;
+      }
+
+      uint64_t hash = hashName(slaveName.c_str(), slaveName.size(), varName.c_str(), varName.size(), isOutput);
+      size_t mask = m_table.size() - 1;
+      size_t nameLength = slaveName.size() + 1 + varName.size();
+
+      for (size_t idx = hash & mask; m_table[idx].varIndex != INVALID_INDEX; idx = (idx + 1) & mask) {
+
+        const HashEntry& entry = m_table[idx];
+        if (entry.hash != hash) {
+          continue;
+        }
+
+        // verify the name to rule out collisions
+        const EniVar& var = m_vars[entry.varIndex];
+        const char* name = &m_names[var.nameOffset];
+        if (var.isOutput == isOutput && var.nameLength == nameLength
+            && memcmp(name, slaveName.c_str(), slaveName.size()) == 0
+            && name[slaveName.size()] == '.'
+            && memcmp(name + slaveName.size() + 1, varName.c_str(), varName.size()) == 0) {
+          return &var;
+        }
+      }
+
+      return NULL;
+    }
+
+    /*! Find the variable with the fully qualified name. Returns NULL if not found. */
+    const EniVar* find(const std::string& fullName, bool isOutput) const {
+
+      size_t dot = splitName(fullName.c_str(), fullName.size());
+      if (dot >= fullName.size()) {
+        return NULL;
+      }
+      return find(fullName.substr(0, dot), fullName.substr(dot + 1), isOutput);
+    }
+
+    /*! Returns the full name of the given variable */
+    std::string getName(const EniVar& var) const {
+      return std::string(&m_names[var.nameOffset], var.nameLength);
+    }
+
+    /*! All process variables in file order */
+    const std::vector<EniVar>& getVars() const {
+      return m_vars;
+    }
+
+    /*! All slaves in file order */
+    const std::vector<EniSlave>& getSlaves() const {
+      return m_slaves;
+    }
+
+    /*! Size of the input process image in bytes */
+    uint32_t getInputByteSize() const {
+      return m_inputByteSize;
+    }
+
+    /*! Size of the output process image in bytes */
+    uint32_t getOutputByteSize() const {
+      return m_outputByteSize;
+    }
+
+    /*! Map an ENI data type name to the CoE data type code */
+    static uint16_t dataTypeFromString(const std::string& str) {
+
+      if (str == "BOOL" || str == "BIT") return ENI_DEFTYPE_BOOLEAN;
+      if (str == "SINT") return ENI_DEFTYPE_INTEGER8;
+      if (str == "INT") return ENI_DEFTYPE_INTEGER16;
+      if (str == "DINT") return ENI_DEFTYPE_INTEGER32;
+      if (str == "LINT") return ENI_DEFTYPE_INTEGER64;
+      if (str == "USINT" || str == "BYTE") return ENI_DEFTYPE_UNSIGNED8;
+      if (str == "UINT" || str == "WORD") return ENI_DEFTYPE_UNSIGNED16;
+      if (str == "UDINT" || str == "DWORD") return ENI_DEFTYPE_UNSIGNED32;
+      if (str == "ULINT" || str == "LWORD") return ENI_DEFTYPE_UNSIGNED64;
+      if (str == "REAL") return ENI_DEFTYPE_REAL32;
+      if (str == "LREAL") return ENI_DEFTYPE_REAL64;
+
+      // arrays and unknown types
+      return ENI_DEFTYPE_NULL;
+    }
+
+  private:
+
+    //! Marks an empty slot in the hash table
+    static const uint32_t INVALID_INDEX = 0xFFFFFFFF;
+
+    /*! Open addressing hash table slot */
+    struct HashEntry {
+      uint64_t  hash;
+      uint32_t  varIndex;
+    };
+
+    /*! FNV-1a hash of "<prefix>.<suffix>" and the direction.
+        Equals the hash of the full name, independent of where it is split */
+    static uint64_t hashName(const char* prefix, size_t prefixLen, const char* suffix, size_t suffixLen, bool isOutput) {
+
+      uint64_t hash = hashBytes(14695981039346656037ULL, prefix, prefixLen);
+      hash = hashBytes(hash, ".", 1);
+      hash = hashBytes(hash, suffix, suffixLen);
+      return (hash ^ (isOutput ? 1 : 0)) * 1099511628211ULL;
+    }
+
+    //! FNV-1a step over the given bytes
+    static uint64_t hashBytes(uint64_t hash, const char* str, size_t len) {
+      for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ (uint8_t) str[i]) * 1099511628211ULL;
+      }
+      return hash;
+    }
+
+    /*! Create the hash table with a load factor <= 0.5 */
+    void buildHashTable() {
+
+      size_t size = 16;
+      while (size < 2*m_vars.size()) {
+        size *= 2;
+      }
+
+      HashEntry empty = {0, INVALID_INDEX};
+      m_table.assign(size, empty);
+
+      for (uint32_t i = 0; i < m_vars.size(); i++) {
+
+        const EniVar& var = m_vars[i];
+        const char* name = &m_names[var.nameOffset];
+
+        // hash of the full name, see hashName()
+        uint64_t hash = (hashBytes(14695981039346656037ULL, name, var.nameLength) ^ (var.isOutput ? 1 : 0)) * 1099511628211ULL;
+
+        size_t idx = hash & (size - 1);
+        while (m_table[idx].varIndex != INVALID_INDEX) {
+          idx = (idx + 1) & (size - 1);
+        }
+        m_table[idx].hash = hash;
+        m_table[idx].varIndex = i;
+      }
+    }
+
+    /*! Returns the position of the '.' separating slave and variable name.
+        Slave names end with "]" (e.g. "Slave_1005 [Elmo Drive ]"), otherwise the first '.' is used. */
+    static size_t splitName(const char* name, size_t len) {
+
+      for (size_t i = 0; i + 1 < len; i++) {
+        if (name[i] == ']' && name[i+1] == '.') {
+          return i + 1;
+        }
+      }
+      const char* dot = (const char*) memchr(name, '.', len);
+      return dot ? (size_t)(dot - name) : len;
+    }
+
+    /*! Streaming parser. Keeps track of the element path and evaluates
+        the text of the leaf elements of interest. */
+    bool parse(FILE* f) {
+
+      char buf[ENI_READ_BUFFER_SIZE];
+      std::vector<std::string> path;
+      std::string tag, text;
+      bool inTag = false;
+
+      // current entries
+      EniVar var;
+      std::string varName, varType;
+      EniSlave slave;
+      bool inVar = false;
+
+      size_t n;
+      while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+
+        for (size_t i = 0; i < n; i++) {
+
+          char c = buf[i];
+
+          if (!inTag) {
+
+            if (c == '<') {
+              inTag = true;
+              tag.clear();
+            } else {
+              text.push_back(c);
+            }
+            continue;
+          }
+
+          tag.push_back(c);
+
+          // comments, declarations and CDATA end with a matching sequence
+          if (tag.compare(0, 3, "!--") == 0) {
+            if (tag.size() >= 5 && tag.compare(tag.size() - 3, 3, "-->") == 0) {
+              inTag = false;
+            }
+            continue;
+          }
+          if (tag.compare(0, 8, "![CDATA[") == 0) {
+            if (tag.size() >= 10 && tag.compare(tag.size() - 3, 3, "]]>") == 0) {
+              text.append(tag, 8, tag.size() - 11);
+              inTag = false;
+            }
+            continue;
+          }
+          if (c != '>') {
+            continue;
+          }
+          inTag = false;
+
+          // processing instruction / doctype
+          if (tag[0] == '?' || tag[0] == '!') {
+            continue;
+          }
+
+          bool closing = (tag[0] == '/');
+          bool selfClosing = (tag.size() >= 2 && tag[tag.size() - 2] == '/');
+          std::string name = tag.substr(closing ? 1 : 0);
+          name = name.substr(0, name.find_first_of(" \t\r\n/>"));
+
+          if (!closing) {
+
+            path.push_back(name);
+            text.clear();
+
+            if (isVariable(path)) {
+              inVar = true;
+              varName.clear();
+              varType.clear();
+              memset(&var, 0, sizeof(var));
+              var.isOutput = (path[path.size() - 2] == "Outputs");
+            } else if (isSlave(path)) {
+              slave = EniSlave();
+            }
+
+            if (!selfClosing) {
+              continue;
+            }
+          }
+
+          if (path.empty() || path.back() != name) {
+            perr("EniVarDirectory: Malformed XML, unexpected closing tag %s\n", name.c_str());
+            return true;
+          }
+
+          // leaf values
+          decodeEntities(text);
+          trim(text);
+
+          if (inVar && path.size() >= 2 && path[path.size() - 2] == "Variable") {
+
+            if (name == "Name") {
+              varName = text;
+            } else if (name == "DataType") {
+              varType = text;
+            } else if (name == "BitSize") {
+              var.bitSize = (uint32_t) strtoul(text.c_str(), NULL, 0);
+            } else if (name == "BitOffs") {
+              var.bitOffset = (uint32_t) strtoul(text.c_str(), NULL, 0);
+            }
+
+          } else if (name == "ByteSize" && path.size() >= 3 && path[path.size() - 3] == "ProcessImage") {
+
+            if (path[path.size() - 2] == "Inputs") {
+              m_inputByteSize = (uint32_t) strtoul(text.c_str(), NULL, 0);
+            } else {
+              m_outputByteSize = (uint32_t) strtoul(text.c_str(), NULL, 0);
+            }
+
+          } else if (path.size() >= 3 && path[path.size() - 2] == "Info" && path[path.size() - 3] == "Slave") {
+
+            if (name == "Name") {
+              slave.name = text;
+            } else if (name == "PhysAddr") {
+              slave.physAddr = (uint16_t) strtoul(text.c_str(), NULL, 0);
+            } else if (name == "AutoIncAddr") {
+              slave.autoIncAddr = (uint16_t) strtol(text.c_str(), NULL, 0);
+            } else if (name == "VendorId") {
+              slave.vendorId = (uint32_t) strtoul(text.c_str(), NULL, 0);
+            } else if (name == "ProductCode") {
+              slave.productCode = (uint32_t) strtoul(text.c_str(), NULL, 0);
+            }
+          }
+
+          // end of a variable / slave
+          if (inVar && isVariable(path)) {
+
+            inVar = false;
+            var.dataType = dataTypeFromString(varType);
+            var.nameOffset = (uint32_t) m_names.size();
+            var.nameLength = (uint32_t) varName.size();
+            m_names.insert(m_names.end(), varName.begin(), varName.end());
+            m_vars.push_back(var);
+
+          } else if (isSlave(path)) {
+            m_slaves.push_back(slave);
+          }
+
+          path.pop_back();
+          text.clear();
+        }
+      }
+
+      if (!path.empty()) {
+        perr("EniVarDirectory: Unexpected end of file in element %s\n", path.back().c_str());
+        return true;
+      }
+
+      return false;
+    }
+
+    //! path ends with ProcessImage/(Inputs|Outputs)/Variable
+    static bool isVariable(const std::vector<std::string>& path) {
+      size_t n = path.size();
+      return (n >= 3 && path[n-1] == "Variable" && path[n-3] == "ProcessImage"
+              && (path[n-2] == "Inputs" || path[n-2] == "Outputs"));
+    }
+
+    //! path ends with Config/Slave
+    static bool isSlave(const std::vector<std::string>& path) {
+      size_t n = path.size();
+      return (n >= 2 && path[n-1] == "Slave" && path[n-2] == "Config");
+    }
+
+    //! Replace the predefined XML entities
+    static void decodeEntities(std::string& str) {
+
+      static const char* entities[][2] = { {"&lt;", "<"}, {"&gt;", ">"}, {"&quot;", "\""}, {"&apos;", "'"}, {"&amp;", "&"} };
+
+      if (str.find('&') == std::string::npos) {
+        return;
+      }
+      for (unsigned int e = 0; e < 5; e++) {
+        size_t pos = 0;
+        while ((pos = str.find(entities[e][0], pos)) != std::string::npos) {
+          str.replace(pos, strlen(entities[e][0]), entities[e][1]);
+          pos++;
+        }
+      }
+    }
+
+    //! Remove leading and trailing whitespace
+    static void trim(std::string& str) {
+      size_t first = str.find_first_not_of(" \t\r\n");
+      if (first == std::string::npos) {
+        str.clear();
+        return;
+      }
+      str = str.substr(first, str.find_last_not_of(" \t\r\n") - first + 1);
+    }
+
+    //! Process variables in file order
+    std::vector<EniVar>     m_vars;
+
+    //! Slaves in file order
+    std::vector<EniSlave>   m_slaves;
+
+    //! Pool with all variable names
+    std::vector<char>       m_names;
+
+    //! Open addressing hash table
+    std::vector<HashEntry>  m_table;
+
+    //! Process image sizes in bytes
+    uint32_t                m_inputByteSize = 0;
+    uint32_t                m_outputByteSize = 0;
+
+    //! ENI file loaded?
+    bool                    m_loaded = false;
+
+  };
+
+}
+
+#endif /* end of include guard: ENIVARDIRECTORY_HPP_3C81E0B7 */
@@ -0,0 +1,192 @@
+//
+//  KeyedLogLimiter.hpp
+//  am2b
+//
+//  Token-bucket rate limiting of log messages, keyed by event code and
+//  slave. Suppressed messages are counted and reported in periodic
+//  summaries instead of being dropped silently.
+//
+//  Copyright 2015 Chair of Applied Mechanics, TUM
+//  https://www.amm.mw.tum.de/
+//
+
+#ifndef KEYEDLOGLIMITER_HPP_71D3B0A5
+#define KEYEDLOGLIMITER_HPP_71D3B0A5
+
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+
+//! Number of distinct (code, slave) keys. The last entry collects all keys which don't fit
+#define KEYED_LOG_LIMITER_SIZE      128
+
+//! Slave value for events, which are not related to a slave
+#define KEYED_LOG_NO_SLAVE          0xFFFFFFFF
+
+namespace ec {
+
+  /*! Rate limiter for log messages with one token bucket per (code, slave).
+
+      Each key may log burst messages at once, afterwards one message per
+      refillMs. allow() and summarize() may be called concurrently from
+      any thread, allow() is real-time safe (no locks, no allocation).
+   */
+  class KeyedLogLimiter {
+
+  public:
+
+    /*!
+    \param burst Number of messages per key, which are logged without limitation
+    \param refillMs One additional message per key is allowed after this time
+    \param summaryPeriodMs Minimum time between two summaries
+    */
+    KeyedLogLimiter(uint32_t burst, uint32_t refillMs, uint32_t summaryPeriodMs)
+      : m_burst(burst), m_refillMs(refillMs), m_summaryPeriodNs((int64_t) summaryPeriodMs*1000000) {
+
+      for (uint32_t i = 0; i < KEYED_LOG_LIMITER_SIZE; i++) {
+        m_entries[i].key.store(EMPTY_KEY, std::memory_order_relaxed);
+      }
+      m_lastSummaryNs.store(nowNs(), std::memory_order_relaxed);
+    }
+
+    /*! Count an occurrence of the event. Returns true if it should be logged.
+        \param name Description of the event. Must be a string literal, used for the summary
+    */
+    bool allow(uint32_t code, uint32_t slave, const char* name) {
+
+      Entry& e = lookup(((uint64_t) code << 32) | slave, name);
+      int64_t now = nowNs();
+
+      // refill, only one caller adds the tokens for the elapsed time
+      int64_t last = e.lastNs.load(std::memory_order_relaxed);
+      if (now > last && e.lastNs.compare_exchange_strong(last, now, std::memory_order_relaxed)) {
+
+        int64_t elapsed = now - last;
+        int64_t max = (int64_t) m_burst * TOKEN;
+        if (elapsed > max * m_refillMs) {
+          elapsed = max * m_refillMs;   // avoids overflow, bucket is full anyway
+        }
+        int64_t add = elapsed / m_refillMs;   // TOKEN per ms = 1 per ns
+
+        int64_t tokens = e.tokens.load(std::memory_order_relaxed);
+        int64_t refilled;
+        do {
+          refilled = tokens + add;
+          if (refilled > max) {
+            refilled = max;
+          }
+        } while (!e.tokens.compare_exchange_weak(tokens, refilled, std::memory_order_relaxed));
+      }
+
+      // take a token
+      if (e.tokens.fetch_sub(TOKEN, std::memory_order_relaxed) >= TOKEN) {
+        return true;
+      }
+      e.tokens.fetch_add(TOKEN, std::memory_order_relaxed);
+      e.suppressed.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+
+    /*! Report all suppressed events if the summary period has elapsed.
+        Calls print(name, code, slave, count, periodSec) for each key with
+        suppressed messages. Call periodically from a non-RT thread.
+    */
+    template<class Print>
+    void summarize(Print print) {
+
+      int64_t now = nowNs();
+      int64_t last = m_lastSummaryNs.load(std::memory_order_relaxed);
+      if (now - last < m_summaryPeriodNs ||
+          !m_lastSummaryNs.compare_exchange_strong(last, now, std::memory_order_relaxed)) {
+        return;
+      }
+
+      double periodSec = (double) (now - last) * 1e-9;
+
+      for (uint32_t i = 0; i < KEYED_LOG_LIMITER_SIZE; i++) {
+
+        Entry& e = m_entries[i];
+        uint64_t key = e.key.load(std::memory_order_acquire);
+        if (key == EMPTY_KEY) {
+          continue;
+        }
+
+        uint32_t count = e.suppressed.exchange(0, std::memory_order_relaxed);
+        if (count > 0) {
+          const char* name = e.name.load(std::memory_order_acquire);
+          print(name ? name : "event", (uint32_t) (key >> 32), (uint32_t) key, count, periodSec);
+        }
+      }
+    }
+
+  private:
+
+    //! one token in the buckets (fixed point)
+    static const int64_t TOKEN = 1000000;
+
+    //! marks unused entries
+    static const uint64_t EMPTY_KEY = ~((uint64_t) 0);
+
+    //! key of the shared entry (code 0xFFFFFFFF is reserved)
+    static const uint64_t OTHER_KEY = ((uint64_t) 0xFFFFFFFF << 32);
+
+    struct Entry {
+      std::atomic<uint64_t>     key;
+      std::atomic<const char*>  name{nullptr};
+      std::atomic<int64_t>      tokens{0};
+      std::atomic<int64_t>      lastNs{0};
+      std::atomic<uint32_t>     suppressed{0};
+    };
+
+    //! monotonic time in ns
+    static int64_t nowNs() {
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    //! find or insert the entry for key (open addressing, entries are never removed)
+    Entry& lookup(uint64_t key, const char* name) {
+
+      uint32_t h = (uint32_t) ((key * 0x9E3779B97F4A7C15ULL) >> 32);
+
+      for (uint32_t n = 0; n < KEYED_LOG_LIMITER_SIZE - 1; n++) {
+
+        Entry& e = m_entries[(h + n) % (KEYED_LOG_LIMITER_SIZE - 1)];
+        uint64_t cur = e.key.load(std::memory_order_acquire);
+
+        if (cur == key) {
+          return e;
+        }
+        if (cur == EMPTY_KEY) {
+          if (e.key.compare_exchange_strong(cur, key, std::memory_order_acq_rel)) {
+            e.name.store(name, std::memory_order_release);
+            return e;
+          }
+          if (cur == key) {
+            return e;   // inserted concurrently
+          }
+        }
+      }
+
+      // table full, shared entry
+      Entry& e = m_entries[KEYED_LOG_LIMITER_SIZE - 1];
+      uint64_t cur = EMPTY_KEY;
+      if (e.key.compare_exchange_strong(cur, OTHER_KEY, std::memory_order_acq_rel)) {
+        e.name.store("other events", std::memory_order_release);
+      }
+      return e;
+    }
+
+    Entry                   m_entries[KEYED_LOG_LIMITER_SIZE];
+
+    const uint32_t          m_burst;
+    const uint32_t          m_refillMs;
+    const int64_t           m_summaryPeriodNs;
+
+    std::atomic<int64_t>    m_lastSummaryNs{0};
+
+  };
+
+}
+
+#endif /* end of include guard: KEYEDLOGLIMITER_HPP_71D3B0A5 */
@@ -0,0 +1,97 @@
+//
+//  LockFreeQueue.hpp
+//  am2b
+//
+//  Bounded lock-free queue for POD elements. Any number of producers,
+//  one consumer. Neither side blocks or allocates after construction.
+//
+//  Copyright 2015 Chair of Applied Mechanics, TUM
+//  https://www.amm.mw.tum.de/
+//
+
+#ifndef LOCKFREEQUEUE_HPP_2B7C90E4
+#define LOCKFREEQUEUE_HPP_2B7C90E4
+
+#include <stdint.h>
+#include <atomic>
+
+namespace ec {
+
+  /*! Bounded multi-producer/single-consumer queue.
+      Each slot carries a sequence number, which tells producers and the
+      consumer whether the slot is free or filled for the current round.
+      \tparam T POD element type
+      \tparam Size number of slots, must be a power of 2
+   */
+  template<typename T, uint32_t Size>
+  class LockFreeQueue {
+
+    static_assert(Size >= 2 && (Size & (Size - 1)) == 0, "Size must be a power of 2");
+
+  public:
+
+    LockFreeQueue() {
+      for (uint32_t i = 0; i < Size; i++) {
+        m_slots[i].seq.store(i, std::memory_order_relaxed);
+      }
+    }
+
+    /*! Add an element. Returns false if the queue is full */
+    bool push(const T& data) {
+
+      uint32_t pos = m_head.load(std::memory_order_relaxed);
+
+      for (;;) {
+        Slot& slot = m_slots[pos & (Size - 1)];
+        int32_t diff = (int32_t) (slot.seq.load(std::memory_order_acquire) - pos);
+
+        if (diff == 0) {
+          // slot is free, try to claim it
+          if (m_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+            slot.data = data;
+            slot.seq.store(pos + 1, std::memory_order_release);
+            return true;
+          }
+        } else if (diff < 0) {
+          return false;   // full
+        } else {
+          pos = m_head.load(std::memory_order_relaxed);
+        }
+      }
+    }
+
+    /*! Remove the oldest element. Returns false if the queue is empty.
+        Must only be called from one thread. */
+    bool pop(T& data) {
+
+      Slot& slot = m_slots[m_tail & (Size - 1)];
+      if ((int32_t) (slot.seq.load(std::memory_order_acquire) - (m_tail + 1)) < 0) {
+        return false;
+      }
+
+      data = slot.data;
+      slot.seq.store(m_tail + Size, std::memory_order_release);
+      m_tail++;
+      return true;
+    }
+
+  private:
+
+    struct Slot {
+      std::atomic<uint32_t>   seq;
+      T                       data;
+    };
+
+    Slot                    m_slots[Size];
+
+    //! next slot to claim by a producer
+    alignas(64) std::atomic<uint32_t>   m_head{0};
+
+    //! next slot to read by the consumer
+    alignas(64) uint32_t                m_tail = 0;
+
+  };
+
+}
+
+#endif /* end of include guard: LOCKFREEQUEUE_HPP_2B7C90E4 */
@@ -0,0 +1,149 @@
+//
+//  SetpointQueue.hpp
+//  am2b
+//
+//  Timestamped setpoints from a control thread to the job task. The control
+//  thread queues setpoints for future bus cycles ahead of time, the job task
+//  samples the queue every cycle (see CycleCallback.hpp) and applies the
+//  setpoint of exactly that cycle, optionally interpolated.
+//
+//  Copyright 2015 Chair of Applied Mechanics, TUM
+//  https://www.amm.mw.tum.de/
+//
+
+#ifndef SETPOINTQUEUE_HPP_6A3C58E1
+#define SETPOINTQUEUE_HPP_6A3C58E1
+
+#include <stdint.h>
+#include <atomic>
+
+#include "LockFreeQueue.hpp"
+
+namespace ec {
+
+  /*! Setpoint of one drive for one bus cycle (raw units) */
+  struct Setpoint {
+    uint64_t  cycle;            //!< bus cycle counter (BusMaster::getCycleCounter()) the setpoint is sent in
+    double    position;         //!< desired position
+    double    velocityOffset;   //!< velocity feedforward in position units per second
+    double    torqueOffset;     //!< torque / current feedforward
+  };
+
+  /*! Behaviour between two queued setpoints */
+  enum class SetpointInterpolation {
+    HOLD,       //!< keep the last setpoint until the next one is due
+    LINEAR,     //!< linear in all values
+    CUBIC       //!< cubic Hermite position with the velocity offsets as slopes, linear otherwise
+  };
+
+  /*! Queue of setpoints with increasing cycle numbers.
+
+      push() may be called from any thread, sample() only from the job task.
+      Setpoints which are already in the past when sampled are skipped,
+      after the last setpoint it is held (counted as underrun).
+      \tparam Size number of queued setpoints, power of 2
+   */
+  template<uint32_t Size = 256>
+  class SetpointQueue {
+
+  public:
+
+    /*!
+      \param mode Interpolation between the queued setpoints
+      \param cycleTimeS Bus cycle time in seconds (for CUBIC)
+    */
+    SetpointQueue(SetpointInterpolation mode = SetpointInterpolation::HOLD, double cycleTimeS = 0.001)
+      : m_mode(mode), m_cycleTimeS(cycleTimeS) {
+    }
+
+    /*! Queue a setpoint. The cycles must be increasing.
+        Returns false if the queue is full */
+    bool push(const Setpoint& sp) {
+      return m_queue.push(sp);
+    }
+
+    /*! Setpoint for the given cycle (job task).
+        Returns false if no setpoint is due yet */
+    bool sample(uint64_t cycle, Setpoint& out) {
+
+      // advance until m_prev.cycle <= cycle < m_next.cycle
+      for (;;) {
+        if (!m_haveNext) {
+          if (!m_queue.pop(m_next)) {
+            break;
+          }
+          m_haveNext = true;
+        }
+        if (m_next.cycle > cycle) {
+          break;
+        }
+        // drop setpoints older than the current one
+        if (!m_havePrev || m_next.cycle >= m_prev.cycle) {
+          m_prev = m_next;
+          m_havePrev = true;
+        }
+        m_haveNext = false;
+      }
+
+      if (!m_havePrev) {
+        return false;
+      }
+
+      out = m_prev;
+      out.cycle = cycle;
+
+      if (!m_haveNext) {
+        if (m_prev.cycle < cycle) {
+          m_underruns.fetch_add(1, std::memory_order_relaxed);
+        }
+        return true;
+      }
+
+      if (m_mode == SetpointInterpolation::HOLD) {
+        return true;
+      }
+
+      double span = (double) (m_next.cycle - m_prev.cycle);
+      double s = (double) (cycle - m_prev.cycle) / span;
+
+      out.velocityOffset = m_prev.velocityOffset + s * (m_next.velocityOffset - m_prev.velocityOffset);
+      out.torqueOffset = m_prev.torqueOffset + s * (m_next.torqueOffset - m_prev.torqueOffset);
+
+      if (m_mode == SetpointInterpolation::LINEAR) {
+        out.position = m_prev.position + s * (m_next.position - m_prev.position);
+      } else {
+        // Hermite basis, slopes scaled to the interval length
+        double t = span * m_cycleTimeS;
+        double s2 = s*s, s3 = s2*s;
+        out.position = (2*s3 - 3*s2 + 1) * m_prev.position + (s3 - 2*s2 + s) * t * m_prev.velocityOffset
+                     + (-2*s3 + 3*s2) * m_next.position + (s3 - s2) * t * m_next.velocityOffset;
+      }
+
+      return true;
+    }
+
+    /*! Number of sampled cycles after the last queued setpoint */
+    uint64_t getUnderruns() const {
+      return m_underruns.load(std::memory_order_relaxed);
+    }
+
+  private:
+
+    LockFreeQueue<Setpoint, Size>   m_queue;
+
+    const SetpointInterpolation     m_mode;
+    const double                    m_cycleTimeS;
+
+    /* job task only */
+    Setpoint                        m_prev;
+    Setpoint                        m_next;
+    bool                            m_havePrev = false;
+    bool                            m_haveNext = false;
+
+    std::atomic<uint64_t>           m_underruns{0};
+
+  };
+
+}
+
+#endif /* end of include guard: SETPOINTQUEUE_HPP_6A3C58E1 */
@@ -0,0 +1,89 @@
+//
+//  SimdConvert.hpp
+//  am2b
+//
+//  Vectorised unit conversion of raw PDO values (see ElmoGroup.hpp).
+//  Uses AVX2 or NEON (aarch64) if enabled for the compiler, plain loops
+//  otherwise. Define HWL_SIMD_DISABLE to force the scalar code.
+//
+//  Copyright 2015 Chair of Applied Mechanics, TUM
+//  https://www.amm.mw.tum.de/
+//
+
+#ifndef SIMDCONVERT_HPP_71D4A0E6
+#define SIMDCONVERT_HPP_71D4A0E6
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef HWL_SIMD_DISABLE
+  #if defined(__AVX2__)
+    #include <immintrin.h>
+    #define HWL_SIMD_AVX2
+  #elif defined(__aarch64__) && defined(__ARM_NEON)
+    #include <arm_neon.h>
+    #define HWL_SIMD_NEON
+  #endif
+#endif
+
+namespace ec {
+
+  /*! Name of the selected implementation */
+  inline const char* simdConvertName() {
+  #if defined(HWL_SIMD_AVX2)
+    return "avx2";
+  #elif defined(HWL_SIMD_NEON)
+    return "neon";
+  #else
+    return "scalar";
+  #endif
+  }
+
+  /*! dst[i] = src[i] * scale[i] */
+  inline void simdScaleToDouble(const int32_t* src, const double* scale, double* dst, size_t n) {
+
+    size_t i = 0;
+
+  #if defined(HWL_SIMD_AVX2)
+    for (; i + 4 <= n; i += 4) {
+      __m256d v = _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i*) (src + i)));
+      _mm256_storeu_pd(dst + i, _mm256_mul_pd(v, _mm256_loadu_pd(scale + i)));
+    }
+  #elif defined(HWL_SIMD_NEON)
+    for (; i + 2 <= n; i += 2) {
+      float64x2_t v = vcvtq_f64_s64(vmovl_s32(vld1_s32(src + i)));
+      vst1q_f64(dst + i, vmulq_f64(v, vld1q_f64(scale + i)));
+    }
+  #endif
+
+    for (; i < n; i++) {
+      dst[i] = (double) src[i] * scale[i];
+    }
+  }
+
+  /*! dst[i] = (int32_t) (src[i] * scale[i]), truncated towards zero like the cast.
+      The results must fit into int32_t. */
+  inline void simdScaleToInt32(const double* src, const double* scale, int32_t* dst, size_t n) {
+
+    size_t i = 0;
+
+  #if defined(HWL_SIMD_AVX2)
+    for (; i + 4 <= n; i += 4) {
+      __m256d v = _mm256_mul_pd(_mm256_loadu_pd(src + i), _mm256_loadu_pd(scale + i));
+      _mm_storeu_si128((__m128i*) (dst + i), _mm256_cvttpd_epi32(v));
+    }
+  #elif defined(HWL_SIMD_NEON)
+    for (; i + 2 <= n; i += 2) {
+      float64x2_t v = vmulq_f64(vld1q_f64(src + i), vld1q_f64(scale + i));
+      vst1_s32(dst + i, vmovn_s64(vcvtq_s64_f64(v)));
+    }
+  #endif
+
+    for (; i < n; i++) {
+      dst[i] = (int32_t) (src[i] * scale[i]);
+    }
+  }
+
+}
+
+#endif /* end of include guard: SIMDCONVERT_HPP_71D4A0E6 */
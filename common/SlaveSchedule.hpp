@@ -0,0 +1,116 @@
+//
+//  SlaveSchedule.hpp
+//  am2b
+//
+//  Slots of slaves with a reduced process() rate. A slave with divisor d is
+//  processed in every d-th call of master.process(), in slot phase. Free
+//  phases are chosen so that the slaves are spread evenly over the calls.
+//
+//  Copyright 2015 Chair of Applied Mechanics, TUM
+//  https://www.amm.mw.tum.de/
+//
+
+#ifndef SLAVESCHEDULE_HPP_C4A1E7B9
+#define SLAVESCHEDULE_HPP_C4A1E7B9
+
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+
+//! Maximum schedule period, larger least common multiples use the largest divisor
+#define SLAVE_SCHEDULE_MAX_PERIOD   1024
+
+namespace ec {
+
+  /*! Assign the process() slot of each slave.
+      \param divisors process() rate divisor of each slave (0 is treated as 1)
+      \param phases requested phase of each slave, -1: free
+      \param out assigned phase of each slave, 0..divisor-1
+   */
+  inline void slaveScheduleAssign(const std::vector<uint32_t>& divisors, const std::vector<int32_t>& phases,
+                                  std::vector<uint32_t>& out) {
+
+    size_t n = divisors.size();
+    out.assign(n, 0);
+
+    // period of the schedule: lcm of the divisors
+    uint64_t period = 1;
+    uint32_t maxDivisor = 1;
+    for (uint32_t d : divisors) {
+      d = (d == 0) ? 1 : d;
+      maxDivisor = (d > maxDivisor) ? d : maxDivisor;
+      uint64_t a = period, b = d;
+      while (b) {
+        uint64_t t = a % b;
+        a = b;
+        b = t;
+      }
+      period = period / a * d;
+      if (period > SLAVE_SCHEDULE_MAX_PERIOD) {
+        period = maxDivisor;
+        break;
+      }
+    }
+    // all divisors if the lcm has been capped
+    for (uint32_t d : divisors) {
+      maxDivisor = (d > maxDivisor) ? d : maxDivisor;
+    }
+    if (period < maxDivisor) {
+      period = maxDivisor;
+    }
+
+    // number of slaves processed in each call of the period
+    std::vector<uint32_t> load(period, 0);
+    auto occupy = [&](uint32_t d, uint32_t phase) {
+      for (uint64_t k = phase; k < period; k += d) {
+        load[k]++;
+      }
+    };
+
+    // fixed phases first, then the free ones with the slowest rate first
+    for (size_t i = 0; i < n; i++) {
+      uint32_t d = (divisors[i] == 0) ? 1 : divisors[i];
+      if (phases[i] >= 0) {
+        out[i] = (uint32_t) phases[i] % d;
+        occupy(d, out[i]);
+      }
+    }
+
+    std::vector<size_t> order;
+    for (size_t i = 0; i < n; i++) {
+      if (phases[i] < 0) {
+        order.push_back(i);
+      }
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+      return divisors[a] > divisors[b];
+    });
+
+    for (size_t i : order) {
+
+      uint32_t d = (divisors[i] == 0) ? 1 : divisors[i];
+      uint32_t best = 0;
+      uint64_t bestLoad = UINT64_MAX;
+
+      // slot with the lowest peak load, then the lowest total load
+      for (uint32_t phase = 0; phase < d; phase++) {
+        uint64_t peak = 0, sum = 0;
+        for (uint64_t k = phase; k < period; k += d) {
+          peak = (load[k] > peak) ? load[k] : peak;
+          sum += load[k];
+        }
+        uint64_t cost = (peak << 32) | sum;
+        if (cost < bestLoad) {
+          bestLoad = cost;
+          best = phase;
+        }
+      }
+
+      out[i] = best;
+      occupy(d, best);
+    }
+  }
+
+}
+
+#endif /* end of include guard: SLAVESCHEDULE_HPP_C4A1E7B9 */
@@ -0,0 +1,178 @@
+//
+//  StaticPdo.hpp
+//  am2b
+//
+//  Compile-time PDO layouts. Used by headers generated with eni_codegen
+//  to exchange the process data of a known configuration without runtime
+//  lookup, virtual getSize() calls or per-variable loops.
+//
+//  A static block writes all of its outputs every cycle. Outputs written
+//  through linked bus variables (the dynamic path) must not be part of a
+//  registered block: bind single slaves (StaticPdoBinding<slaves::X>) or
+//  generate the Config without them (eni_codegen --exclude). The master
+//  reports overlapping outputs before the bus is started.
+//
+//  Copyright 2015 Chair of Applied Mechanics, TUM
+//  https://www.amm.mw.tum.de/
+//
+
+#ifndef STATICPDO_HPP_5E0D2A91
+#define STATICPDO_HPP_5E0D2A91
+
+#include <stdint.h>
+#include <string.h>
+#include <mutex>
+
+namespace ec {
+
+  /*! Accessor for one PDO entry at a fixed bit offset in the process image.
+
+      Byte-aligned entries are copied with a single memcpy (the process image
+      is little endian, like the supported hosts), single bits are masked and
+      everything else falls back to a bitwise copy. All branches are resolved
+      at compile time.
+   */
+  template<typename T, uint32_t BitOffset, uint32_t BitSize>
+  struct PdoField {
+
+    static_assert(BitSize <= 8*sizeof(T), "PDO entry larger than its C++ type");
+
+    //! Read the value from the process image
+    static inline T read(const uint8_t* image) {
+
+      if (BitSize == 1) {
+        return (T) ((image[BitOffset/8] >> (BitOffset%8)) & 1);
+      }
+
+      T value = 0;
+      if (BitOffset % 8 == 0 && BitSize % 8 == 0) {
+        memcpy(&value, image + BitOffset/8, BitSize/8);
+      } else {
+        uint8_t* dst = (uint8_t*) &value;
+        for (uint32_t i = 0; i < BitSize; i++) {
+          uint32_t src = BitOffset + i;
+          dst[i/8] |= ((image[src/8] >> (src%8)) & 1) << (i%8);
+        }
+      }
+      return value;
+    }
+
+    //! Write the value to the process image
+    static inline void write(uint8_t* image, const T& value) {
+
+      if (BitSize == 1) {
+        if (value) {
+          image[BitOffset/8] |= (uint8_t) (1 << (BitOffset%8));
+        } else {
+          image[BitOffset/8] &= (uint8_t) ~(1 << (BitOffset%8));
+        }
+        return;
+      }
+
+      if (BitOffset % 8 == 0 && BitSize % 8 == 0) {
+        memcpy(image + BitOffset/8, &value, BitSize/8);
+      } else {
+        const uint8_t* src = (const uint8_t*) &value;
+        for (uint32_t i = 0; i < BitSize; i++) {
+          uint32_t dst = BitOffset + i;
+          if ((src[i/8] >> (i%8)) & 1) {
+            image[dst/8] |= (uint8_t) (1 << (dst%8));
+          } else {
+            image[dst/8] &= (uint8_t) ~(1 << (dst%8));
+          }
+        }
+      }
+    }
+
+    //! True if the entry overlaps the given bit range of the process image
+    static constexpr bool overlaps(uint32_t bitOffset, uint32_t bitSize) {
+      return bitOffset < BitOffset + BitSize && BitOffset < bitOffset + bitSize;
+    }
+  };
+
+  /*! Interface for the master to exchange a static PDO block.
+      One call per block and cycle, instead of one per variable. */
+  class StaticPdoExchange {
+
+  public:
+
+    virtual ~StaticPdoExchange() {}
+
+    /*! Copy the inputs from the process image. Called from the job task */
+    virtual void exchangeInputs(const uint8_t* image) = 0;
+
+    /*! Copy the outputs to the process image. Called from the job task */
+    virtual void exchangeOutputs(uint8_t* image) = 0;
+
+    /*! True if exchangeOutputs() writes to the given bit range of the output image */
+    virtual bool writesOutput(uint32_t bitOffset, uint32_t bitSize) const = 0;
+
+    /*! Returns the mutex for the whole block */
+    std::timed_mutex& getMutex() {
+      return m_mutex;
+    }
+
+  protected:
+
+    //! for thread safety (data is accessed from within JobTask thread)
+    std::timed_mutex  m_mutex;
+
+  };
+
+  /*! Thread-safe process data of a generated layout.
+
+      Layout is a struct generated by eni_codegen (Config or a single
+      slave), which provides the types Inputs and Outputs and the static
+      methods readInputs(), writeOutputs() and writesOutput().
+      All outputs of the layout are written every cycle, starting from zero.
+   */
+  template<class Layout>
+  class StaticPdoBinding : public StaticPdoExchange {
+
+  public:
+
+    typedef typename Layout::Inputs   Inputs;
+    typedef typename Layout::Outputs  Outputs;
+
+    StaticPdoBinding() {
+      memset(&m_inputs, 0, sizeof(Inputs));
+      memset(&m_outputs, 0, sizeof(Outputs));
+    }
+
+    /*! Copy all inputs of the last cycle (thread-safe) */
+    void getInputs(Inputs& inputs) {
+      std::lock_guard<std::timed_mutex> lock(m_mutex);
+      inputs = m_inputs;
+    }
+
+    /*! Set all outputs for the next cycle (thread-safe) */
+    void setOutputs(const Outputs& outputs) {
+      std::lock_guard<std::timed_mutex> lock(m_mutex);
+      m_outputs = outputs;
+    }
+
+    /*! Implements StaticPdoExchange, fully unrolled by the Layout */
+    void exchangeInputs(const uint8_t* image) {
+      Layout::readInputs(image, m_inputs);
+    }
+
+    /*! Implements StaticPdoExchange, fully unrolled by the Layout */
+    void exchangeOutputs(uint8_t* image) {
+      Layout::writeOutputs(image, m_outputs);
+    }
+
+    /*! Implements StaticPdoExchange */
+    bool writesOutput(uint32_t bitOffset, uint32_t bitSize) const {
+      return Layout::writesOutput(bitOffset, bitSize);
+    }
+
+  private:
+
+    Inputs    m_inputs;
+    Outputs   m_outputs;
+
+  };
+
+}
+
+#endif /* end of include guard: STATICPDO_HPP_5E0D2A91 */
@@ -0,0 +1,477 @@
+//
+//  ThreadTopology.hpp
+//  am2b
+//
+//  Scheduling of the master threads (cpu affinity, policy, priority, stack)
+//  at runtime. The defaults are the settings of iface_ec_sched.hpp, a
+//  topology file adapts them to the host without recompiling:
+//
+//    # thread.key = value, thread: timing, job, notify, companion, main
+//    timing.cpus       = 1
+//    timing.priority   = max         # max, max-N, min+N of the thread's policy, or a number
+//    job.cpus          = 2,3
+//    job.policy        = fifo        # fifo, rr, other
+//    job.stack_size    = 65536
+//    job.prefault      = 1           # touch the stack at thread start
+//    check_isolation   = 1           # warn if rt cpus are not in isolcpus / nohz_full
+//    companion_divisor = 4           # master timer / acyclic frames every 4th cycle in the companion thread
+//
+//  Copyright 2015 Chair of Applied Mechanics, TUM
+//  https://www.amm.mw.tum.de/
+//
+
+#ifndef THREADTOPOLOGY_HPP_8E3B6D20
+#define THREADTOPOLOGY_HPP_8E3B6D20
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <alloca.h>
+#include <pthread.h>
+#include <sched.h>
+#include <string>
+#include <vector>
+
+#include <xstdio.h>
+#include <iface_ec_sched.hpp>
+
+namespace ec {
+
+  /*! Scheduling of one thread */
+  struct ThreadConfig {
+    std::vector<int>  cpus;                     //!< allowed cpus, empty: no affinity
+    int               policy = SCHED_FIFO;      //!< SCHED_FIFO, SCHED_RR or SCHED_OTHER
+    int               priority = -1;            //!< -1: not changed
+    size_t            stackSize = 0;            //!< 0: default of the thread library
+    bool              prefault = false;         //!< touch the stack at thread start
+    int               droppedCpu = -1;          //!< default cpu not present on the host, no affinity
+  };
+
+  /*! Scheduling of the master threads, see AcEcMaster::init() */
+  class ThreadTopology {
+
+  public:
+
+    //! Defaults from iface_ec_sched.hpp
+    ThreadTopology() {
+
+      timing.priority = HWL_EC_TIMING_THREAD_PRIO;
+      timing.stackSize = HWL_EC_JOB_THREAD_STACKSIZE;
+      setDefaultCpu(timing, HWL_EC_TIMING_THREAD_CPU);
+
+      job.priority = HWL_EC_JOB_THREAD_PRIO;
+      job.stackSize = HWL_EC_JOB_THREAD_STACKSIZE;
+
+      notify.priority = HWL_EC_NOTIFY_THREAD_PRIO;
+      notify.stackSize = HWL_EC_JOB_THREAD_STACKSIZE;
+
+      companion.priority = HWL_EC_COMPANION_THREAD_PRIO;
+      companion.stackSize = HWL_EC_JOB_THREAD_STACKSIZE;
+
+      setDefaultCpu(main, HWL_EC_MAIN_THREAD_CPU);
+    }
+
+    ThreadConfig  timing;     //!< timing task
+    ThreadConfig  job;        //!< job task (frame processing)
+    ThreadConfig  notify;     //!< notification thread
+    ThreadConfig  companion;  //!< master timer and acyclic frames, see companionDivisor
+    ThreadConfig  main;       //!< thread calling init(), stack settings unused, priority may be -1
+
+    //! Warn in validate() if real-time cpus are not isolated
+    bool          checkIsolation = false;
+
+    /*! Run the master timer, the DCM log and the acyclic frames every
+        companionDivisor cycles in the companion thread, 0: in the job task */
+    uint32_t      companionDivisor = HWL_EC_COMPANION_DIVISOR;
+
+    /*! Read the settings of a topology file, keys not in the
+        file keep their value. Returns true if an error occurs */
+    bool load(const std::string& fileName) {
+
+      FILE* f = fopen(fileName.c_str(), "r");
+      if (!f) {
+        perr_errno_ffl("Cannot open thread topology %s\n", fileName.c_str());
+        return true;
+      }
+
+      bool error = false;
+      char line[256];
+      int lineNr = 0;
+      std::vector<PendingPriority> priorities;
+
+      while (fgets(line, sizeof(line), f)) {
+
+        lineNr++;
+        char* hash = strchr(line, '#');
+        if (hash) {
+          *hash = 0;
+        }
+
+        std::string key, value;
+        if (!splitLine(line, key, value)) {
+          continue;
+        }
+
+        if (setValue(key, value, lineNr, priorities)) {
+          perr("%s:%d: invalid setting %s = %s\n", fileName.c_str(), lineNr, key.c_str(), value.c_str());
+          error = true;
+        }
+      }
+
+      fclose(f);
+
+      // max / min refer to the final policy of the thread, wherever it is set
+      for (const PendingPriority& p : priorities) {
+        if (parsePriority(p.value, p.cfg->policy, p.cfg->priority)) {
+          perr("%s:%d: invalid priority %s\n", fileName.c_str(), p.lineNr, p.value.c_str());
+          error = true;
+        }
+      }
+
+      return error;
+    }
+
+    /*! Check cpus, priorities and stack sizes and, if enabled, the cpu
+        isolation. Returns true if the topology cannot be applied */
+    bool validate() const {
+
+      bool error = false;
+      for (const Entry& e : entries()) {
+        error |= validate(*e.cfg, e.name);
+        if (e.cfg->droppedCpu >= 0) {
+          pwrn("Thread topology: default cpu %d of the %s thread not available (%ld cpus), no affinity\n",
+               e.cfg->droppedCpu, e.name, sysconf(_SC_NPROCESSORS_CONF));
+        }
+      }
+
+      // the master creates these threads with their priority
+      for (const Entry& e : {Entry{"timing", &timing}, Entry{"job", &job}, Entry{"notify", &notify}, Entry{"companion", &companion}}) {
+        if (e.cfg->priority < 0 && (e.cfg != &companion || companionDivisor > 0)) {
+          perr("Thread topology: %s thread needs a priority\n", e.name);
+          error = true;
+        }
+      }
+
+      if (checkIsolation) {
+        std::vector<int> isolated = readCpuList("/sys/devices/system/cpu/isolated");
+        std::vector<int> nohz = readCpuList("/sys/devices/system/cpu/nohz_full");
+        for (const ThreadConfig* cfg : {&timing, &job}) {
+          for (int cpu : cfg->cpus) {
+            if (!contains(isolated, cpu)) {
+              pwrn("Thread topology: cpu %d of the %s task is not isolated (isolcpus)\n", cpu, cfg == &timing ? "timing" : "job");
+            }
+            if (!contains(nohz, cpu)) {
+              pwrn("Thread topology: cpu %d of the %s task has the scheduler tick enabled (nohz_full)\n", cpu, cfg == &timing ? "timing" : "job");
+            }
+          }
+        }
+      }
+
+      // see iface_ec_sched.hpp: the calling thread must not share the cpu of the timing task
+      if (main.cpus.size() == 1 && contains(timing.cpus, main.cpus[0])) {
+        pwrn("Thread topology: main thread pinned to cpu %d of the timing task\n", main.cpus[0]);
+      }
+
+      return error;
+    }
+
+    /*! Print the topology */
+    void report() const {
+
+      pmsg("Thread topology (companion divisor %u):\n", companionDivisor);
+      for (const Entry& e : entries()) {
+
+        std::string cpus;
+        for (int cpu : e.cfg->cpus) {
+          cpus += (cpus.empty() ? "" : ",") + std::to_string(cpu);
+        }
+
+        pmsg("  %-9s cpus %-8s %-5s prio %3d  stack %6zu%s\n", e.name, cpus.empty() ? "any" : cpus.c_str(),
+             policyName(e.cfg->policy), e.cfg->priority, e.cfg->stackSize, e.cfg->prefault ? " (prefaulted)" : "");
+      }
+    }
+
+    /*! Set policy and priority of the calling thread and prefault its stack.
+        The affinity is set by the caller. Returns true if an error occurs */
+    static bool applySched(const ThreadConfig& cfg) {
+
+      bool error = false;
+
+      if (cfg.priority >= 0) {
+        struct sched_param param;
+        param.sched_priority = cfg.priority;
+        int res = pthread_setschedparam(pthread_self(), cfg.policy, &param);
+        if (res != 0) {
+          perr("Cannot set %s priority %d: %s\n", policyName(cfg.policy), cfg.priority, strerror(res));
+          error = true;
+        }
+      }
+
+      if (cfg.prefault && cfg.stackSize > 0) {
+        // touch most of the stack, the frames below this one need the rest
+        size_t size = cfg.stackSize / 4 * 3;
+        volatile uint8_t* stack = (volatile uint8_t*) alloca(size);
+        for (size_t i = 0; i < size; i += 256) {
+          stack[i] = 0;
+        }
+      }
+
+      return error;
+    }
+
+    /*! Name of a scheduling policy */
+    static const char* policyName(int policy) {
+      switch (policy) {
+        case SCHED_FIFO:  return "fifo";
+        case SCHED_RR:    return "rr";
+        case SCHED_OTHER: return "other";
+        default:          return "?";
+      }
+    }
+
+  private:
+
+    struct Entry {
+      const char*         name;
+      const ThreadConfig* cfg;
+    };
+
+    std::vector<Entry> entries() const {
+      return {{"timing", &timing}, {"job", &job}, {"notify", &notify}, {"companion", &companion}, {"main", &main}};
+    }
+
+    /*! A priority of the topology file, resolved after the whole file is read */
+    struct PendingPriority {
+      ThreadConfig*   cfg;
+      std::string     value;
+      int             lineNr;
+    };
+
+    /*! Pin to the compiled-in cpu if the host has it */
+    static void setDefaultCpu(ThreadConfig& cfg, int cpu) {
+      if (cpu < 0) {
+        return;
+      }
+      if (cpu < sysconf(_SC_NPROCESSORS_CONF)) {
+        cfg.cpus.push_back(cpu);
+      } else {
+        cfg.droppedCpu = cpu;
+      }
+    }
+
+    ThreadConfig* find(const std::string& name) {
+      if (name == "timing") return &timing;
+      if (name == "job")    return &job;
+      if (name == "notify") return &notify;
+      if (name == "companion") return &companion;
+      if (name == "main")   return &main;
+      return NULL;
+    }
+
+    static bool validate(const ThreadConfig& cfg, const char* name) {
+
+      bool error = false;
+
+      long numCpus = sysconf(_SC_NPROCESSORS_CONF);
+      for (int cpu : cfg.cpus) {
+        if (cpu < 0 || cpu >= numCpus) {
+          perr("Thread topology: %s thread on cpu %d, the host has %ld cpus\n", name, cpu, numCpus);
+          error = true;
+        }
+      }
+
+      if (cfg.policy != SCHED_FIFO && cfg.policy != SCHED_RR && cfg.policy != SCHED_OTHER) {
+        perr("Thread topology: %s thread with unknown policy %d\n", name, cfg.policy);
+        error = true;
+      } else if (cfg.priority >= 0 &&
+                 (cfg.priority < sched_get_priority_min(cfg.policy) || cfg.priority > sched_get_priority_max(cfg.policy))) {
+        perr("Thread topology: %s thread priority %d outside of %d..%d for %s\n", name, cfg.priority,
+             sched_get_priority_min(cfg.policy), sched_get_priority_max(cfg.policy), policyName(cfg.policy));
+        error = true;
+      }
+
+      if (cfg.stackSize > 0 && cfg.stackSize < (size_t) PTHREAD_STACK_MIN) {
+        perr("Thread topology: %s thread stack size %zu below %zu\n", name, cfg.stackSize, (size_t) PTHREAD_STACK_MIN);
+        error = true;
+      }
+
+      return error;
+    }
+
+    /*! Apply one "thread.key = value" setting, priorities are queued to
+        priorities. Returns true if an error occurs */
+    bool setValue(const std::string& key, const std::string& value, int lineNr,
+                  std::vector<PendingPriority>& priorities) {
+
+      if (key == "check_isolation") {
+        return parseBool(value, checkIsolation);
+      }
+
+      if (key == "companion_divisor") {
+        char* end;
+        unsigned long divisor = strtoul(value.c_str(), &end, 0);
+        if (value.empty() || *end != 0) {
+          return true;
+        }
+        companionDivisor = (uint32_t) divisor;
+        return false;
+      }
+
+      size_t dot = key.find('.');
+      ThreadConfig* cfg = (dot == std::string::npos) ? NULL : find(key.substr(0, dot));
+      if (!cfg) {
+        return true;
+      }
+
+      std::string field = key.substr(dot + 1);
+      if (field == "cpus") {
+        cfg->droppedCpu = -1;
+        return parseCpuList(value, cfg->cpus);
+      } else if (field == "policy") {
+        if (value == "fifo")        cfg->policy = SCHED_FIFO;
+        else if (value == "rr")     cfg->policy = SCHED_RR;
+        else if (value == "other")  cfg->policy = SCHED_OTHER;
+        else return true;
+        return false;
+      } else if (field == "priority") {
+        int prio;
+        if (parsePriority(value, cfg->policy, prio)) {
+          return true;
+        }
+        priorities.push_back({cfg, value, lineNr});
+        return false;
+      } else if (field == "stack_size") {
+        char* end;
+        unsigned long size = strtoul(value.c_str(), &end, 0);
+        if (*end != 0) {
+          return true;
+        }
+        cfg->stackSize = size;
+        return false;
+      } else if (field == "prefault") {
+        return parseBool(value, cfg->prefault);
+      }
+
+      return true;
+    }
+
+    /*! Split "key = value", returns false for empty lines */
+    static bool splitLine(const char* line, std::string& key, std::string& value) {
+
+      std::string s(line);
+      size_t eq = s.find('=');
+      if (eq == std::string::npos) {
+        key = trim(s);
+        value.clear();
+        return !key.empty();
+      }
+      key = trim(s.substr(0, eq));
+      value = trim(s.substr(eq + 1));
+      return true;
+    }
+
+    static std::string trim(const std::string& s) {
+      size_t b = s.find_first_not_of(" \t\r\n");
+      size_t e = s.find_last_not_of(" \t\r\n");
+      return (b == std::string::npos) ? std::string() : s.substr(b, e - b + 1);
+    }
+
+    static bool parseBool(const std::string& value, bool& out) {
+      if (value == "1" || value == "true" || value == "yes") {
+        out = true;
+      } else if (value == "0" || value == "false" || value == "no") {
+        out = false;
+      } else {
+        return true;
+      }
+      return false;
+    }
+
+    /*! "max", "max-N", "min+N", "-1" or an absolute priority */
+    static bool parsePriority(const std::string& value, int policy, int& out) {
+
+      char* end;
+      if (value.compare(0, 3, "max") == 0 || value.compare(0, 3, "min") == 0) {
+        int base = (value[1] == 'a') ? sched_get_priority_max(policy) : sched_get_priority_min(policy);
+        long offset = (value.size() > 3) ? strtol(value.c_str() + 3, &end, 10) : 0;
+        if (value.size() > 3 && *end != 0) {
+          return true;
+        }
+        out = base + (int) offset;
+        return false;
+      }
+
+      long prio = strtol(value.c_str(), &end, 10);
+      if (value.empty() || *end != 0) {
+        return true;
+      }
+      out = (int) prio;
+      return false;
+    }
+
+    /*! Cpu list as in sysfs and isolcpus ("1,3-5"), empty: no affinity */
+    static bool parseCpuList(const std::string& value, std::vector<int>& out) {
+
+      out.clear();
+      if (value.empty() || value == "any") {
+        return false;
+      }
+
+      const char* p = value.c_str();
+      while (*p) {
+        char* end;
+        long first = strtol(p, &end, 10);
+        if (end == p) {
+          return true;
+        }
+        long last = first;
+        p = end;
+        if (*p == '-') {
+          last = strtol(p + 1, &end, 10);
+          if (end == p + 1 || last < first) {
+            return true;
+          }
+          p = end;
+        }
+        for (long cpu = first; cpu <= last; cpu++) {
+          out.push_back((int) cpu);
+        }
+        while (*p == ',' || *p == ' ') {
+          p++;
+        }
+      }
+      return false;
+    }
+
+    /*! Read a sysfs cpu list, empty if not available */
+    static std::vector<int> readCpuList(const char* path) {
+
+      std::vector<int> cpus;
+      FILE* f = fopen(path, "r");
+      if (f) {
+        char buf[256];
+        if (fgets(buf, sizeof(buf), f)) {
+          parseCpuList(trim(buf), cpus);
+        }
+        fclose(f);
+      }
+      return cpus;
+    }
+
+    static bool contains(const std::vector<int>& v, int x) {
+      for (int y : v) {
+        if (y == x) {
+          return true;
+        }
+      }
+      return false;
+    }
+
+  };
+
+}
+
+#endif /* end of include guard: THREADTOPOLOGY_HPP_8E3B6D20 */
@@ -0,0 +1,211 @@
+//
+//  WorkerPool.hpp
+//  am2b
+//
+//  Pool of pinned worker threads running a batch of independent work items
+//  (e.g. the process() calls of the slaves). The calling thread takes part
+//  in the batch, the items are claimed one by one from a shared counter, so
+//  idle threads pick up the remaining items of busy ones. run() returns once
+//  all items are done.
+//
+//  Copyright 2015 Chair of Applied Mechanics, TUM
+//  https://www.amm.mw.tum.de/
+//
+
+#ifndef WORKERPOOL_HPP_52C8E0A3
+#define WORKERPOOL_HPP_52C8E0A3
+
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <xstdio.h>
+
+namespace ec {
+
+  /*! Worker threads for batches of work items.
+      start(), stop() and run() must be called from the same thread. */
+  class WorkerPool {
+
+  public:
+
+    //! Work item idx of a batch, called from any of the threads
+    typedef void (*WorkFn)(void* ctx, size_t idx);
+
+    ~WorkerPool() {
+      stop();
+    }
+
+    /*! Start numWorkers threads in addition to the calling thread.
+        \param cpus cpu of each worker, -1 or missing entries: no affinity
+        \param prio SCHED_FIFO priority of the workers, -1: inherited
+        Returns true if an error occurs */
+    bool start(unsigned int numWorkers, const std::vector<int>& cpus = std::vector<int>(), int prio = -1) {
+
+      if (!m_workers.empty()) {
+        return true;
+      }
+
+      m_shutdown = false;
+      for (unsigned int i = 0; i < numWorkers; i++) {
+        int cpu = (i < cpus.size()) ? cpus[i] : -1;
+        m_workers.emplace_back(&WorkerPool::worker, this, i, cpu, prio);
+      }
+      return false;
+    }
+
+    /*! Stop and join the workers */
+    void stop() {
+
+      if (m_workers.empty()) {
+        return;
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_shutdown = true;
+      }
+      m_wakeup.notify_all();
+
+      for (std::thread& t : m_workers) {
+        t.join();
+      }
+      m_workers.clear();
+    }
+
+    /*! Number of worker threads (without the calling thread) */
+    size_t size() const {
+      return m_workers.size();
+    }
+
+    /*! Call fn(ctx, idx) for idx = 0..count-1 on the workers and the calling
+        thread. Returns after all calls have finished. */
+    void run(WorkFn fn, void* ctx, size_t count) {
+
+      if (count == 0) {
+        return;
+      }
+
+      if (m_workers.empty() || count == 1) {
+        for (size_t i = 0; i < count; i++) {
+          fn(ctx, i);
+        }
+        return;
+      }
+
+      uint32_t gen;
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        gen = ++m_gen;
+        m_fn = fn;
+        m_ctx = ctx;
+        m_count = count;
+        m_done.store(0, std::memory_order_relaxed);
+        m_next.store(((uint64_t) gen) << 32, std::memory_order_release);
+      }
+      m_wakeup.notify_all();
+
+      work(gen, fn, ctx, count);
+
+      // barrier: the last items may still run on the workers
+      while (m_done.load(std::memory_order_acquire) < count) {
+        std::this_thread::yield();
+      }
+    }
+
+  private:
+
+    /*! Claim and execute items of batch gen until none are left */
+    void work(uint32_t gen, WorkFn fn, void* ctx, size_t count) {
+
+      // upper 32 bit: batch, lower 32 bit: next item. A thread lagging behind
+      // a batch cannot claim items of the following one.
+      uint64_t next = m_next.load(std::memory_order_acquire);
+      for (;;) {
+        if ((uint32_t) (next >> 32) != gen || (next & 0xFFFFFFFF) >= count) {
+          return;
+        }
+        if (m_next.compare_exchange_weak(next, next + 1, std::memory_order_acq_rel)) {
+          fn(ctx, (size_t) (next & 0xFFFFFFFF));
+          m_done.fetch_add(1, std::memory_order_release);
+          next = m_next.load(std::memory_order_acquire);
+        }
+      }
+    }
+
+    void worker(unsigned int idx, int cpu, int prio) {
+
+      char name[16];
+      snprintf(name, sizeof(name), "ecworker%u", idx);
+      pthread_setname_np(pthread_self(), name);
+
+      if (cpu >= 0) {
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        CPU_SET(cpu, &cpuSet);
+        int res = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuSet);
+        if (res != 0) {
+          pwrn("Worker %u: cannot set affinity to cpu %d: %s\n", idx, cpu, strerror(res));
+        }
+      }
+
+      if (prio >= 0) {
+        struct sched_param param;
+        param.sched_priority = prio;
+        int res = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if (res != 0) {
+          pwrn("Worker %u: cannot set priority %d: %s\n", idx, prio, strerror(res));
+        }
+      }
+
+      uint32_t seen = 0;
+      for (;;) {
+
+        WorkFn fn;
+        void* ctx;
+        size_t count;
+        uint32_t gen;
+        {
+          std::unique_lock<std::mutex> lock(m_mutex);
+          m_wakeup.wait(lock, [&] { return m_shutdown || m_gen != seen; });
+          if (m_shutdown) {
+            return;
+          }
+          gen = seen = m_gen;
+          fn = m_fn;
+          ctx = m_ctx;
+          count = m_count;
+        }
+
+        work(gen, fn, ctx, count);
+      }
+    }
+
+    std::vector<std::thread>    m_workers;
+
+    std::mutex                  m_mutex;
+    std::condition_variable     m_wakeup;
+
+    /* current batch, protected by m_mutex */
+    bool                        m_shutdown = false;
+    uint32_t                    m_gen = 0;
+    WorkFn                      m_fn = NULL;
+    void*                       m_ctx = NULL;
+    size_t                      m_count = 0;
+
+    //! batch and next item, see work()
+    std::atomic<uint64_t>       m_next{0};
+    //! finished items of the current batch
+    std::atomic<size_t>         m_done{0};
+
+  };
+
+}
+
+#endif /* end of include guard: WORKERPOOL_HPP_52C8E0A3 */
@@ -0,0 +1,91 @@
+//
+//  dcm_decode.cpp
+//  am2b
+//
+//  Converts a binary DCM log (see DcmLog.hpp) to CSV.
+//
+//  Usage: dcm_decode --in masterdcm.dcm --out masterdcm.csv
+//
+//  Copyright 2015 Chair of Applied Mechanics, TUM
+//  https://www.amm.mw.tum.de/
+//
+
+#include <iostream>
+#include <string>
+
+#include "DcmLog.hpp"
+
+#include <xstdio.h>
+#include <progopt.hpp>
+
+using namespace std;
+using namespace am2b;
+using namespace ec;
+
+// DCM log decoder
+int main (int argc, char *argv[]) {
+
+  ProgOpt opt(argv[0], "converts a binary DCM log to csv.",
+              argc,argv);
+  opt.add(' ',"in", true, "binary DCM log","masterdcm.dcm");
+  opt.add(' ',"out", false, "csv file","masterdcm.csv");
+  opt.std_parse();
+
+  string inFile   = opt.val<string>("in");
+  string outFile  = opt.val<string>("out");
+
+  FILE* in = fopen(inFile.c_str(), "rb");
+  if (!in) {
+    perr("Cannot open %s\n", inFile.c_str());
+    return EXIT_FAILURE;
+  }
+
+  DcmLogFileHeader header;
+  if (fread(&header, sizeof(header), 1, in) != 1 || memcmp(header.magic, DCMLOG_MAGIC, sizeof(header.magic)) != 0) {
+    perr("%s is not a DCM log file\n", inFile.c_str());
+    fclose(in);
+    return EXIT_FAILURE;
+  }
+
+  if (header.version != DCMLOG_VERSION || header.recordSize != sizeof(DcmLogRecord)) {
+    perr("Unsupported DCM log version %u (record size %u)\n", header.version, header.recordSize);
+    fclose(in);
+    return EXIT_FAILURE;
+  }
+
+  FILE* out = fopen(outFile.c_str(), "w");
+  if (!out) {
+    perr("Cannot open %s for writing\n", outFile.c_str());
+    fclose(in);
+    return EXIT_FAILURE;
+  }
+
+  fprintf(out, "cycle,busTime,ctlErrorCur,ctlErrorAvg,ctlErrorMax,ctlSetVal,status,inSync\n");
+
+  DcmLogRecord rec;
+  uint64_t n = 0;
+  uint64_t gaps = 0;
+  uint64_t lastCycle = 0;
+
+  while (fread(&rec, sizeof(rec), 1, in) == 1) {
+
+    // lost records show up as gaps in the cycle counter
+    if (n > 0 && rec.cycle != lastCycle + 1) {
+      gaps++;
+    }
+    lastCycle = rec.cycle;
+    n++;
+
+    fprintf(out, "%llu,%u,%d,%d,%d,%d,0x%08X,%u\n", (unsigned long long) rec.cycle, rec.busTime,
+            rec.ctlErrorCur, rec.ctlErrorAvg, rec.ctlErrorMax, rec.ctlSetVal, rec.status,
+            (unsigned int) rec.inSync);
+  }
+
+  fclose(in);
+  fclose(out);
+
+  pmsg("%llu records (bus cycle %u us) written to %s, %llu gaps\n", (unsigned long long) n,
+       header.busCycleTimeUs, outFile.c_str(), (unsigned long long) gaps);
+
+  return 0;
+}
@@ -11,6 +11,7 @@
 #define EL1012DEVICE_HPP_ACDDF772
 
 #include "BusVar.hpp"
+#include "BusBits.hpp"
 
 namespace ec {
 
@@ -26,15 +27,20 @@ namespace ec {
     bool getInput(int index) {
     
       // invalid index
-      if (index > 3 || index < 0) {
+      if (index >= (int) m_in.size() || index < 0) {
         pwrn_ffl("Index out of range\n");
         return false;
       }
     
       // assign the value to the Bus data type
-      return m_in[index];
+      return m_in.test(index);
     
     }
+
+    /*! Get all inputs, bit i is channel i+1 */
+    uint64_t getInputs() {
+      return m_in.getBits();
+    }
   
   
   private:
@@ -49,14 +55,13 @@ namespace ec {
     void link() {
     
       // link the pdo vars to the Bus var types
-      this->linkPDOVar("Channel 1.Input", &m_in[0]);
-      this->linkPDOVar("Channel 2.Input", &m_in[1]);
+      this->linkPDOBits({"Channel 1.Input", "Channel 2.Input"}, &m_in);
     }
     
     //!init before Bus operation
     void init(){}
   
-    BusBool<BusInput>      m_in[2];
+    BusBits<2, BusInput>   m_in;
 
   };
 
@@ -11,6 +11,7 @@
 #define EL2004DEVICE_HPP_ACDDF772
 
 #include "BusVar.hpp"
+#include "BusBits.hpp"
 
 namespace ec {
 
@@ -28,24 +29,29 @@ namespace ec {
     void setOutput(int index, bool enabled) {
     
       // invalid index
-      if (index > 3 || index < 0) {
+      if (index >= (int) m_out.size() || index < 0) {
         return;
       }
     
       // assign the value to the Bus data type
-      m_out[index] = enabled;
+      m_out.set(index, enabled);
     
     }
+
+    /*! Set all outputs, bit i is channel i+1 */
+    void setOutputs(uint64_t bits) {
+      m_out.setBits(bits);
+    }
   
     //! Toggle the output at \param index
     void toggleOutput(int index) {
     
       // invalid index
-      if (index > 3 || index < 0) {
+      if (index >= (int) m_out.size() || index < 0) {
         return;
       }
     
-      m_out[index] = !m_out[index];
+      m_out.flip(index);
     
     }
   
@@ -60,16 +66,13 @@ namespace ec {
     void link() {
     
       // link the pdo vars to the Bus var types
-      this->linkPDOVar("Channel 1.Output", &m_out[0]);
-      this->linkPDOVar("Channel 2.Output", &m_out[1]);
-      this->linkPDOVar("Channel 3.Output", &m_out[2]);
-      this->linkPDOVar("Channel 4.Output", &m_out[3]);
+      this->linkPDOBits({"Channel 1.Output", "Channel 2.Output", "Channel 3.Output", "Channel 4.Output"}, &m_out);
     }
     
     //!init before Bus operation
     void init(){}
   
-    BusBool<BusOutput>      m_out[4];
+    BusBits<4, BusOutput>   m_out;
 
   };
 
@@ -409,10 +409,10 @@ namespace ec {
     //! Convert integer to string
     static std::string toString(unsigned int value) {
       
-      static char m_buf[15];
+      char buf[15];
       
-      snprintf(m_buf, 15, "%u", value);
-      return std::string(m_buf);
+      snprintf(buf, 15, "%u", value);
+      return std::string(buf);
       
     }
   
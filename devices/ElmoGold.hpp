@@ -13,6 +13,7 @@
 #include <math.h>
 
 #include "BusVar.hpp"
+#include "BusVarGroup.hpp"
 #include "ElmoStateMachine.hpp"
 #include "SDOQueue.hpp"
 #include "BusException.hpp"
@@ -29,6 +30,30 @@
 
 namespace ec {
 
+  /*! Inputs of one Elmo, all from the same bus cycle (see ElmoGold::readInputs()) */
+  struct ElmoInputs {
+    uint16_t  statusWord;         //!< status word
+    int8_t    modeOfOperation;    //!< mode of operation display
+    int32_t   positionRaw;        //!< inc. encoder position in ticks
+    int32_t   velocityRaw;        //!< velocity in ticks/s
+    int32_t   absPositionRaw;     //!< abs. encoder position in ticks
+    int16_t   currentRaw;         //!< current in 1/1000 rated current
+    uint32_t  voltageRaw;         //!< DC link voltage in mV
+    double    position;           //!< inc. encoder position in rad
+    double    velocity;           //!< velocity in rad/s
+    double    absPosition;        //!< abs. encoder position in rad
+    double    current;            //!< current in A
+    double    dcLinkVoltage;      //!< DC link voltage in V
+    BusTimestamp stamp;           //!< cycle, bus time and host time of the inputs
+  };
+
+  /*! Setpoints of one Elmo, sent in the same bus cycle (see ElmoGold::writeOutputs()) */
+  struct ElmoOutputs {
+    double    position;           //!< desired position in rad (inc. encoder)
+    double    velocityOffset;     //!< velocity feedforward in rad/s
+    double    currentOffset;      //!< current feedforward in A
+  };
+
   /* Elmo Gold Device implementation */
   template<class PipedInterface>
   class ElmoGold : public PipedInterface {
@@ -145,6 +170,87 @@ namespace ec {
       return ((double) m_absPosition) / (double)m_countsAbsEncoder * 2.0 * M_PI;
     }
 
+    /*! Copy all inputs of the last cycle at once. The values are consistent,
+        i.e. they were received with the same frame. */
+    void readInputs(ElmoInputs& in) {
+
+      readInputsRaw(in);
+
+      in.position       = ((double) in.positionRaw) / (double)m_countsIncEncoder * 2.0 * M_PI;
+      in.velocity       = ((double) in.velocityRaw) / (double)m_countsIncEncoder * 2.0 * M_PI;
+      in.absPosition    = ((double) in.absPositionRaw) / (double)m_countsAbsEncoder * 2.0 * M_PI;
+      in.current        = ((double)(in.currentRaw)*(double)(m_ratedCurrent.getState())*0.000001);
+      in.dcLinkVoltage  = ((double) in.voltageRaw) / 1000;
+    }
+
+    /*! Same as readInputs(), only the raw values are set */
+    void readInputsRaw(ElmoInputs& in) {
+
+      std::lock_guard<std::timed_mutex> lock(m_pdoGroup.getMutex());
+      in.statusWord       = m_statusWord;
+      in.modeOfOperation  = m_modeOfOperation;
+      in.positionRaw      = m_position;
+      in.velocityRaw      = m_velocity;
+      in.absPositionRaw   = m_absPosition;
+      in.currentRaw       = m_current;
+      in.voltageRaw       = m_voltage;
+      in.stamp            = m_pdoGroup.getInputStamp();
+    }
+
+    /*! Set desired position, velocity offset and current offset at once.
+        The three values are sent with the same frame. */
+    void writeOutputs(const ElmoOutputs& out) {
+
+      writeOutputsRaw((int32_t) (out.position * ((double) m_countsIncEncoder) / 2.0 / M_PI),
+                      (int32_t) (out.velocityOffset * ((double) m_countsIncEncoder) / 2.0 / M_PI),
+                      (int16_t) (m_useTorqueOffset*out.currentOffset*1000000.0/(double)(m_ratedCurrent.getState())));
+    }
+
+    /*! Same as writeOutputs() with raw values (ticks, ticks/s, 1/1000 rated current) */
+    void writeOutputsRaw(int32_t pos, int32_t velOffset, int16_t torqueOffset) {
+
+      std::lock_guard<std::timed_mutex> lock(m_pdoGroup.getMutex());
+      m_desPosition     = pos;
+      m_velocityOffset  = velOffset;
+      m_torqueOffset    = torqueOffset;
+    }
+
+    /*! Same as writeOutputsRaw() without blocking, for the job task (cycle callbacks).
+        Returns true if the group is locked by another thread, the previous
+        outputs are sent then */
+    bool tryWriteOutputsRaw(int32_t pos, int32_t velOffset, int16_t torqueOffset) {
+
+      std::unique_lock<std::timed_mutex> lock(m_pdoGroup.getMutex(), std::try_to_lock);
+      if (!lock.owns_lock()) {
+        return true;
+      }
+      m_desPosition     = pos;
+      m_velocityOffset  = velOffset;
+      m_torqueOffset    = torqueOffset;
+      return false;
+    }
+
+    /*! Factor from inc. encoder ticks to rad (see ElmoGroup) */
+    double getPositionScale() {
+      return 2.0 * M_PI / (double)m_countsIncEncoder;
+    }
+
+    /*! Factor from abs. encoder ticks to rad */
+    double getAbsPositionScale() {
+      return 2.0 * M_PI / (double)m_countsAbsEncoder;
+    }
+
+    /*! Factor from 1/1000 rated current to A */
+    double getCurrentScale() {
+      return (double)(m_ratedCurrent.getState())*0.000001;
+    }
+
+    /*! Factor from A to the raw current offset, zero if the offset is disabled */
+    double getCurrentOffsetScale() {
+      uint32_t ratedCurrent = m_ratedCurrent.getState();
+      return (m_useTorqueOffset && ratedCurrent > 0) ? 1000000.0/(double)ratedCurrent : 0.0;
+    }
+
     /*! Set the demanded position of the drive (inc. encoder, rad) */
     void setDesiredPosition(double pos) {
       m_desPosition = (int32_t) (pos * ((double) m_countsIncEncoder) / 2.0 / M_PI);
@@ -453,21 +559,35 @@ namespace ec {
     //! Method for linking PDO / async SDO variables
     void link() {
     
-      this->linkPDOVar("Inputs.Status word", &m_statusWord);
-      this->linkPDOVar("Inputs.Position actual value", &m_position);
-      this->linkPDOVar("Inputs.Auxiliary position actual value", &m_absPosition);
-      this->linkPDOVar("Inputs.Mode of operation display", &m_modeOfOperation);
-      this->linkPDOVar("Inputs.Velocity actual value", &m_velocity);
-      this->linkPDOVar("Inputs.Current actual value", &m_current);
-
       this->linkPDOVar("Outputs.Control word", &m_controlWord);
-      this->linkPDOVar("Outputs.Target Position", &m_desPosition);
-      this->linkPDOVar("Outputs.Velocity Offset", &m_velocityOffset);
       //this->linkPDOVar("Outputs.Target Velocity", &m_velocityOffset);
-      this->linkPDOVar("Outputs.Torque Offset", &m_torqueOffset);
 
-      // DC link circuit voltage
-      this->linkPDOVar("Inputs.DC link circuit voltage", &m_voltage);
+      // exchange inputs and setpoints consistently (readInputs(), writeOutputs()),
+      // variables missing in the ENI are left out
+      struct {
+        const char*   name;
+        BusVarType*   var;
+      } grouped[] = {
+        {"Inputs.Status word", &m_statusWord},
+        {"Inputs.Position actual value", &m_position},
+        {"Inputs.Auxiliary position actual value", &m_absPosition},
+        {"Inputs.Mode of operation display", &m_modeOfOperation},
+        {"Inputs.Velocity actual value", &m_velocity},
+        {"Inputs.Current actual value", &m_current},
+        {"Inputs.DC link circuit voltage", &m_voltage},     // DC link circuit voltage
+        {"Outputs.Target Position", &m_desPosition},
+        {"Outputs.Velocity Offset", &m_velocityOffset},
+        {"Outputs.Torque Offset", &m_torqueOffset}
+      };
+
+      for (auto& entry : grouped) {
+        if (this->linkPDOVar(entry.name, entry.var)) {
+          perrSlave("PDO '%s' not linked, it is not exchanged\n", entry.name);
+        } else {
+          m_pdoGroup.add(entry.var);
+        }
+      }
+      this->registerGroup(&m_pdoGroup);
 
 
       // Link SDOs
@@ -612,6 +732,9 @@ namespace ec {
     bool m_useTorqueOffset=false;
 
     BusUInt32<BusInput>     m_voltage;
+
+    //! Inputs and setpoints above, exchanged as a unit by the master
+    BusVarGroup             m_pdoGroup;
   
     /* Async SDO Variables on the bus */
     
@@ -0,0 +1,201 @@
+//
+//  ElmoGroup.hpp
+//  am2b
+//
+//  Structure-of-arrays view of many ElmoGold drives. The inputs of all
+//  drives are copied into contiguous arrays and converted in one pass with
+//  the kernels of SimdConvert.hpp, the setpoints are converted the same way.
+//
+//  Copyright 2015 Chair of Applied Mechanics, TUM
+//  https://www.amm.mw.tum.de/
+//
+
+#ifndef ELMOGROUP_HPP_A64C0E93
+#define ELMOGROUP_HPP_A64C0E93
+
+#include <vector>
+
+#include "ElmoGold.hpp"
+#include "SimdConvert.hpp"
+
+namespace ec {
+
+  /*! Group of ElmoGold drives with the process data as arrays.
+
+      Usage per control cycle: readInputs(), use getPosition() etc.,
+      fill desiredPosition(), velocityOffset() and currentOffset(),
+      writeOutputs(). Index i refers to the i-th drive passed to add().
+      The inputs of each drive are consistent (ElmoGold::readInputsRaw()),
+      the drives may differ by one cycle (see getInputStamp()).
+
+      The conversion factors are cached, call updateScales() after the rated
+      current or the torque offset flag of a drive has changed.
+      Not thread-safe, use one group per thread.
+   */
+  template<class PipedInterface>
+  class ElmoGroup {
+
+  public:
+
+    typedef ElmoGold<PipedInterface> Drive;
+
+    /*! Add a drive to the group */
+    void add(Drive* drive) {
+
+      m_drives.push_back(drive);
+
+      size_t n = m_drives.size();
+      for (std::vector<int32_t>* v : {&m_positionRaw, &m_velocityRaw, &m_absPositionRaw, &m_currentRaw,
+                                      &m_desPositionRaw, &m_velocityOffsetRaw, &m_currentOffsetRaw}) {
+        v->resize(n, 0);
+      }
+      for (std::vector<double>* v : {&m_position, &m_velocity, &m_absPosition, &m_current,
+                                     &m_desPosition, &m_velocityOffset, &m_currentOffset,
+                                     &m_positionScale, &m_absPositionScale, &m_currentScale,
+                                     &m_positionScaleInv, &m_currentOffsetScale}) {
+        v->resize(n, 0.0);
+      }
+      m_statusWord.resize(n, 0);
+      m_inputStamp.resize(n, BusTimestamp{0, 0, 0});
+
+      updateScales();
+    }
+
+    /*! Re-read the conversion factors of all drives */
+    void updateScales() {
+      for (size_t i = 0; i < m_drives.size(); i++) {
+        m_positionScale[i]      = m_drives[i]->getPositionScale();
+        m_absPositionScale[i]   = m_drives[i]->getAbsPositionScale();
+        m_currentScale[i]       = m_drives[i]->getCurrentScale();
+        m_positionScaleInv[i]   = 1.0 / m_positionScale[i];
+        m_currentOffsetScale[i] = m_drives[i]->getCurrentOffsetScale();
+      }
+    }
+
+    /*! Number of drives */
+    size_t size() const {
+      return m_drives.size();
+    }
+
+    /*! Copy the inputs of all drives and convert them to SI units */
+    void readInputs() {
+
+      size_t n = m_drives.size();
+      ElmoInputs in;
+
+      for (size_t i = 0; i < n; i++) {
+        m_drives[i]->readInputsRaw(in);
+        m_statusWord[i]     = in.statusWord;
+        m_positionRaw[i]    = in.positionRaw;
+        m_velocityRaw[i]    = in.velocityRaw;
+        m_absPositionRaw[i] = in.absPositionRaw;
+        m_currentRaw[i]     = in.currentRaw;
+        m_inputStamp[i]     = in.stamp;
+      }
+
+      simdScaleToDouble(m_positionRaw.data(), m_positionScale.data(), m_position.data(), n);
+      simdScaleToDouble(m_velocityRaw.data(), m_positionScale.data(), m_velocity.data(), n);
+      simdScaleToDouble(m_absPositionRaw.data(), m_absPositionScale.data(), m_absPosition.data(), n);
+      simdScaleToDouble(m_currentRaw.data(), m_currentScale.data(), m_current.data(), n);
+    }
+
+    /*! Convert the setpoints of all drives and send them */
+    void writeOutputs() {
+
+      size_t n = m_drives.size();
+
+      simdScaleToInt32(m_desPosition.data(), m_positionScaleInv.data(), m_desPositionRaw.data(), n);
+      simdScaleToInt32(m_velocityOffset.data(), m_positionScaleInv.data(), m_velocityOffsetRaw.data(), n);
+      simdScaleToInt32(m_currentOffset.data(), m_currentOffsetScale.data(), m_currentOffsetRaw.data(), n);
+
+      for (size_t i = 0; i < n; i++) {
+        m_drives[i]->writeOutputsRaw(m_desPositionRaw[i], m_velocityOffsetRaw[i], (int16_t) m_currentOffsetRaw[i]);
+      }
+    }
+
+    /*! Inc. encoder positions in rad */
+    const double* getPosition() const {
+      return m_position.data();
+    }
+
+    /*! Velocities in rad/s */
+    const double* getVelocity() const {
+      return m_velocity.data();
+    }
+
+    /*! Abs. encoder positions in rad */
+    const double* getAbsPosition() const {
+      return m_absPosition.data();
+    }
+
+    /*! Currents in A */
+    const double* getCurrent() const {
+      return m_current.data();
+    }
+
+    /*! Inc. encoder positions in ticks */
+    const int32_t* getPositionRaw() const {
+      return m_positionRaw.data();
+    }
+
+    /*! Stamps of the inputs of each drive */
+    const BusTimestamp* getInputStamp() const {
+      return m_inputStamp.data();
+    }
+
+    /*! Status words */
+    const uint16_t* getStatusWord() const {
+      return m_statusWord.data();
+    }
+
+    /*! Desired positions in rad, sent by writeOutputs() */
+    double* desiredPosition() {
+      return m_desPosition.data();
+    }
+
+    /*! Velocity offsets in rad/s, sent by writeOutputs() */
+    double* velocityOffset() {
+      return m_velocityOffset.data();
+    }
+
+    /*! Current offsets in A, sent by writeOutputs() */
+    double* currentOffset() {
+      return m_currentOffset.data();
+    }
+
+  private:
+
+    std::vector<Drive*>     m_drives;
+
+    /* Inputs */
+    std::vector<uint16_t>   m_statusWord;
+    std::vector<int32_t>    m_positionRaw;
+    std::vector<int32_t>    m_velocityRaw;
+    std::vector<int32_t>    m_absPositionRaw;
+    std::vector<int32_t>    m_currentRaw;
+    std::vector<double>     m_position;
+    std::vector<double>     m_velocity;
+    std::vector<double>     m_absPosition;
+    std::vector<double>     m_current;
+    std::vector<BusTimestamp> m_inputStamp;
+
+    /* Setpoints */
+    std::vector<double>     m_desPosition;
+    std::vector<double>     m_velocityOffset;
+    std::vector<double>     m_currentOffset;
+    std::vector<int32_t>    m_desPositionRaw;
+    std::vector<int32_t>    m_velocityOffsetRaw;
+    std::vector<int32_t>    m_currentOffsetRaw;
+
+    /* Conversion factors per drive */
+    std::vector<double>     m_positionScale;      //!< ticks to rad (inc. encoder)
+    std::vector<double>     m_absPositionScale;   //!< ticks to rad (abs. encoder)
+    std::vector<double>     m_currentScale;       //!< 1/1000 rated current to A
+    std::vector<double>     m_positionScaleInv;   //!< rad to ticks
+    std::vector<double>     m_currentOffsetScale; //!< A to 1/1000 rated current
+
+  };
+
+}
+
+#endif /* end of include guard: ELMOGROUP_HPP_A64C0E93 */
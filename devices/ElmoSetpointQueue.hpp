@@ -0,0 +1,75 @@
+//
+//  ElmoSetpointQueue.hpp
+//  am2b
+//
+//  Setpoint queue for one ElmoGold, applied by the job task in the
+//  scheduled cycle. Register onCycle() as cycle callback:
+//
+//    ElmoSetpointQueue<Iface> queue(&elmo, SetpointInterpolation::LINEAR, 0.001);
+//    master.registerCycleCallback(&ElmoSetpointQueue<Iface>::onCycle, &queue, 20, "elmo setpoints");
+//    master.init(cycleTimeUs);
+//    ...
+//    queue.push({master.getCycleCounter() + 10, pos, velOffset, torqueOffset});
+//
+//  Copyright 2015 Chair of Applied Mechanics, TUM
+//  https://www.amm.mw.tum.de/
+//
+
+#ifndef ELMOSETPOINTQUEUE_HPP_0C7B4E92
+#define ELMOSETPOINTQUEUE_HPP_0C7B4E92
+
+#include <math.h>
+#include <atomic>
+
+#include "ElmoGold.hpp"
+#include "SetpointQueue.hpp"
+#include "CycleCallback.hpp"
+
+namespace ec {
+
+  /*! Setpoint queue of one drive. Values in raw units:
+      position in ticks, velocity offset in ticks/s, torque offset in 1/1000 rated current */
+  template<class PipedInterface, uint32_t Size = 256>
+  class ElmoSetpointQueue : public SetpointQueue<Size> {
+
+  public:
+
+    ElmoSetpointQueue(ElmoGold<PipedInterface>* drive,
+                      SetpointInterpolation mode = SetpointInterpolation::HOLD,
+                      double cycleTimeS = 0.001)
+      : SetpointQueue<Size>(mode, cycleTimeS), m_drive(drive) {
+    }
+
+    /*! Cycle callback, userData is the queue. Writes the setpoint of the cycle,
+        the drive keeps the previous one if its outputs are locked by another thread */
+    static void onCycle(void* userData, const CycleContext& ctx) {
+
+      ElmoSetpointQueue* self = static_cast<ElmoSetpointQueue*>(userData);
+      Setpoint sp;
+
+      if (self->sample(ctx.cycle, sp)) {
+        double torque = fmax(-32768.0, fmin(32767.0, sp.torqueOffset));
+        if (self->m_drive->tryWriteOutputsRaw((int32_t) lround(sp.position),
+                                              (int32_t) lround(sp.velocityOffset),
+                                              (int16_t) lround(torque))) {
+          self->m_missedWrites.fetch_add(1, std::memory_order_relaxed);
+        }
+      }
+    }
+
+    /*! Number of setpoints not written because the drive outputs were locked */
+    uint64_t getMissedWrites() const {
+      return m_missedWrites.load(std::memory_order_relaxed);
+    }
+
+  private:
+
+    ElmoGold<PipedInterface>*   m_drive;
+
+    std::atomic<uint64_t>       m_missedWrites{0};
+
+  };
+
+}
+
+#endif /* end of include guard: ELMOSETPOINTQUEUE_HPP_0C7B4E92 */
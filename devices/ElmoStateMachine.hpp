@@ -261,6 +261,12 @@ namespace ec {
     //! no_motor_motion allowed if true
     bool                     m_noMotorMotion;
 
+    //! rate limit of the warning bit message (per drive, process() may run in parallel)
+    LogRateLimiter           m_limitWarnings{EL_STM_MAX_MSGS_PER_ERROR, EL_STM_REDUCED_LOG_RATE};
+
+    //! rate limit of the active limit message
+    LogRateLimiter           m_limitActiveLimit{EL_STM_MAX_MSGS_PER_ERROR, EL_STM_REDUCED_LOG_RATE};
+
     /*! Returns the slave Name as string
        This is needed for the perrSlave, pmsgSlave,... macros */
     std::string getName() {
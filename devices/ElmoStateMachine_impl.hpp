@@ -646,13 +646,10 @@ void ElmoStateMachine::updateState() {
 
   }
   
-  static LogRateLimiter limitWarnings(EL_STM_MAX_MSGS_PER_ERROR, EL_STM_REDUCED_LOG_RATE);
-  static LogRateLimiter limitActiveLimit(EL_STM_MAX_MSGS_PER_ERROR, EL_STM_REDUCED_LOG_RATE);
-  
   // check for warnings
   if (warning()) {
-    limitWarnings.count();
-    if (limitWarnings.log()) {
+    m_limitWarnings.count();
+    if (m_limitWarnings.log()) {
       perrSlave("Warning bit enabled! This might be caused by\n\tOvertemperature/"
                          "Over-/Undervoltage/\n\tAnalog encoder amplitude low threshold exceeded/"
                          "\n\tEnd at encoder warning is received\n");
@@ -661,8 +658,8 @@ void ElmoStateMachine::updateState() {
   
   // check for internal limits
   if (limitActive()) {
-    limitActiveLimit.count();
-    if (limitActiveLimit.log()) {
+    m_limitActiveLimit.count();
+    if (m_limitActiveLimit.log()) {
       perrSlave("Internal limitation of the drive active! (Endstops / Internal Position Limits)\n");
     }
     
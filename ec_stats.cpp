@@ -0,0 +1,92 @@
+//
+//  ec_stats.cpp
+//  am2b
+//
+//  Prints the statistics page of a running master (see BusStats.hpp).
+//  Maps the shared memory read-only, the master is not affected.
+//
+//  Usage: ec_stats --name /hwl_ec_stats --period 1000
+//
+//  Copyright 2015 Chair of Applied Mechanics, TUM
+//  https://www.amm.mw.tum.de/
+//
+
+#include <iostream>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "BusStats.hpp"
+
+#include <xstdio.h>
+#include <progopt.hpp>
+
+using namespace std;
+using namespace am2b;
+using namespace ec;
+
+// prints one consistent copy of the page
+static void printPage(const BusStatsPage& p) {
+
+  printf("cycle %llu  state %u  fault %u  overload %u  lost frames %llu  cyc wkc errors %llu\n",
+         (unsigned long long) p.cycleCounter, p.busState, p.fault, p.overloadCounter,
+         (unsigned long long) p.lostFrames, (unsigned long long) p.cycCmdWkcErrors);
+
+  printf("phases (us, cur/max):");
+  for (int i = 0; i < BUSSTATS_NUM_PHASES; i++) {
+    printf(" %s %u/%u", busStatsPhaseName(i), p.phaseUs[i], p.phaseMaxUs[i]);
+  }
+  printf("  (cycle %u)\n", p.busCycleTimeUs);
+
+  printf("%-24s %6s %5s %8s %8s %6s %8s %8s %10s %10s\n", "slave", "addr", "state", "wkc", "errors",
+         "sdo", "done", "failed", "last[us]", "max[us]");
+  for (uint32_t i = 0; i < p.numSlaves && i < BUSSTATS_MAX_SLAVES; i++) {
+    const BusStatsSlave& s = p.slaves[i];
+    printf("%-24.24s %6u %5u %8u %8u %6u %8u %8u %10u %10u\n", s.name, s.stationAddress, s.state,
+           s.wkcErrors, s.errors, s.sdoPending, s.sdoTransfers, s.sdoFailed,
+           s.sdoLastLatencyUs, s.sdoMaxLatencyUs);
+  }
+  printf("\n");
+}
+
+// statistics page reader
+int main (int argc, char *argv[]) {
+
+  ProgOpt opt(argv[0], "prints the statistics page of a running ethercat master.",
+              argc,argv);
+  opt.add(' ',"name", false, "shared memory name", "/hwl_ec_stats");
+  opt.add(' ',"period", false, "print period in ms, 0 prints once", "1000");
+  opt.std_parse();
+
+  string name           = opt.val<string>("name");
+  unsigned int period   = opt.val<unsigned int>("period");
+
+  int fd = shm_open(name.c_str(), O_RDONLY, 0);
+  if (fd < 0) {
+    perr("Cannot open %s. Is the master running?\n", name.c_str());
+    return EXIT_FAILURE;
+  }
+
+  void* ptr = mmap(NULL, sizeof(BusStatsPage), PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (ptr == MAP_FAILED) {
+    perr("Cannot map %s\n", name.c_str());
+    return EXIT_FAILURE;
+  }
+
+  const BusStatsPage* page = (const BusStatsPage*) ptr;
+  BusStatsPage copy;
+
+  do {
+    if (!BusStatsPublisher::read(page, copy)) {
+      perr("%s: no consistent statistics (version %u, expected %u)\n", name.c_str(), page->version, BUSSTATS_VERSION);
+    } else {
+      printPage(copy);
+    }
+    usleep(period * 1000);
+  } while (period > 0);
+
+  munmap(ptr, sizeof(BusStatsPage));
+  return 0;
+}
@@ -0,0 +1,343 @@
+//
+//  eni_codegen.cpp
+//  am2b
+//
+//  Generates a C++ header with constexpr PDO layouts and typed
+//  accessors from an ENI file. See StaticPdo.hpp.
+//
+//  Usage: eni_codegen --eni eni.xml --out eni_layout.hpp --ns lola [--exclude A,B]
+//
+//  The generated header contains one struct per slave in ec::<ns>::slaves
+//  and the struct ec::<ns>::Config for the complete process image.
+//  Slaves driven through linked bus variables are left out of Config
+//  with --exclude (comma separated ENI slave names).
+//
+//  Copyright 2015 Chair of Applied Mechanics, TUM
+//  https://www.amm.mw.tum.de/
+//
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <set>
+
+#include "EniVarDirectory.hpp"
+
+#include <xstdio.h>
+#include <progopt.hpp>
+
+using namespace std;
+using namespace am2b;
+using namespace ec;
+
+/*! Variables of one slave */
+struct SlaveLayout {
+  std::string             name;         //!< ENI slave name
+  std::string             identifier;   //!< C++ identifier
+  uint16_t                physAddr;
+  std::vector<EniVar>     inputs;
+  std::vector<EniVar>     outputs;
+  std::vector<std::string> skipped;     //!< entries left to the dynamic path
+  bool                    excluded = false; //!< not part of Config (--exclude)
+};
+
+//! Turn an arbitrary ENI name into a C++ identifier
+std::string toIdentifier(const std::string& name) {
+
+  std::string id;
+  bool lastUnderscore = true;
+
+  for (std::string::const_iterator it = name.begin(); it != name.end(); ++it) {
+    if (isalnum((unsigned char) *it)) {
+      id.push_back(*it);
+      lastUnderscore = false;
+    } else if (!lastUnderscore) {
+      id.push_back('_');
+      lastUnderscore = true;
+    }
+  }
+
+  while (!id.empty() && id[id.size()-1] == '_') {
+    id.erase(id.size()-1);
+  }
+  if (id.empty() || isdigit((unsigned char) id[0])) {
+    id.insert(0, "_");
+  }
+  return id;
+}
+
+//! Make the identifier unique within the given set
+std::string makeUnique(const std::string& id, std::set<std::string>& used) {
+  std::string unique = id;
+  for (int i = 2; used.count(unique); i++) {
+    unique = id + "_" + std::to_string(i);
+  }
+  used.insert(unique);
+  return unique;
+}
+
+//! Returns the C++ type for a CoE data type, NULL if unsupported
+const char* cppType(uint16_t dataType) {
+
+  switch (dataType) {
+    case ENI_DEFTYPE_BOOLEAN:     return "bool";
+    case ENI_DEFTYPE_INTEGER8:    return "int8_t";
+    case ENI_DEFTYPE_INTEGER16:   return "int16_t";
+    case ENI_DEFTYPE_INTEGER32:   return "int32_t";
+    case ENI_DEFTYPE_INTEGER64:   return "int64_t";
+    case ENI_DEFTYPE_UNSIGNED8:   return "uint8_t";
+    case ENI_DEFTYPE_UNSIGNED16:  return "uint16_t";
+    case ENI_DEFTYPE_UNSIGNED32:  return "uint32_t";
+    case ENI_DEFTYPE_UNSIGNED64:  return "uint64_t";
+    case ENI_DEFTYPE_REAL32:      return "float";
+    case ENI_DEFTYPE_REAL64:      return "double";
+  }
+  return NULL;
+}
+
+//! Writes the struct and the copy function for one direction
+void writeDirection(std::ostream& out, const EniVarDirectory& dir, const SlaveLayout& slave,
+                    const std::vector<EniVar>& vars, bool isOutput) {
+
+  const char* typeName = isOutput ? "Outputs" : "Inputs";
+  std::set<std::string> used;
+  std::vector<std::string> ids;
+
+  // strip the slave name from the variable names
+  for (std::vector<EniVar>::const_iterator it = vars.begin(); it != vars.end(); ++it) {
+    std::string name = dir.getName(*it);
+    if (!slave.name.empty() && name.compare(0, slave.name.size() + 1, slave.name + ".") == 0) {
+      name = name.substr(slave.name.size() + 1);
+    }
+    ids.push_back(makeUnique(toIdentifier(name), used));
+  }
+
+  // bit offsets and sizes
+  out << "    //! " << typeName << " layout (bit offset, bit size)\n";
+  out << "    struct " << typeName << "Layout {\n";
+  for (size_t i = 0; i < vars.size(); i++) {
+    out << "      typedef PdoField<" << cppType(vars[i].dataType) << ", " << vars[i].bitOffset << ", "
+        << vars[i].bitSize << "> " << ids[i] << ";\n";
+  }
+  out << "    };\n\n";
+
+  // value struct
+  out << "    //! " << typeName << " values\n";
+  out << "    struct " << typeName << " {\n";
+  for (size_t i = 0; i < vars.size(); i++) {
+    out << "      " << cppType(vars[i].dataType) << " " << ids[i] << ";\n";
+  }
+  if (vars.empty()) {
+    out << "      uint8_t _unused;\n";
+  }
+  out << "    };\n\n";
+
+  // copy function
+  if (isOutput) {
+    out << "    //! Write all outputs to the process image\n";
+    out << "    static inline void writeOutputs(uint8_t* image, const Outputs& v) {\n";
+    for (size_t i = 0; i < vars.size(); i++) {
+      out << "      OutputsLayout::" << ids[i] << "::write(image, v." << ids[i] << ");\n";
+    }
+    if (vars.empty()) {
+      out << "      (void) image; (void) v;\n";
+    }
+    out << "    }\n\n";
+
+    out << "    //! True if writeOutputs() writes to the given bit range\n";
+    out << "    static constexpr bool writesOutput(uint32_t bitOffset, uint32_t bitSize) {\n";
+    out << "      return (void) bitOffset, (void) bitSize, false";
+    for (size_t i = 0; i < vars.size(); i++) {
+      out << "\n          || OutputsLayout::" << ids[i] << "::overlaps(bitOffset, bitSize)";
+    }
+    out << ";\n";
+  } else {
+    out << "    //! Read all inputs from the process image\n";
+    out << "    static inline void readInputs(const uint8_t* image, Inputs& v) {\n";
+    for (size_t i = 0; i < vars.size(); i++) {
+      out << "      v." << ids[i] << " = InputsLayout::" << ids[i] << "::read(image);\n";
+    }
+    if (vars.empty()) {
+      out << "      (void) image; (void) v;\n";
+    }
+  }
+  out << "    }\n\n";
+}
+
+// ENI to C++ code generator
+int main (int argc, char *argv[]) {
+
+  ProgOpt opt(argv[0], "generates constexpr PDO layouts from an eni file.",
+              argc,argv);
+  opt.add(' ',"eni", true, "path to eni-xml file","eni.xml");
+  opt.add(' ',"out", true, "output header","eni_layout.hpp");
+  opt.add(' ',"ns", false, "namespace for the generated code (inside ec::)","eni");
+  opt.add(' ',"exclude", false, "slaves left out of Config (comma separated, driven by bus variables)","");
+  opt.std_parse();
+
+  string eniFile    = opt.val<string>("eni");
+  string outFile    = opt.val<string>("out");
+  string ns         = opt.val<string>("ns");
+  string exclude    = opt.val<string>("exclude");
+
+  std::set<std::string> excluded;
+  std::istringstream excludeList(exclude);
+  for (std::string name; std::getline(excludeList, name, ','); ) {
+    if (!name.empty()) {
+      excluded.insert(name);
+    }
+  }
+
+  EniVarDirectory dir;
+  if (dir.load(eniFile)) {
+    return EXIT_FAILURE;
+  }
+
+  // group the variables by slave. Variables without slave prefix (e.g. Inputs.BusTime)
+  // go to the "Master" group
+  std::vector<SlaveLayout> slaves(1);
+  std::set<std::string> usedSlaveIds;
+  slaves[0].identifier = makeUnique("Master", usedSlaveIds);
+  slaves[0].physAddr = 0;
+
+  for (std::vector<EniSlave>::const_iterator it = dir.getSlaves().begin(); it != dir.getSlaves().end(); ++it) {
+    SlaveLayout slave;
+    slave.name = it->name;
+    slave.identifier = makeUnique(toIdentifier(it->name), usedSlaveIds);
+    slave.physAddr = it->physAddr;
+    slave.excluded = excluded.erase(it->name) > 0;
+    slaves.push_back(slave);
+  }
+
+  for (std::set<std::string>::const_iterator it = excluded.begin(); it != excluded.end(); ++it) {
+    pwrn("--exclude: no slave %s in %s\n", it->c_str(), eniFile.c_str());
+  }
+
+  for (std::vector<EniVar>::const_iterator it = dir.getVars().begin(); it != dir.getVars().end(); ++it) {
+
+    std::string name = dir.getName(*it);
+
+    // longest matching slave prefix
+    size_t best = 0;
+    for (size_t s = 1; s < slaves.size(); s++) {
+      const std::string& prefix = slaves[s].name;
+      if (name.size() > prefix.size() && name.compare(0, prefix.size(), prefix) == 0 && name[prefix.size()] == '.'
+          && (best == 0 || prefix.size() > slaves[best].name.size())) {
+        best = s;
+      }
+    }
+
+    if (cppType(it->dataType) == NULL) {
+      slaves[best].skipped.push_back(name);
+      continue;
+    }
+
+    if (it->isOutput) {
+      slaves[best].outputs.push_back(*it);
+    } else {
+      slaves[best].inputs.push_back(*it);
+    }
+  }
+
+  std::ofstream out(outFile.c_str());
+  if (!out) {
+    perr("Cannot open %s for writing\n", outFile.c_str());
+    return EXIT_FAILURE;
+  }
+
+  std::string guard = toIdentifier(outFile);
+  for (std::string::iterator it = guard.begin(); it != guard.end(); ++it) {
+    *it = toupper((unsigned char) *it);
+  }
+  guard += "_GENERATED";
+
+  out << "//\n"
+      << "//  " << outFile << "\n"
+      << "//  am2b\n"
+      << "//\n"
+      << "//  GENERATED by eni_codegen from " << eniFile << ". Do not edit.\n"
+      << "//\n\n"
+      << "#ifndef " << guard << "\n"
+      << "#define " << guard << "\n\n"
+      << "#include \"StaticPdo.hpp\"\n\n"
+      << "namespace ec {\n"
+      << "namespace " << ns << " {\n\n"
+      << "  //! Process image sizes in bytes\n"
+      << "  constexpr uint32_t inputByteSize = " << dir.getInputByteSize() << ";\n"
+      << "  constexpr uint32_t outputByteSize = " << dir.getOutputByteSize() << ";\n\n"
+      << "namespace slaves {\n\n";
+
+  for (std::vector<SlaveLayout>::const_iterator it = slaves.begin(); it != slaves.end(); ++it) {
+
+    if (it->inputs.empty() && it->outputs.empty() && it->skipped.empty() && it != slaves.begin()) {
+      // slave without process data (e.g. coupler)
+      continue;
+    }
+
+    out << "  /*! " << (it->name.empty() ? std::string("Variables without slave") : it->name) << " */\n"
+        << "  struct " << it->identifier << " {\n\n"
+        << "    static constexpr uint16_t physAddr = " << it->physAddr << ";\n\n";
+
+    for (std::vector<std::string>::const_iterator sk = it->skipped.begin(); sk != it->skipped.end(); ++sk) {
+      out << "    // not generated (array/unsupported type, use the dynamic path): " << *sk << "\n";
+    }
+    if (!it->skipped.empty()) {
+      out << "\n";
+    }
+
+    writeDirection(out, dir, *it, it->inputs, false);
+    writeDirection(out, dir, *it, it->outputs, true);
+    out << "  };\n\n";
+  }
+
+  out << "}\n\n";
+
+  // complete configuration
+  out << "  /*! All slaves of the configuration. Use with StaticPdoBinding<Config> */\n"
+      << "  struct Config {\n\n";
+  for (std::vector<SlaveLayout>::const_iterator it = slaves.begin(); it != slaves.end(); ++it) {
+    if (it->excluded) out << "    // excluded (bus variables): " << it->identifier << "\n";
+  }
+  out << "    struct Inputs {\n";
+  for (std::vector<SlaveLayout>::const_iterator it = slaves.begin(); it != slaves.end(); ++it) {
+    if (!it->inputs.empty() && !it->excluded) out << "      slaves::" << it->identifier << "::Inputs " << it->identifier << ";\n";
+  }
+  out << "      uint8_t _unused;\n"
+      << "    };\n\n"
+      << "    struct Outputs {\n";
+  for (std::vector<SlaveLayout>::const_iterator it = slaves.begin(); it != slaves.end(); ++it) {
+    if (!it->outputs.empty() && !it->excluded) out << "      slaves::" << it->identifier << "::Outputs " << it->identifier << ";\n";
+  }
+  out << "      uint8_t _unused;\n"
+      << "    };\n\n"
+      << "    static inline void readInputs(const uint8_t* image, Inputs& v) {\n";
+  for (std::vector<SlaveLayout>::const_iterator it = slaves.begin(); it != slaves.end(); ++it) {
+    if (!it->inputs.empty() && !it->excluded) out << "      slaves::" << it->identifier << "::readInputs(image, v." << it->identifier << ");\n";
+  }
+  out << "      (void) image; (void) v;\n"
+      << "    }\n\n"
+      << "    static inline void writeOutputs(uint8_t* image, const Outputs& v) {\n";
+  for (std::vector<SlaveLayout>::const_iterator it = slaves.begin(); it != slaves.end(); ++it) {
+    if (!it->outputs.empty() && !it->excluded) out << "      slaves::" << it->identifier << "::writeOutputs(image, v." << it->identifier << ");\n";
+  }
+  out << "      (void) image; (void) v;\n"
+      << "    }\n\n"
+      << "    static constexpr bool writesOutput(uint32_t bitOffset, uint32_t bitSize) {\n"
+      << "      return (void) bitOffset, (void) bitSize, false";
+  for (std::vector<SlaveLayout>::const_iterator it = slaves.begin(); it != slaves.end(); ++it) {
+    if (!it->outputs.empty() && !it->excluded) out << "\n          || slaves::" << it->identifier << "::writesOutput(bitOffset, bitSize)";
+  }
+  out << ";\n"
+      << "    }\n"
+      << "  };\n\n"
+      << "}\n"
+      << "}\n\n"
+      << "#endif /* end of include guard: " << guard << " */\n";
+
+  pmsg("Generated %s: %u slaves, %u process variables\n", outFile.c_str(),
+       (unsigned int) dir.getSlaves().size(), (unsigned int) dir.getVars().size());
+
+  return 0;
+}
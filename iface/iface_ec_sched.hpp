@@ -0,0 +1,30 @@
+/*
+  @file iface_ec_sched.hpp
+
+  Scheduling settings (priorities, cpu affinity, stack size)
+  shared by the EtherCAT master threads and the timing tools
+
+  Copyright  Institute of Applied Mechanics, TU-Muenchen
+  All rights reserved.
+*/
+
+#ifndef __IFACE_EC_SCHED_HPP__
+#define __IFACE_EC_SCHED_HPP__
+
+#include "iface_prio.hpp"
+
+/* Scheduling Settings */
+#define HWL_EC_TIMING_THREAD_PRIO           PRIO_EC_TIMING()
+#define HWL_EC_JOB_THREAD_PRIO              PRIO_EC_JOBTASK()
+#define HWL_EC_JOB_THREAD_STACKSIZE         0x4000
+#define HWL_EC_NOTIFY_THREAD_PRIO           PRIO_LOG()  //!< formatting of stack notifications
+#define HWL_EC_TIMING_THREAD_CPU            1     //!< CPU used for the timing task
+#define HWL_EC_COMPANION_THREAD_PRIO        PRIO_CONT() //!< master timer and acyclic frames, see HWL_EC_COMPANION_DIVISOR
+#define HWL_EC_COMPANION_DIVISOR            0     //!< companion thread every n cycles, 0: these jobs run in the job task
+
+// It is important to run the main thread on a different CPU
+// (or to not use cpu affinity at all for the main thread)
+// Use -1 to disable cpu affinity (currently recommended)
+#define HWL_EC_MAIN_THREAD_CPU              -1     //!< CPU used for the calling thread
+
+#endif//__IFACE_EC_SCHED_HPP__
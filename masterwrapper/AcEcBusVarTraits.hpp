@@ -14,6 +14,7 @@
 #define ACECBUSVARTRAITS_HPP_555DA5B2
 
 #include <typeinfo>
+#include <stdint.h>
 #include <EcType.h>
 #include "BusException.hpp"
 
@@ -24,8 +25,8 @@ namespace ec {
   
   public:
     
-    /*! for PDO only: offset to the data area*/
-    int               m_offset;
+    /*! for PDO only: offset to the data area, -1 if not linked */
+    int               m_offset = -1;
     
     /*! for SDO only: Pointer to the mailbox object */
     EC_T_MBXTFER*     m_tferObj = 0;
@@ -38,6 +39,12 @@ namespace ec {
     
     /*! for SDO only: subindex */
     EC_T_BYTE         m_subIdx;
+
+    /*! for SDO only: slave index in the statistics page, -1 if none */
+    int               m_statsIdx = -1;
+
+    /*! for SDO only: request time of the asynchronous transfer in ns (see BusStats.hpp) */
+    uint64_t          m_SDORequestNs = 0;
   };
   
 }
@@ -37,6 +37,11 @@ namespace ec {
       return str;
     }
   
+    /*! Sets the instance of the EtherCAT stack the slave is connected to (done by the master) */
+    void setMasterInstance(EC_T_DWORD instanceId) {
+      m_masterInstance = instanceId;
+    }
+
     /*! Returns the station address */
     EC_T_WORD getStationAddress() {
       return m_stationAddress;
@@ -47,14 +52,14 @@ namespace ec {
     
       // try to update slave ID if invalid
       if (m_slaveID == INVALID_SLAVE_ID) {
-        m_slaveID = ecatGetSlaveId(this->getStationAddress());
+        m_slaveID = emGetSlaveId(m_masterInstance, this->getStationAddress());
       }
     
       return m_slaveID;
     }
   
     /*! Returns the slave name */
-    std::string getName() {
+    const std::string& getName() {
       return m_slaveName;
     }
   
@@ -71,6 +76,9 @@ namespace ec {
     //! AcEc Slave ID
     EC_T_DWORD    m_slaveID = INVALID_SLAVE_ID;
 
+    //! Instance of the EtherCAT stack
+    EC_T_DWORD    m_masterInstance = 0;
+
   };
 
 }
@@ -18,40 +18,132 @@
 #include <exception>
 #include <string.h>
 #include <math.h>
+#include <algorithm>
+#include <mutex>
+#include <memory>
+#include <set>
 
 #include <xstdio.h>
 #include <xtrace.h>
 #include <iface_prio.hpp>
+#include <iface_ec_sched.hpp>
 
 #include "AcEcBusVarTraits.hpp"
 #include "BusMaster.hpp"
 #include "BusException.hpp"
 #include "BusVar.hpp"
-#include "LogRateLimiter.hpp"
+#include "KeyedLogLimiter.hpp"
+#include "EniVarDirectory.hpp"
+#include "StaticPdo.hpp"
+#include "DcmLog.hpp"
+#include "LockFreeQueue.hpp"
+#include "BusStats.hpp"
+#include "CycleTracer.hpp"
+#include "BusVarArena.hpp"
+#include "CycleCallback.hpp"
+#include "WorkerPool.hpp"
+#include "SlaveSchedule.hpp"
+#include "ThreadTopology.hpp"
+#include "BusRecovery.hpp"
 
-#include <log_buf.hpp>
 
 namespace ec {
 
-  //! static variable to generate unique ids
-  static EC_T_DWORD AcEcGlobalUIDCounter=1;
+  /*! Master instances of this process. Each AcEcMaster uses its own
+      instance of the stack (em* API), the ids must be unique. */
+  class AcEcInstanceRegistry {
+
+  public:
+
+    /*! Register an instance id. Returns true if the id is already in use */
+    static bool claim(EC_T_DWORD instanceId) {
+      std::lock_guard<std::mutex> lock(mutex());
+      return !ids().insert(instanceId).second;
+    }
+
+    /*! Unregister an instance id. Returns the number of remaining instances */
+    static size_t release(EC_T_DWORD instanceId) {
+      std::lock_guard<std::mutex> lock(mutex());
+      ids().erase(instanceId);
+      if (ids().empty()) {
+        clockPeriodUs() = 0;
+      }
+      return ids().size();
+    }
+
+    /*! The deferred log thread (xlog.h) is process-wide. Returns the number
+        of instances using it, including the caller */
+    static size_t attachLogging() {
+      std::lock_guard<std::mutex> lock(mutex());
+      return ++loggingUsers();
+    }
+
+    /*! Returns the number of instances still using the log thread */
+    static size_t detachLogging() {
+      std::lock_guard<std::mutex> lock(mutex());
+      return --loggingUsers();
+    }
+
+    /*! The timer tick (QNX ClockPeriod) is process-wide. The first instance
+        sets it to its cycle time, the others have to run a multiple of it.
+        Returns the tick in microseconds. */
+    static unsigned int shareClockPeriod(unsigned int cycleTimeUs) {
+      std::lock_guard<std::mutex> lock(mutex());
+      if (clockPeriodUs() == 0) {
+        clockPeriodUs() = cycleTimeUs;
+      }
+      return clockPeriodUs();
+    }
+
+  private:
+
+    static std::mutex& mutex() {
+      static std::mutex m;
+      return m;
+    }
+
+    static std::set<EC_T_DWORD>& ids() {
+      static std::set<EC_T_DWORD> s;
+      return s;
+    }
+
+    static unsigned int& clockPeriodUs() {
+      static unsigned int us = 0;
+      return us;
+    }
+
+    static size_t& loggingUsers() {
+      static size_t n = 0;
+      return n;
+    }
+
+  };
+
+  /*! Execution time of the process() call of one slave */
+  struct SlaveProcessTiming {
+
+    SlaveProcessTiming() {
+    }
+
+    SlaveProcessTiming(const SlaveProcessTiming& other)
+      : lastUs(other.lastUs.load()), maxUs(other.maxUs.load()) {
+    }
+
+    std::atomic<uint32_t>   lastUs{0};      //!< last execution time
+    std::atomic<uint32_t>   maxUs{0};       //!< maximum execution time
+  };
 
   /* Settings for the EtherCAT Master Stack */
   #define HWL_EC_MAX_NUM_SLAVES               35
   #define HWL_EC_TIMEOUT_STATE_CHANGE_MS      15000
   #define HWL_EC_TRY_LOCK_TIMEOUT_SCALE       100   //!< if the buscycletime is 1ms, lock timeout = 10us
   #define HWL_EC_SYNC_COE_TIMEOUT_MS          500   //!< Timeout for synchronuous CoE transfer
+  #define HWL_EC_NOTIFY_QUEUE_SIZE            256   //!< notifications queued for the notification thread (power of 2)
+  #define HWL_EC_NOTIFY_WAIT_MS               100   //!< max. wait time of the notification thread
+  #define HWL_EC_STATS_SHM_NAME               "/hwl_ec_stats" //!< shared memory statistics page, see ec_stats
+  #define HWL_EC_TRACE_FILE                   "mastertrace.json" //!< timeline written at shutdown if tracing is enabled
   
-  /* Scheduling Settings */
-  #define HWL_EC_TIMING_THREAD_PRIO           PRIO_EC_TIMING()
-  #define HWL_EC_JOB_THREAD_PRIO              PRIO_EC_JOBTASK()
-  #define HWL_EC_JOB_THREAD_STACKSIZE         0x4000
-  #define HWL_EC_TIMING_THREAD_CPU            1     //!< CPU used for the timing task
-
-  // It is important to run the main thread on a different CPU
-  // (or to not use cpu affinity at all for the main thread)
-  // Use -1 to disable cpu affinity (currently recommended)
-  #define HWL_EC_MAIN_THREAD_CPU              -1     //!< CPU used for the calling thread
+  /* Scheduling Settings, see iface_ec_sched.hpp */
 
   //! Verbose state for BusMaster (Wrapper implementation)
   //! define to enable verbose output to cmd line
@@ -65,8 +157,17 @@ namespace ec {
   //! the message rate is reduced
   #define HWL_EC_MAX_MSG_PER_ERROR 10
   
-  //! Reduced message rate. 10 = reports every 10th occurrence
-  #define HWL_EC_REDUCED_MSG_RATE 2000
+  //! After HWL_EC_MAX_MSG_PER_ERROR messages, one message per event
+  //! and slave is logged per HWL_EC_LOG_REFILL_MS (see KeyedLogLimiter)
+  #define HWL_EC_LOG_REFILL_MS                1000
+  //! Period of the summaries for suppressed messages
+  #define HWL_EC_LOG_SUMMARY_PERIOD_MS        10000
+  //! Event code for system overload messages of the job task (no stack notification)
+  #define HWL_EC_LOG_CODE_OVERLOAD            0xFFFF0001
+  //! Event code for cycle callbacks exceeding their budget
+  #define HWL_EC_LOG_CODE_CALLBACK_BUDGET     0xFFFF0002
+  //! Event code for cycles in which the companion thread was still busy
+  #define HWL_EC_LOG_CODE_COMPANION_BUSY      0xFFFF0003
 
   /* Distributed Clocks */
   #undef HWL_EC_DC_PRINT_STATUS                    //!< debugging only, activate verbose info on console about distributed clocks
@@ -76,6 +177,16 @@ namespace ec {
   #define HWL_EC_DC_BURST_BULK                12      //!< burst bulk (static drift compensation)
 
   #define HWL_EC_DCM_SETTLE_TIME              1500    //!< DCM settle time in ms
+  #define HWL_EC_DCM_LOG_FILE                 "masterdcm.dcm" //!< binary DCM log, see dcm_decode
+  #define HWL_EC_DCM_LOG_SIZE                 8192    //!< DCM log ring size in cycles
+
+  /* Bus recovery, see BusRecovery.hpp */
+  #define HWL_EC_INCREMENTAL_RECOVERY         true    //!< recover dropped slaves only, the others stay in OP
+  #define HWL_EC_RECOVERY_STATE_TIMEOUT_MS    3000    //!< timeout of a state change during a recovery
+  #define HWL_EC_RECOVERY_MAX_RETRIES         2       //!< restarts of a slave recovery before the bus-wide recovery
+  #define HWL_EC_RECOVERY_RECONNECT_TIMEOUT_MS 10000  //!< wait for a dropped slave before the bus-wide recovery
+  #define HWL_EC_RECOVERY_SCAN_INTERVAL_MS    100     //!< interval of the scan for slaves which left OP
+  #define HWL_EC_RECOVERY_LOG_SIZE            32      //!< finished recoveries kept for getRecoveryLog()
 
   /* RAS Server (Online Diagnosis) */
   #define HWL_EC_RAS_REMOTE_CYCLE_TIME        2     //!< ms, update time for RaS
@@ -149,6 +260,24 @@ namespace ec {
     thisPtr->runJobTask();
   }
   
+  /*! wrapper for the thread-run function ptr to class member runNotifyTask */
+  template <class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy> void AcEcNotifyTaskWrapper(void* instance) {
+
+    AcEcMaster<SlaveInstanceMapperPolicy, EcLinkLayerPolicy>* thisPtr = static_cast<AcEcMaster<SlaveInstanceMapperPolicy, EcLinkLayerPolicy>* > (instance);
+
+    // call the member function
+    thisPtr->runNotifyTask();
+  }
+
+  /*! wrapper for the thread-run function ptr to class member runCompanionTask */
+  template <class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy> void AcEcCompanionTaskWrapper(void* instance) {
+
+    AcEcMaster<SlaveInstanceMapperPolicy, EcLinkLayerPolicy>* thisPtr = static_cast<AcEcMaster<SlaveInstanceMapperPolicy, EcLinkLayerPolicy>* > (instance);
+
+    // call the member function
+    thisPtr->runCompanionTask();
+  }
+
   /*! wrapper for the thread-run function ptr to class member timingTask */
   template <class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy> void AcEcTimingTaskWrapper(void* instance) {
 
@@ -168,23 +297,46 @@ namespace ec {
     using BusMaster<SlaveInstanceMapperPolicy>::m_variablesSDO;
     using BusMaster<SlaveInstanceMapperPolicy>::m_fault;
     using BusMaster<SlaveInstanceMapperPolicy>::m_slaves;
+    using BusMaster<SlaveInstanceMapperPolicy>::m_groups;
     using BusMaster<SlaveInstanceMapperPolicy>::m_cycleCounter;
+    using BusMaster<SlaveInstanceMapperPolicy>::m_inputStamp;
 
   public:
   
-    //! Constructor
-    AcEcMaster() : m_overloadLogRateLimiter(HWL_EC_MAX_MSG_PER_ERROR, HWL_EC_REDUCED_MSG_RATE) {
+    /*! Constructor
+        \param instanceId Instance of the EtherCAT stack. Several masters, each
+               with its own link layer (network port), run in one process
+               with different ids. Throws an exception if the id is in use.
+    */
+    AcEcMaster(EC_T_DWORD instanceId = 0) : m_instanceId(instanceId), m_logLimiter(HWL_EC_MAX_MSG_PER_ERROR, HWL_EC_LOG_REFILL_MS, HWL_EC_LOG_SUMMARY_PERIOD_MS) {
+
+      if (AcEcInstanceRegistry::claim(m_instanceId)) {
+        perrMaster("Instance %u is already in use!\n", m_instanceId);
+        throw BusException("EtherCAT Master instance already in use!");
+      }
     }
     
     /*! Destructor */
     ~AcEcMaster() {
       this->shutdown();
     
-      /* final OS layer cleanup */
-      OsDeinit();
+      /* final OS layer cleanup, shared by all instances */
+      if (AcEcInstanceRegistry::release(m_instanceId) == 0) {
+        OsDeinit();
+      }
     
       pmsgMaster("Goodbye!\n");
     }
+
+    /*! Returns the instance id of the EtherCAT stack */
+    EC_T_DWORD getInstanceId() const {
+      return m_instanceId;
+    }
+
+    /*! Returns the link layer, e.g. to select the network port before init() */
+    EcLinkLayerPolicy& getLinkLayer() {
+      return m_linkLayer;
+    }
   
     /*! Initializes the EtherCAT Master stack.
       
@@ -195,7 +347,16 @@ namespace ec {
   
         Throws an exception if initialization fails
     */
-    void init(unsigned int busCycleTimeUs, bool enableDC = true, bool enableOnlineDiagnosis = false, bool logDCStatus = false);
+    void init(unsigned int busCycleTimeUs, bool enableDC = true, bool enableOnlineDiagnosis = false, bool logDCStatus = false) {
+      init(busCycleTimeUs, ThreadTopology(), enableDC, enableOnlineDiagnosis, logDCStatus);
+    }
+
+    /*! Same as init() with the scheduling of the master threads given
+        by topology instead of iface_ec_sched.hpp (see ThreadTopology.hpp).
+        The topology is validated and reported before the threads are started.
+    */
+    void init(unsigned int busCycleTimeUs, const ThreadTopology& topology, bool enableDC = true,
+              bool enableOnlineDiagnosis = false, bool logDCStatus = false);
   
     /*! Shut down the master, also called by the destructor */
     void shutdown();
@@ -204,18 +365,30 @@ namespace ec {
     EC_T_DWORD configure(const std::string& eniFile);
     
     
+    /*! Registers a slave and binds it to the instance of this master */
+    void registerSlave(BusSlave<SlaveInstanceMapperPolicy>* slave) {
+      slave->setMasterInstance(m_instanceId);
+      BusMaster<SlaveInstanceMapperPolicy>::registerSlave(slave);
+    }
+
     /*! Returns the current state of the EtherCAT Bus */
     BusState getState();
       
       
     /*! Sets the requested state of the EtherCAT Bus.
+
+        The first call moves the linked lock-free variables to the arena
+        of the master (see BusVarArena.hpp). The bus variables must not be
+        accessed by other threads during this call, no variables can be
+        linked afterwards.
         
         \param reqState Requested BusState
         \param blocking Switch synronously (blocking), defaults to true
     */
     void setRequestedState(const BusState& reqState, const bool& blocking=true);
     
-    /*! Returns the current BusTime in nanoseconds. */
+    /*! Returns the current BusTime in nanoseconds (lower 32 bit).
+        See getInputStamp() for the 64 bit bus time of the current inputs. */
     uint32_t getBusTime() {
       return m_busTime;
     }
@@ -264,6 +437,107 @@ namespace ec {
       return m_busCycleTimeUs;
     }
 
+    /*! Returns the process variable directory read from the ENI file in configure() */
+    const EniVarDirectory& getEniDirectory() {
+      return m_eniDirectory;
+    }
+
+    /*! Register a static PDO block (see eni_codegen and StaticPdo.hpp).
+        The block is exchanged once per cycle in addition to the linked
+        bus variables. Must be called before the bus is started.
+        The block writes all of its outputs every cycle, it must not contain
+        outputs of linked bus variables (reported on the first state request).
+    */
+    void registerStaticPdo(StaticPdoExchange* block) {
+      m_staticPdo.push_back(block);
+    }
+
+    /*! Register a callback, which the job task calls every cycle between
+        the input and the output copy (see CycleCallback.hpp). Outputs set by
+        the callback are sent with the frame following the inputs it read.
+        Linked outputs have to be set through their bus variables, the output
+        copy overwrites them in the process image after the callback.
+        Executions longer than budgetUs are counted and reported.
+        Must be called before init(), the job task iterates the callbacks
+        without locking.
+        Returns true if an error occurs (job task already running)
+    */
+    bool registerCycleCallback(CycleCallbackFn fn, void* userData, uint32_t budgetUs, const char* name = "callback") {
+      if (m_jobThread != NULL || m_jobThreadRunning) {
+        perrMaster("Cycle callback %s registered after the job task has been started\n", name);
+        return true;
+      }
+      m_cycleCallbacks.emplace_back(fn, userData, budgetUs, name);
+      return false;
+    }
+
+    /*! Registered cycle callbacks with their execution time statistics */
+    const std::vector<CycleCallbackEntry>& getCycleCallbacks() const {
+      return m_cycleCallbacks;
+    }
+
+    /*! Run the process() calls of the slaves on numWorkers worker threads
+        in addition to the thread calling process(). Slaves which require
+        serial processing (BusSlave::requiresSerialProcess()) are processed
+        first in the calling thread. process() returns after all slaves are done.
+        \param cpus cpu of each worker, -1 or missing entries: no affinity
+        \param prio SCHED_FIFO priority of the workers, -1: inherited
+        numWorkers = 0 stops the workers. Call from the thread calling process().
+        Returns true if an error occurs
+    */
+    bool enableParallelProcess(unsigned int numWorkers, const std::vector<int>& cpus = std::vector<int>(), int prio = -1) {
+      m_processPool.stop();
+      if (numWorkers > 0 && m_processPool.start(numWorkers, cpus, prio)) {
+        perrMaster("Cannot start %u process() workers\n", numWorkers);
+        return true;
+      }
+      m_processSlavesSorted = 0;
+      return false;
+    }
+
+    /*! Execution time of the process() call of each slave, in the order of
+        registration. Call from the thread calling process() */
+    const std::vector<SlaveProcessTiming>& getProcessTiming() const {
+      return m_processTiming;
+    }
+
+    /*! Recovery after slave drop-outs while the bus is in OP.
+
+        Incremental (default): only the affected slaves are brought back through
+        INIT, PREOP and SAFEOP, the others stay in OP. The last step to OP waits
+        for resetFault(). A slave which does not reach a state within
+        HWL_EC_RECOVERY_STATE_TIMEOUT_MS is restarted, after HWL_EC_RECOVERY_MAX_RETRIES
+        restarts the whole bus goes through SAFEOP and INIT as without incremental recovery.
+    */
+    void enableIncrementalRecovery(bool enable) {
+      m_incrementalRecovery = enable;
+    }
+
+    /*! True while slaves or the bus are being recovered */
+    bool isRecovering() const {
+      return m_busRecoveryActive || m_busRecovery.isActive() || !m_slaveRecovery.empty();
+    }
+
+    /*! Timelines of the last finished recoveries, oldest first.
+        Call from the thread calling process() */
+    const std::vector<BusRecoveryRecord>& getRecoveryLog() const {
+      return m_recoveryLog;
+    }
+
+    /*! Record a timeline of the job task phases, slave process() calls and
+        asynchronous SDO transfers. Allocates the trace buffers on the first call.
+        The trace is written to HWL_EC_TRACE_FILE at shutdown, see also dumpTrace().
+    */
+    void enableTracing(bool enable) {
+      m_tracer.enable(enable);
+    }
+
+    /*! Write the recorded timeline as Chrome Trace Event JSON
+        (chrome://tracing, ui.perfetto.dev). Returns true if an error occurs */
+    bool dumpTrace(const std::string& fileName) {
+      return m_tracer.dump(fileName);
+    }
+
   protected:
     
     /*! Virtual method implementation for linking to PDO variables
@@ -271,6 +545,16 @@ namespace ec {
     bool linkPDOVar(BusSlave<SlaveInstanceMapperPolicy>* const slave, const std::string& varName, 
                     BusVarType* ptr);
 
+    /*! Virtual method implementation for linking a run of boolean PDO variables
+        to one BusBits. Called by BusSlave::linkPDOBits() */
+    bool linkPDOBits(BusSlave<SlaveInstanceMapperPolicy>* const slave, const std::vector<std::string>& varNames,
+                     BusVarType* ptr);
+
+    /*! Look up offset, size and type of a PDO variable in the ENI directory or
+        the stack. Returns true if an error occurs */
+    bool findPDOVar(BusSlave<SlaveInstanceMapperPolicy>* const slave, const std::string& varName, bool isOutput,
+                    EC_T_INT& bitSize, EC_T_INT& bitOffs, EC_T_WORD& dataType);
+
     /*! Virtual method implementation for linking to SDO variables
         This is called by the BusSlave methods to register a SDO variable */
     bool linkSDOVar(BusSlave<SlaveInstanceMapperPolicy>* const slave, const int& objIndex, 
@@ -300,7 +584,7 @@ namespace ec {
     /*! Changes EtherCAT bus state synchronuously (blocking) */
     EC_T_DWORD switchStateSync(const EC_T_STATE& reqState) {
     
-      m_lastRes = ecatSetMasterState(HWL_EC_TIMEOUT_STATE_CHANGE_MS, reqState);
+      m_lastRes = emSetMasterState(m_instanceId, HWL_EC_TIMEOUT_STATE_CHANGE_MS, reqState);
       if (m_lastRes != EC_E_NOERROR) {
         EC_FAULT; // fatal error during runtime
         LOG_EC_ERROR("Could not change bus state!", m_lastRes);
@@ -310,7 +594,7 @@ namespace ec {
         EC_T_DWORD dwStatus = 0;
         EC_T_INT   nDiffCur = 0, nDiffAvg = 0, nDiffMax = 0;
           
-        dwRes = ecatDcmGetStatus(&dwStatus, &nDiffCur, &nDiffAvg, &nDiffMax);
+        dwRes = emDcmGetStatus(m_instanceId, &dwStatus, &nDiffCur, &nDiffAvg, &nDiffMax);
         if (dwRes == EC_E_NOERROR) {
           if (dwStatus != EC_E_NOERROR) {
             perrMaster("DCM Status: %s (0x%08X)\n", ecatGetText(dwStatus), dwStatus);  
@@ -328,7 +612,7 @@ namespace ec {
     /*! Changes EtherCAT bus state asynchronuously (non-blocking) */
     EC_T_DWORD switchStateASync(const EC_T_STATE& reqState) {
     
-      m_lastRes = ecatSetMasterState(EC_NOWAIT, reqState);
+      m_lastRes = emSetMasterState(m_instanceId, EC_NOWAIT, reqState);
       if (m_lastRes != EC_E_NOERROR) {
         EC_FAULT; // fatal error during runtime
         LOG_EC_ERROR("Could not change bus state!", m_lastRes);
@@ -338,7 +622,7 @@ namespace ec {
         EC_T_DWORD dwStatus = 0;
         EC_T_INT   nDiffCur = 0, nDiffAvg = 0, nDiffMax = 0;
           
-        dwRes = ecatDcmGetStatus(&dwStatus, &nDiffCur, &nDiffAvg, &nDiffMax);
+        dwRes = emDcmGetStatus(m_instanceId, &dwStatus, &nDiffCur, &nDiffAvg, &nDiffMax);
         if (dwRes == EC_E_NOERROR) {
           if (dwStatus != EC_E_NOERROR) {
             perrMaster("DCM Status: %s (0x%08X)\n", ecatGetText(dwStatus), dwStatus);  
@@ -353,6 +637,15 @@ namespace ec {
       return m_lastRes;
     }
 
+    /*! Returns the index of the slave in the statistics page, adds the slave if necessary */
+    int statsSlave(BusSlave<SlaveInstanceMapperPolicy>* const slave) {
+      int idx = m_stats.findSlave(slave->getStationAddress());
+      if (idx < 0) {
+        idx = m_stats.addSlave(slave->getName(), slave->getStationAddress());
+      }
+      return idx;
+    }
+
     /*! Returns true if the given EtherCAT state is valid */
     bool isValidState(const EC_T_STATE& ecstate) {
       return (ecstate == eEcatState_INIT || 
@@ -375,13 +668,133 @@ namespace ec {
     */
     void runJobTask();
 
+    /*! Companion of the job task, lower priority. Runs the acyclic
+        jobs every m_companionDivisor cycles (see ThreadTopology::companionDivisor)
+    */
+    void runCompanionTask();
+
+    /*! Master timer, DCM log and acyclic frames (job task or companion thread) */
+    void runAcyclicJobs();
+
+    /*! Detect dropped slaves and advance their recovery while the bus stays in OP.
+        Returns true if a slave cannot be recovered (bus-wide recovery required) */
+    bool runSlaveRecovery(uint64_t nowNs);
+
+    /*! End all slave recoveries as failed */
+    void abortSlaveRecovery(uint64_t nowNs);
+
+    /*! Bus-wide recovery: all slaves through SAFEOP, INIT and back to OP */
+    void runBusRecovery(uint64_t nowNs);
+
+    /*! Keep a finished recovery for getRecoveryLog() and report it */
+    void logRecovery(const BusRecoveryRecord& record);
+
+    /*! Copy one input variable from the process image (job task) */
+    void copyInputVar(BusVarType* const var);
+
+    /*! Copy one output variable to the process image (job task) */
+    void copyOutputVar(BusVarType* const var);
+
+    /*! Pause the job task between two cycles, move the linked variables to
+        the arena, build the copy lists and publish them to the job task.
+        Called on the first state request, the variables must not be accessed
+        by other threads meanwhile.
+        Returns true if the job task did not pause in time, the variables are
+        copied one by one then */
+    bool requestPdoLayout();
+
+    /*! Build the arena and the copy lists and publish them (job task paused) */
+    void buildPdoLayout();
+
+    /*! Detach from the deferred log thread, the last instance stops it */
+    void stopLogging();
+
+    /*! Apply the affinity and scheduling of cfg to the calling thread.
+        Returns true if an error occurs */
+    bool setupThread(const ThreadConfig& cfg, const char* name);
+
+    /*! Name the calling thread, with the instance id appended for instances other than 0 */
+    void setThreadName(const char* name);
+
+    /*! File or shared memory name of this instance: the instance id is
+        inserted before the extension for instances other than 0 */
+    std::string instanceName(const char* name) const;
+
+    /*! Call process() on slave idx and record its execution time */
+    void processSlave(size_t idx);
+
+    /*! WorkerPool item: process the idx-th slave of m_dueSlaves */
+    static void processParallelSlave(void* instance, size_t idx) {
+      AcEcMaster* self = static_cast<AcEcMaster*>(instance);
+      self->processSlave(self->m_dueSlaves[idx]);
+    }
+
+    /*! True if slave idx is processed in the current call (see BusSlave::setProcessRate()) */
+    bool isSlaveDue(size_t idx) const {
+      return (m_processCalls % m_slaves[idx]->getProcessDivisor()) == m_processSlot[idx];
+    }
+
+    /*! How an entry of the copy list is exchanged */
+    enum PdoCopyKind {
+      PDO_COPY_LOCKED = 0,    //!< mutex-protected variable, copyInputVar() / copyOutputVar()
+      PDO_COPY_BOOL,          //!< lock-free std::atomic<bool>
+      PDO_COPY_8,             //!< lock-free slot of 1 byte
+      PDO_COPY_16,            //!< lock-free slot of 2 bytes
+      PDO_COPY_32,            //!< lock-free slot of 4 bytes
+      PDO_COPY_64             //!< lock-free slot of 8 bytes
+    };
+
+    /*! Packed per-variable data for the cyclic copy, in process image order.
+        Lock-free values are copied directly to / from their slot in the arena,
+        without a virtual call */
+    struct PdoCopyEntry {
+      BusVarType*   var;
+      void*         slot;
+      uint32_t      bitOffset;
+      uint32_t      bitSize;
+      PdoCopyKind   kind;
+    };
+
+    /*! Copy lists of the non-grouped variables, immutable once published */
+    struct PdoLayout {
+      std::vector<PdoCopyEntry> inputs;
+      std::vector<PdoCopyEntry> outputs;
+    };
+
+    /*! Copy kind of a linked variable */
+    static PdoCopyKind getPdoCopyKind(BusVarType* const var);
+
+    /*! Copy a lock-free value from the input image to its slot */
+    template<typename U> static void copyInputSlot(const EC_T_BYTE* image, const PdoCopyEntry& e) {
+      U tmp = 0;
+      EC_GETBITS(image, (EC_T_BYTE*) &tmp, e.bitOffset, e.bitSize);
+      reinterpret_cast<std::atomic<U>*>(e.slot)->store(tmp, std::memory_order_release);
+    }
+
+    /*! Copy a lock-free value from its slot to the output image */
+    template<typename U> static void copyOutputSlot(EC_T_BYTE* image, const PdoCopyEntry& e) {
+      U tmp = reinterpret_cast<const std::atomic<U>*>(e.slot)->load(std::memory_order_acquire);
+      EC_SETBITS(image, (EC_T_BYTE*) &tmp, e.bitOffset, e.bitSize);
+    }
+
     /* befriend the wrapper functions for callbacks to the class members*/
     friend EC_T_DWORD AcEcNotifyWrapper<SlaveInstanceMapperPolicy, EcLinkLayerPolicy > (EC_T_DWORD dwCode, EC_T_NOTIFYPARMS* pParms);
     friend void AcEcJobTaskWrapper<SlaveInstanceMapperPolicy, EcLinkLayerPolicy > (void* instance);
     friend void AcEcTimingTaskWrapper<SlaveInstanceMapperPolicy, EcLinkLayerPolicy > (void* instance);
+    friend void AcEcNotifyTaskWrapper<SlaveInstanceMapperPolicy, EcLinkLayerPolicy > (void* instance);
+    friend void AcEcCompanionTaskWrapper<SlaveInstanceMapperPolicy, EcLinkLayerPolicy > (void* instance);
 
     /* Private Members */
 
+    //! Instance of the EtherCAT stack
+    const EC_T_DWORD                m_instanceId;
+
+    //! Transfer ids of the mailbox transfer objects
+    std::atomic<EC_T_DWORD>         m_tferIdCounter{1};
+
+    //! Timer ticks (see AcEcInstanceRegistry::shareClockPeriod()) per bus cycle
+    unsigned int                    m_ticksPerCycle = 1;
+
     //! Result code for last operation
     EC_T_DWORD                      m_lastRes = 0;
 
@@ -402,6 +815,12 @@ namespace ec {
     
     //! newData event for sendDataReadyEvent() implementation
     void*                           m_newTXDataEvent = 0;
+
+    //! Pointer to notification thread
+    void*                           m_notifyThread = 0;
+
+    //! Signals new entries in m_notifyQueue
+    void*                           m_notifyEvent = 0;
     
     //! Timer object used for timeouts
     CEcTimer                        m_Timer;
@@ -412,6 +831,9 @@ namespace ec {
     //! flag indicates if the etherCAT Master is initialized or has already been deinitialized
     volatile bool                   m_initialized = false;  // 
 
+    //! This instance uses the deferred log thread (see AcEcInstanceRegistry::attachLogging())
+    bool                            m_loggingAttached = false;
+
     //! flag indicates if the etherCAT MAster is configured or has already been deconfigured
     volatile bool                   m_configured = false;
   
@@ -421,22 +843,60 @@ namespace ec {
     //! Handle for the RaS Remote diagnosis server
     EC_T_PVOID                      m_RasHandle = 0;
   
+    //! Scheduling of the master threads, set in init()
+    ThreadTopology                  m_topology;
+
     //! Flag indicates if internal DC configuration is used
     bool                            m_enableDC = false;
     
     //! Bus Variable used for the BusTime
     BusUInt32<BusInput>             m_busTime;
+
+    //! m_busTime is linked (configure()), until then the input stamps have no bus time
+    std::atomic<bool>               m_busTimeLinked{false};
+
+    //! 64 bit bus time for the input stamps (job task)
+    BusTimeExtender                 m_busTimeExtender;
+
+    //! The stack did not provide the 64 bit bus time, m_busTimeExtender is not seeded
+    bool                            m_busTimeSeedFailed = false;
     
     //! Flag to indicate if bus recovery is in progress...
     bool                            m_busRecoveryActive = false;
+
+    //! State requested by the bus-wide recovery step in progress
+    EC_T_STATE                      m_busRecoveryTarget = eEcatState_UNKNOWN;
+
+    //! Recover dropped slaves only, see enableIncrementalRecovery()
+    bool                            m_incrementalRecovery = HWL_EC_INCREMENTAL_RECOVERY;
+
+    /*! Slave in incremental recovery */
+    struct SlaveRecovery {
+      EC_T_WORD             stationAddress;
+      EC_T_DWORD            slaveId;
+      BusRecoveryTimeline   timeline;
+    };
+
+    /* Recovery, used by the thread calling process() */
+
+    //! Station addresses checked for drop-outs (ENI slaves, registered slaves without ENI)
+    std::vector<EC_T_WORD>          m_recoveryStations;
+    //! Time of the last scan of m_recoveryStations
+    uint64_t                        m_recoveryScanNs = 0;
+    //! Slaves in incremental recovery
+    std::vector<SlaveRecovery>      m_slaveRecovery;
+    //! Timeline of the bus-wide recovery
+    BusRecoveryTimeline             m_busRecovery;
+    //! Finished recoveries, see getRecoveryLog()
+    std::vector<BusRecoveryRecord>  m_recoveryLog;
     
     //! Flag to indicate if DC status logging is activated
     bool                            m_logDCStatus = false;
     
-    //! String for DCM log
-    PLine                           m_logStr;
-    //! logbuffer for DCM log
-    am2b::LogBuf<PLine>             m_logbuf{"masterdcm", 5000};
+    //! Binary DCM log, written by the job task
+    DcmLog                          m_dcmLog{HWL_EC_DCM_LOG_SIZE};
+    //! DCM controller set value in ns
+    int32_t                         m_dcmCtlSetVal = 0;
 
     /* The following members are also used within the jobtask thread.
        Be careful to avoid race conditions! */
@@ -453,6 +913,39 @@ namespace ec {
     //! Signals shutdown of the timing thread
     volatile bool                   m_timingThreadShutdown = false;
 
+    //! Indicates if the notification thread is running
+    volatile bool                   m_notifyThreadRunning = false;
+
+    //! Signals shutdown of the notification thread
+    volatile bool                   m_notifyThreadShutdown = false;
+
+    //! Pointer to the companion thread
+    void*                           m_companionThread = 0;
+
+    //! Wakes up the companion thread
+    void*                           m_companionEvent = 0;
+
+    //! Indicates if the companion thread is running
+    volatile bool                   m_companionThreadRunning = false;
+
+    //! Signals shutdown of the companion thread
+    volatile bool                   m_companionThreadShutdown = false;
+
+    //! Companion thread every n cycles, 0: acyclic jobs in the job task
+    std::atomic<uint32_t>           m_companionDivisor{0};
+
+    //! Set by the job task when waking up the companion, cleared when it is done
+    std::atomic<bool>               m_companionBusy{false};
+
+    //! Wake-ups skipped because the companion thread was still busy
+    std::atomic<uint64_t>           m_companionSkipped{0};
+
+    //! Notifications passed from the callback to the notification thread
+    LockFreeQueue<Notification, HWL_EC_NOTIFY_QUEUE_SIZE>  m_notifyQueue;
+
+    //! Number of notifications dropped because the queue was full
+    std::atomic<uint32_t>           m_notifyLost{0};
+
     //! bus cycle time in microseconds
     EC_T_DWORD                      m_busCycleTimeUs = 0;
 
@@ -468,8 +961,59 @@ namespace ec {
     //! requested bus state
     EC_T_STATE                      m_reqState = eEcatState_UNKNOWN;
     
-    //! Log Rate Limiter overload
-    LogRateLimiter                  m_overloadLogRateLimiter;
+    //! Rate limiter for notifications and job task messages
+    KeyedLogLimiter                 m_logLimiter;
+
+    //! Process variables and slaves read from the ENI file
+    EniVarDirectory                 m_eniDirectory;
+
+    //! Static PDO blocks generated from the ENI
+    std::vector<StaticPdoExchange*> m_staticPdo;
+
+    //! Storage of the linked lock-free variables, inputs and outputs in separate cache lines
+    BusVarArena                     m_arena;
+
+    //! Owner of the published layout
+    std::unique_ptr<PdoLayout>      m_pdoLayoutStorage;
+
+    //! Layout used by the job task, NULL until requestPdoLayout() has built it
+    std::atomic<const PdoLayout*>   m_pdoLayout{NULL};
+
+    //! Set by requestPdoLayout(), the job task pauses before its next cycle
+    std::atomic<bool>               m_jobPauseRequest{false};
+
+    //! Set by the job task once paused
+    void*                           m_jobPausedEvent = 0;
+
+    //! Resumes the paused job task
+    void*                           m_jobResumeEvent = 0;
+
+    //! Called by the job task between inputs and outputs
+    std::vector<CycleCallbackEntry> m_cycleCallbacks;
+
+    /* Slave processing, used by the thread calling process() */
+
+    //! Workers for the process() calls, see enableParallelProcess()
+    WorkerPool                      m_processPool;
+    //! Execution times, index as m_slaves
+    std::vector<SlaveProcessTiming> m_processTiming;
+    //! Indices of the slaves processed serially / on the workers
+    std::vector<size_t>             m_serialSlaves;
+    std::vector<size_t>             m_parallelSlaves;
+    //! Number of slaves split into m_serialSlaves and m_parallelSlaves, 0: to be done
+    size_t                          m_processSlavesSorted = 0;
+    //! process() slot of each slave, see SlaveSchedule.hpp
+    std::vector<uint32_t>           m_processSlot;
+    //! Parallel slaves due in the current call
+    std::vector<size_t>             m_dueSlaves;
+    //! Calls of process() in SAFEOP and OP
+    uint64_t                        m_processCalls = 0;
+
+    //! Statistics page in shared memory, written by the job task
+    BusStatsPublisher               m_stats;
+
+    //! Timeline of the master threads, disabled by default
+    CycleTracer                     m_tracer;
 
     /* Statistics variables */
     unsigned int                    m_numLinkedPDOVars = 0;
@@ -482,16 +1026,4 @@ namespace ec {
 #include "AcEcMaster_impl.hpp"
 }
 
-namespace am2b
-{
-
-  template<>
-  void setup_log_columns<PLine>(LogBuf<PLine> *lb, const PLine *)
-  {
-    
-    lb->add_vector_data(0, CHAR, "blub", XSTDIO_LINE_SZ);
-    //lb->add_vector_data(offsetof(PLine,buf), CHAR, "blub", XSTDIO_LINE_SZ);
-  };
-}
-  
 #endif /* end of include guard: ACECMASTER_HPP_439B4CBC */
@@ -11,30 +11,318 @@
  Implementation to handle AcEcMaster notifications. This is directly included in the AcEcMaster template class
  and defines the notify(...) method called directly by the internal master callback.
  
+ The callback may run in the job task context. notify() therefore only executes the fault reaction,
+ updates the mailbox flags of the linked bus variables and the counters of the statistics page. Everything else (printing, slave property lookup,
+ rate limiting) is done by handleNotification() in the notification thread, which receives a POD copy of
+ the notification via m_notifyQueue.
 */
 
 
+/*! Notification data copied from the stack */
+union NotificationData {
+  EC_T_NOTIFICATION_DESC          desc;         //!< general notifications
+  EC_T_ERROR_NOTIFICATION_DESC    errorDesc;    //!< error notifications
+  EC_T_STATECHANGE                stateChange;  //!< EC_NOTIFY_STATECHANGED
+  EC_T_DWORD                      status;       //!< EC_NOTIFY_DC_STATUS
+
+  //! EC_NOTIFY_MBOXRCV
+  struct {
+    BusVarType*   var;              //!< linked bus variable, NULL if unknown
+    EC_T_DWORD    tferId;
+    EC_T_DWORD    tferType;
+    EC_T_DWORD    tferStatus;
+    EC_T_DWORD    errorCode;
+    EC_T_WORD     stationAddress;   //!< CoE emergency only
+  } mbox;
+};
+
+/*! POD copy of a notification for the notification thread */
+struct Notification {
+  EC_T_DWORD        code;
+  NotificationData  data;
+};
+
+
 /*! notify member function called by the ethercat master after bus state change or bus error */
 void notify(EC_T_DWORD dwCode, EC_T_NOTIFYPARMS* pParms) {
+
+  Notification n;
+  n.code = dwCode;
+
+  // counters of the statistics page, not rate limited
+  countNotification(dwCode, pParms->pbyInBuf);
+
+  /* Fault reaction, always executed within the callback */
+  switch(dwCode) {
+
+    //! Slave presence status changed
+    case EC_NOTIFY_SLAVE_PRESENCE:
+      if (!((EC_T_NOTIFICATION_DESC*) pParms->pbyInBuf)->desc.SlavePresenceDesc.bPresent) {
+        EC_FAULT; // Fault reaction
+      }
+    break;
+
+    //! Not all slaves are in OPERATIONAL state
+    case EC_NOTIFY_NOT_ALL_DEVICES_OPERATIONAL:
+      EC_FAULT;// Fault reaction
+      m_allDevsInOperationalState = false;
+    break;
+
+    //! All slaves back in OPERATIONAL
+    case EC_NOTIFY_ALL_DEVICES_OPERATIONAL:
+      m_allDevsInOperationalState = true;
+    break;
+
+    case EC_NOTIFY_ETH_LINK_NOT_CONNECTED:
+    case EC_NOTIFY_STATUS_SLAVE_ERROR:
+    case EC_NOTIFY_CLIENTREGISTRATION_DROPPED:
+    case EC_NOTIFY_PDIWATCHDOG:
+    case EC_NOTIFY_LINE_CROSSED:
+    case EC_NOTIFY_JUNCTION_RED_CHANGE:
+      EC_FAULT;// Fault reaction
+    break;
+
+    //! Slave is in unexpected state
+    case EC_NOTIFY_SLAVE_UNEXPECTED_STATE:
+      if (this->isValidState(((EC_T_ERROR_NOTIFICATION_DESC*) pParms->pbyInBuf)->desc.SlaveUnexpectedStateDesc.expState)) {
+        EC_FAULT;// Fault reaction
+      }
+    break;
+
+    //! Mailbox transfer completion
+    case EC_NOTIFY_MBOXRCV:
+      if (notifyMailbox((EC_T_MBXTFER*) pParms->pbyInBuf, n)) {
+        return; // nothing to report
+      }
+      queueNotification(n);
+    return;
+  }
+
+  // copy the notification descriptor
+  if (pParms->pbyInBuf != NULL) {
+    size_t size = pParms->dwInBufSize;
+    if (size > sizeof(NotificationData)) {
+      size = sizeof(NotificationData);
+    }
+    memcpy(&n.data, pParms->pbyInBuf, size);
+  }
+
+  queueNotification(n);
+}
+
+
+/*! Update the slave counters of the statistics page (see BusStats.hpp) */
+void countNotification(EC_T_DWORD dwCode, EC_T_BYTE* pbyInBuf) {
+
+  if (pbyInBuf == NULL) {
+    return;
+  }
+
+  EC_T_NOTIFICATION_DESC* pDesc = (EC_T_NOTIFICATION_DESC*) pbyInBuf;
+  EC_T_ERROR_NOTIFICATION_DESC* pErrorDesc = (EC_T_ERROR_NOTIFICATION_DESC*) pbyInBuf;
+
+  switch (dwCode) {
+
+    case EC_NOTIFY_SLAVE_STATECHANGED:
+      m_stats.setState(m_stats.findSlave(pDesc->desc.SlaveStateChangedDesc.SlaveProp.wStationAddress),
+                       (uint16_t) pDesc->desc.SlaveStateChangedDesc.newState);
+    break;
+
+    case EC_NOTIFY_CYCCMD_WKC_ERROR:
+      m_stats.countCycCmdWkcError();
+    break;
+
+    case EC_NOTIFY_SLAVE_INITCMD_WKC_ERROR:
+    case EC_NOTIFY_EOE_MBXSND_WKC_ERROR:
+    case EC_NOTIFY_COE_MBXSND_WKC_ERROR:
+    case EC_NOTIFY_VOE_MBXSND_WKC_ERROR:
+    case EC_NOTIFY_SLAVE_NOT_ADDRESSABLE:
+      m_stats.countWkcError(m_stats.findSlave(pErrorDesc->desc.WkcErrDesc.SlaveProp.wStationAddress));
+    break;
+
+    case EC_NOTIFY_SLAVE_ERROR_STATUS_INFO:
+      m_stats.countError(m_stats.findSlave(pErrorDesc->desc.SlaveErrInfoDesc.SlaveProp.wStationAddress));
+    break;
+  }
+}
+
+
+/*! Update the flags of the bus variable linked to a completed mailbox transfer.
+    Returns true if there is nothing to report. */
+bool notifyMailbox(EC_T_MBXTFER* pmbox, Notification& n) {
+
+  n.data.mbox.var = NULL;
+  n.data.mbox.tferId = pmbox->dwTferId;
+  n.data.mbox.tferType = pmbox->eMbxTferType;
+  n.data.mbox.tferStatus = pmbox->eTferStatus;
+  n.data.mbox.errorCode = pmbox->dwErrorCode;
+  n.data.mbox.stationAddress = 0;
+
+  switch (pmbox->eMbxTferType) {
+    
+    /* Asynchronous SDOs */
+    case eMbxTferType_COE_SDO_DOWNLOAD:
+    case eMbxTferType_COE_SDO_UPLOAD:
+    
+      // Check which registered variable is linked
+      for (std::vector<BusVarType*>::iterator it = m_variablesSDO.begin() ; it != m_variablesSDO.end(); ++it) {
+
+        // check for pointer equality
+        if ((*it)->m_tferObj == pmbox) {
+          
+          n.data.mbox.var = *it;
   
-  /* Cast the pParms data to different representations */
+          // scoped lock
+          std::lock_guard<std::timed_mutex> lock((*it)->getMutex());
+  
+          // update transfer in progress flag
+          (*it)->m_SDOTransferInProgress = false;
+
+          m_stats.sdoCompleted((*it)->m_statsIdx, pmbox->dwErrorCode != EC_E_NOERROR,
+                               (uint32_t) ((busStatsNowNs() - (*it)->m_SDORequestNs) / 1000));
+          m_tracer.asyncEnd(pmbox->eMbxTferType == eMbxTferType_COE_SDO_DOWNLOAD ? "sdo download" : "sdo upload",
+                            pmbox->dwTferId, pmbox->dwErrorCode);
+          
+          if (pmbox->dwErrorCode != EC_E_NOERROR) {
+            (*it)->m_SDOTransferFailed = true;
+          } else if (pmbox->eTferStatus == eMbxTferStatus_TferDone) {
+            // if the transfer was successful, update the corresponding flag
+            (*it)->m_SDOTransferDone = true;
+          }
+          break;  // for
+        }
+      }
+      
+#ifdef HWL_EC_VERBOSE
+      return false;
+#else
+      return n.data.mbox.var != NULL && pmbox->dwErrorCode == EC_E_NOERROR;
+#endif
+
+    //! CoE Emergency object
+    case eMbxTferType_COE_EMERGENCY:
+    
+      EC_FAULT; // Fault reaction
+      n.data.mbox.stationAddress = pmbox->MbxData.CoE_Emergency.wStationAddress;
+      
+      if (pmbox->eTferStatus != eMbxTferStatus_TferDone) {
+        return false;
+      }
+      
+      // check if a slave registered for this object
+      for (std::vector<BusVarType*>::iterator it = m_variablesSDO.begin() ; it != m_variablesSDO.end(); ++it) {
+        
+        if ((*it)->m_offset == BUSVAR_COE_EMERGENCY && (*it)->m_objId == pmbox->MbxData.CoE_Emergency.wStationAddress) {
+          // This is the corresponding bus var
+          
+          // scoped lock
+          std::lock_guard<std::timed_mutex> lock((*it)->getMutex());
+          
+          (*it)->m_SDOTransferDone = true;
+          
+          // copy data
+          memcpy((char*)(*it)->getPointer(), (void*) &pmbox->MbxData.CoE_Emergency.wErrorCode, sizeof(EC_T_WORD));
+          memcpy((char*)(*it)->getPointer()+sizeof(EC_T_WORD), (void*) &pmbox->MbxData.CoE_Emergency.byErrorRegister, sizeof(EC_T_BYTE));
+          memcpy((char*)(*it)->getPointer()+sizeof(EC_T_WORD)+sizeof(EC_T_BYTE), (void*) pmbox->MbxData.CoE_Emergency.abyData, 5*sizeof(EC_T_BYTE));
+          return true;
+        }
+      }
+      return false;
+
+    default:
+#ifdef HWL_EC_VERBOSE
+      return false;
+#else
+      return true;
+#endif
+  }
+}
+
+
+/*! Pass a notification to the notification thread. Handled directly if the thread is not running */
+void queueNotification(const Notification& n) {
+
+  if (!m_notifyThreadRunning) {
+    handleNotification(n);
+    return;
+  }
+
+  if (!m_notifyQueue.push(n)) {
+    m_notifyLost.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  OsSetEvent(m_notifyEvent);
+}
+
+
+/*! Notification thread */
+void runNotifyTask() {
+
+  Notification n;
+  uint32_t reportedLost = 0;
+
+  setupThread(m_topology.notify, "notification thread");
+
+  m_notifyThreadRunning = true;
+
+  while (!m_notifyThreadShutdown) {
+
+    OsWaitForEvent(m_notifyEvent, HWL_EC_NOTIFY_WAIT_MS);
+
+    while (m_notifyQueue.pop(n)) {
+      handleNotification(n);
+    }
+
+    logSuppressedSummary();
+
+    uint32_t lost = m_notifyLost.load(std::memory_order_relaxed);
+    if (lost != reportedLost) {
+      pwrnMaster("%u notifications lost (queue full)\n", lost - reportedLost);
+      reportedLost = lost;
+    }
+  }
+
+  m_notifyThreadRunning = false;
+
+  // remaining notifications
+  while (m_notifyQueue.pop(n)) {
+    handleNotification(n);
+  }
+}
+
+
+/*! Print the periodic summary of rate limited messages */
+void logSuppressedSummary() {
+
+  m_logLimiter.summarize([](const char* name, uint32_t code, uint32_t slave, uint32_t count, double periodSec) {
+    if (slave == KEYED_LOG_NO_SLAVE) {
+      pwrnMaster("Suppressed %u occurrences of %s (0x%x) in last %.1f s\n", count, name, code, periodSec);
+    } else {
+      pwrnMaster("Suppressed %u occurrences of %s (0x%x) on slave %u in last %.1f s\n", count, name, code, slave, periodSec);
+    }
+  });
+}
+
+
+/*! Print and bookkeeping for a notification. Called from the notification thread */
+void handleNotification(const Notification& n) {
+  
+  /* Cast the notification data to different representations */
   
   //! General notification struct
-  EC_T_NOTIFICATION_DESC*         pDesc             = (EC_T_NOTIFICATION_DESC*) pParms->pbyInBuf;
+  const EC_T_NOTIFICATION_DESC*         pDesc             = &n.data.desc;
  
   //! Error notification struct
-  EC_T_ERROR_NOTIFICATION_DESC*   pErrorDesc        = (EC_T_ERROR_NOTIFICATION_DESC*) pParms->pbyInBuf;
-  
-  //! Mailbox transfer notification struct
-  EC_T_MBXTFER* pMboxTransfer = (EC_T_MBXTFER*) pParms->pbyInBuf;
+  const EC_T_ERROR_NOTIFICATION_DESC*   pErrorDesc        = &n.data.errorDesc;
   
   
-  switch(dwCode) {
+  switch(n.code) {
 
     //! Master state change
     case EC_NOTIFY_STATECHANGED:
     {
-      EC_T_STATECHANGE* pStateChangeParms = (EC_T_STATECHANGE*) pParms->pbyInBuf;
+      const EC_T_STATECHANGE* pStateChangeParms = &n.data.stateChange;
       pmsgMaster("Bus state change from %s to %s\n", ecatStateToStr(pStateChangeParms->oldState), ecatStateToStr(pStateChangeParms->newState));
     }
     break;
@@ -59,7 +347,7 @@ void notify(EC_T_DWORD dwCode, EC_T_NOTIFYPARMS* pParms) {
     case EC_NOTIFY_DC_STATUS:
     {
       /* Initialization of DC Instance finished when this notification is called */
-      EC_T_DWORD dwStatus  = EC_GETDWORD((pParms->pbyInBuf));
+      EC_T_DWORD dwStatus  = n.data.status;
 
       if (EC_E_NOERROR != dwStatus)
       {
@@ -125,7 +413,6 @@ void notify(EC_T_DWORD dwCode, EC_T_NOTIFYPARMS* pParms) {
         pmsgMaster("Slave with address %d added to the bus!\n", pDesc->desc.SlavePresenceDesc.wStationAddress);
         
       } else {
-        EC_FAULT; // Fault reaction
         perrMaster("Slave with address %d removed from the bus!\n", pDesc->desc.SlavePresenceDesc.wStationAddress);
       }
     
@@ -137,127 +424,70 @@ void notify(EC_T_DWORD dwCode, EC_T_NOTIFYPARMS* pParms) {
       perrMaster("EC_NOTIFY_SLAVES_PRESENCE. Not implemented\n");
     break;
 
-    //! Mailbox transfer completion
+    //! Mailbox transfer completion, flags already updated in notify()
     case EC_NOTIFY_MBOXRCV:
     {
-        
-      EC_T_MBXTFER* pmbox = (EC_T_MBXTFER*) pParms->pbyInBuf;
 
-      switch (pmbox->eMbxTferType) {
+      switch (n.data.mbox.tferType) {
         
         /* Asynchronous SDOs */
         case eMbxTferType_COE_SDO_DOWNLOAD:
         case eMbxTferType_COE_SDO_UPLOAD:
         {
-          
-          bool bFoundTferObj = false;
-          
-          // Check which registered variable is linked
-          for (std::vector<BusVarType*>::iterator it = m_variablesSDO.begin() ; it != m_variablesSDO.end(); ++it) {
-    
-            // check for pointer equality
-            if ((*it)->m_tferObj == pmbox) {
-              
-              bFoundTferObj = true;
-      
-              // scoped lock
-              std::lock_guard<std::timed_mutex> lock((*it)->getMutex());
-      
-              // update transfer in progress flag
-              (*it)->m_SDOTransferInProgress = false;
-              
-              
-              // Error during transfer?
-              if ( (*it)->m_tferObj->dwErrorCode != EC_E_NOERROR) {
-                
-                (*it)->m_SDOTransferFailed = true;
-                
-                EC_T_SLAVE_PROP slaveProp;
-                ecatGetSlaveProp((*it)->m_slaveId, &slaveProp);
-                
-                if ((*it)->m_tferObj->eMbxTferType == eMbxTferType_COE_SDO_DOWNLOAD) {
-                  perrMaster("Error during asynchronous SDO Download (%d) to %s, objIndex=0x%x, subIdx=0x%x: %s\n", pmbox->dwTferId, slaveProp.achName, (*it)->m_objId, (*it)->m_subIdx, ecatGetText((*it)->m_tferObj->dwErrorCode));
-                } else if ((*it)->m_tferObj->eMbxTferType == eMbxTferType_COE_SDO_UPLOAD) {
-                  perrMaster("Error during asynchronous SDO Upload (%d) from %s, objIndex=0x%x, subIdx=0x%x: %s\n", pmbox->dwTferId, slaveProp.achName, (*it)->m_objId, (*it)->m_subIdx, ecatGetText((*it)->m_tferObj->dwErrorCode));
-                } else {
-                  pwrnMaster("Error during asynchronous SDO transfer (%d) from/to %s with type=%d, objIndex=0x%x, subIdx=0x%x: %s\n", pmbox->dwTferId, slaveProp.achName, (*it)->m_tferObj->eMbxTferType, (*it)->m_objId, (*it)->m_subIdx, ecatGetText((*it)->m_tferObj->dwErrorCode));
-                }
-                
-              } else if ((*it)->m_tferObj->eTferStatus == eMbxTferStatus_TferDone) {
-                
-                // if the transfer was successful, update the corresponding flag
-                (*it)->m_SDOTransferDone = true;
+          BusVarType* var = n.data.mbox.var;
 
-#ifdef HWL_EC_VERBOSE
-                EC_T_SLAVE_PROP slaveProp;
-                ecatGetSlaveProp((*it)->m_slaveId, &slaveProp);
-              
-                if ((*it)->m_tferObj->eMbxTferType == eMbxTferType_COE_SDO_DOWNLOAD) {
-                  pdbgMaster("Completed asynchronous SDO Download (%d) to %s, objIndex=0x%x, subIdx=0x%x\n", pmbox->dwTferId, slaveProp.achName, (*it)->m_objId, (*it)->m_subIdx);
-                } else if ((*it)->m_tferObj->eMbxTferType == eMbxTferType_COE_SDO_UPLOAD) {
-                  pdbgMaster("Completed asynchronous SDO Upload (%d) from %s, objIndex=0x%x, subIdx=0x%x\n", pmbox->dwTferId, slaveProp.achName, (*it)->m_objId, (*it)->m_subIdx);
-                } else {
-                  pdbgMaster("Completed asynchronous SDO transfer (%d) from/to %s, type=%d, objIndex=0x%x, subIdx=0x%x\n", pmbox->dwTferId, slaveProp.achName, (*it)->m_tferObj->eMbxTferType, (*it)->m_objId, (*it)->m_subIdx);
-                }
-#endif
-                
-              }
+          // check if the mailbox object was found in the linked sdo objects
+          if (var == NULL) {
+            //FIXME: Do synchronous SDOs trigger this output? If not -> omit detection or output an error
+            pdbgMaster("Mailbox transfer completion for unknown SDO transfer object (%d).\n", n.data.mbox.tferId);
+            break;
+          }
 
-              break;  // for
-      
+          // Error during transfer?
+          if (n.data.mbox.errorCode != EC_E_NOERROR) {
+            
+            EC_T_SLAVE_PROP slaveProp;
+            emGetSlaveProp(m_instanceId, var->m_slaveId, &slaveProp);
+            
+            if (n.data.mbox.tferType == eMbxTferType_COE_SDO_DOWNLOAD) {
+              perrMaster("Error during asynchronous SDO Download (%d) to %s, objIndex=0x%x, subIdx=0x%x: %s\n", n.data.mbox.tferId, slaveProp.achName, var->m_objId, var->m_subIdx, ecatGetText(n.data.mbox.errorCode));
+            } else {
+              perrMaster("Error during asynchronous SDO Upload (%d) from %s, objIndex=0x%x, subIdx=0x%x: %s\n", n.data.mbox.tferId, slaveProp.achName, var->m_objId, var->m_subIdx, ecatGetText(n.data.mbox.errorCode));
             }
+            
           }
+#ifdef HWL_EC_VERBOSE
+          else if (n.data.mbox.tferStatus == eMbxTferStatus_TferDone) {
+            
+            EC_T_SLAVE_PROP slaveProp;
+            emGetSlaveProp(m_instanceId, var->m_slaveId, &slaveProp);
           
-          // check if the mailbox object was found in the linked sdo objects
-          if (!bFoundTferObj) {
-            //FIXME: Do synchronous SDOs trigger this output? If not -> omit detection or output an error
-            pdbgMaster("Mailbox transfer completion for unknown SDO transfer object (%d).\n", pmbox->dwTferId);
+            if (n.data.mbox.tferType == eMbxTferType_COE_SDO_DOWNLOAD) {
+              pdbgMaster("Completed asynchronous SDO Download (%d) to %s, objIndex=0x%x, subIdx=0x%x\n", n.data.mbox.tferId, slaveProp.achName, var->m_objId, var->m_subIdx);
+            } else {
+              pdbgMaster("Completed asynchronous SDO Upload (%d) from %s, objIndex=0x%x, subIdx=0x%x\n", n.data.mbox.tferId, slaveProp.achName, var->m_objId, var->m_subIdx);
+            }
           }
-          
-          
+#endif
         }
         break;  // case
     
         //! CoE Emergency object
         case eMbxTferType_COE_EMERGENCY:
-        {
-          EC_FAULT; // Fault reaction
-          
-          if (pmbox->eTferStatus != eMbxTferStatus_TferDone) {
+        
+          if (n.data.mbox.tferStatus != eMbxTferStatus_TferDone) {
             perrMaster("Error during transmission of CoE Emergency Object!\n");
-            break;
+          } else if (n.data.mbox.var == NULL) {
+            perrMaster("Received unknown CoE Emergency Object for station addr %d!\n", n.data.mbox.stationAddress);
           }
-          
-          // check if a slave registered for this object
-          for (std::vector<BusVarType*>::iterator it = m_variablesSDO.begin() ; it != m_variablesSDO.end(); ++it) {
-            
-            if ((*it)->m_offset == BUSVAR_COE_EMERGENCY && (*it)->m_objId == pmbox->MbxData.CoE_Emergency.wStationAddress) {
-              // This is the corresponding bus var
-              
-              // scoped lock
-              std::lock_guard<std::timed_mutex> lock((*it)->getMutex());
-              
-              (*it)->m_SDOTransferDone = true;
-              
-              // copy data
-              memcpy((char*)(*it)->getPointer(), (void*) &pmbox->MbxData.CoE_Emergency.wErrorCode, sizeof(EC_T_WORD));
-              memcpy((char*)(*it)->getPointer()+sizeof(EC_T_WORD), (void*) &pmbox->MbxData.CoE_Emergency.byErrorRegister, sizeof(EC_T_BYTE));
-              memcpy((char*)(*it)->getPointer()+sizeof(EC_T_WORD)+sizeof(EC_T_BYTE), (void*) pmbox->MbxData.CoE_Emergency.abyData, 5*sizeof(EC_T_BYTE));
-              return;
-            }
-            
-          }
-          
-          perrMaster("Received unknown CoE Emergency Object for station addr %d!\n", 
-                     pmbox->MbxData.CoE_Emergency.wStationAddress);
-        }
+        
         break;
         
 #ifdef HWL_EC_VERBOSE
         //! Other MBOX object
         default:
 
-          pdbgMaster("Mailbox Transfer Completion (MBOXRCV), status = %d, tferId=%d, type=%d\n", pMboxTransfer->eTferStatus, pMboxTransfer->dwTferId, pMboxTransfer->eMbxTferType);
+          pdbgMaster("Mailbox Transfer Completion (MBOXRCV), status = %d, tferId=%d, type=%d\n", n.data.mbox.tferStatus, n.data.mbox.tferId, n.data.mbox.tferType);
 #endif
       }
 
@@ -283,13 +513,7 @@ void notify(EC_T_DWORD dwCode, EC_T_NOTIFYPARMS* pParms) {
     //! Cyclic command working counter mismatch
     case EC_NOTIFY_CYCCMD_WKC_ERROR:
     {
-      static LogRateLimiter wkclimiter(HWL_EC_MAX_MSG_PER_ERROR, HWL_EC_REDUCED_MSG_RATE);
-      wkclimiter.count();
-      
-      if (wkclimiter.onLimit()) {
-        pwrnMaster("Reached maximum number of messages for CYCCMD_WKC_ERROR. Reducing report rate...\n");
-      }
-      if (!wkclimiter.log()) {
+      if (!m_logLimiter.allow(n.code, pErrorDesc->desc.WkcErrDesc.dwAddr, "CYCCMD_WKC_ERROR")) {
         break;
       }
       
@@ -368,15 +592,8 @@ void notify(EC_T_DWORD dwCode, EC_T_NOTIFYPARMS* pParms) {
     //! Frame response error / unexpected frame received
     case EC_NOTIFY_FRAME_RESPONSE_ERROR:
     {
-      static LogRateLimiter noframelimiter(HWL_EC_MAX_MSG_PER_ERROR, HWL_EC_REDUCED_MSG_RATE);
-      noframelimiter.count();
-      
-      if (noframelimiter.onLimit()) {
-        pwrnMaster("Reached maximum number of messages for FRAME_RESPONSE_ERROR. Reducing report rate...\n");
-        //EC_FAULT;// Fault reaction
-        //Frame response also handled in JobTask
-      }
-      if (!noframelimiter.log()) {  
+      //Frame response also handled in JobTask
+      if (!m_logLimiter.allow(n.code, KEYED_LOG_NO_SLAVE, "FRAME_RESPONSE_ERROR")) {
         break;
       }
       
@@ -474,23 +691,7 @@ void notify(EC_T_DWORD dwCode, EC_T_NOTIFYPARMS* pParms) {
     //! Not all slaves are in OPERATIONAL state
     case EC_NOTIFY_NOT_ALL_DEVICES_OPERATIONAL:
     {
-      EC_FAULT;// Fault reaction
-
-      static LogRateLimiter oplimiter(HWL_EC_MAX_MSG_PER_ERROR, HWL_EC_REDUCED_MSG_RATE);
-      
-      if (m_allDevsInOperationalState) {
-        // if this is the first time this error occurs,
-        // reset the counter
-        oplimiter.reset();
-      }
-      
-      oplimiter.count();
-      m_allDevsInOperationalState = false;
-      
-      if (oplimiter.onLimit()) {
-        pwrnMaster("Reached maximum number of messages for NOT_ALL_DEVICES_OPERATIONAL. Reducing report rate...\n");
-      }
-      if (!oplimiter.log()) {
+      if (!m_logLimiter.allow(n.code, KEYED_LOG_NO_SLAVE, "NOT_ALL_DEVICES_OPERATIONAL")) {
         break;
       }
       
@@ -502,15 +703,7 @@ void notify(EC_T_DWORD dwCode, EC_T_NOTIFYPARMS* pParms) {
     //! Ethernet cable disconnected
     case EC_NOTIFY_ETH_LINK_NOT_CONNECTED:
     {
-      EC_FAULT;// Fault reaction
-      
-      static LogRateLimiter ethlimiter(HWL_EC_MAX_MSG_PER_ERROR, HWL_EC_REDUCED_MSG_RATE);
-      ethlimiter.count();
-      
-      if (ethlimiter.onLimit()) {
-        pwrnMaster("Reached maximum number of messages for ETH_LINK_NOT_CONNECTED. Reducing report rate...\n");
-      }
-      if (!ethlimiter.log()) {
+      if (!m_logLimiter.allow(n.code, KEYED_LOG_NO_SLAVE, "ETH_LINK_NOT_CONNECTED")) {
         break;
       }
       
@@ -523,15 +716,7 @@ void notify(EC_T_DWORD dwCode, EC_T_NOTIFYPARMS* pParms) {
     case EC_NOTIFY_STATUS_SLAVE_ERROR:
     {
       // will be executed before each EC_NOTIFY_SLAVE_ERROR_STATUS_INFO, but without detailed information on the error status
-      EC_FAULT;// Fault reaction
-      
-      static LogRateLimiter slavelimiter(HWL_EC_MAX_MSG_PER_ERROR, 5);
-      slavelimiter.count();
-      
-      if (slavelimiter.onLimit()) {
-        pwrnMaster("Reached maximum number of messages for STATUS_SLAVE_ERROR. Reducing report rate...\n");
-      }
-      if(!slavelimiter.log()) {
+      if (!m_logLimiter.allow(n.code, KEYED_LOG_NO_SLAVE, "STATUS_SLAVE_ERROR")) {
         break;
       }
       
@@ -541,6 +726,9 @@ void notify(EC_T_DWORD dwCode, EC_T_NOTIFYPARMS* pParms) {
     
   
     case EC_NOTIFY_SLAVE_ERROR_STATUS_INFO:
+      if (!m_logLimiter.allow(n.code, pErrorDesc->desc.SlaveErrInfoDesc.SlaveProp.wStationAddress, "SLAVE_ERROR_STATUS_INFO")) {
+        break;
+      }
       pwrnMaster("%s (%d) reported an error with status %d, status code %d\n",
                   pErrorDesc->desc.SlaveErrInfoDesc.SlaveProp.achName,
                   pErrorDesc->desc.SlaveErrInfoDesc.SlaveProp.wStationAddress,
@@ -550,6 +738,9 @@ void notify(EC_T_DWORD dwCode, EC_T_NOTIFYPARMS* pParms) {
 
 
     case EC_NOTIFY_SLAVE_NOT_ADDRESSABLE:
+      if (!m_logLimiter.allow(n.code, pErrorDesc->desc.WkcErrDesc.SlaveProp.wStationAddress, "SLAVE_NOT_ADDRESSABLE")) {
+        break;
+      }
       pwrnMaster("%s (%d) not addressable.\n", pErrorDesc->desc.WkcErrDesc.SlaveProp.achName, pErrorDesc->desc.WkcErrDesc.SlaveProp.wStationAddress);
     break;
     
@@ -588,7 +779,6 @@ void notify(EC_T_DWORD dwCode, EC_T_NOTIFYPARMS* pParms) {
       
     //! API-client registration dropped
     case EC_NOTIFY_CLIENTREGISTRATION_DROPPED:
-      EC_FAULT;
       /* client registration was dropped because ecatConfigureMaster was called by another thread
          this should never happen with our software design. */
       perrMaster("Internal Error. Client registration dropped!\n");
@@ -608,7 +798,6 @@ void notify(EC_T_DWORD dwCode, EC_T_NOTIFYPARMS* pParms) {
     
     //! PDI watchdog error
     case EC_NOTIFY_PDIWATCHDOG:
-      EC_FAULT;// Fault reaction
       perrMaster("PDI watchdog error on %s (%d)\n",
                   pErrorDesc->desc.PdiWatchdogDesc.SlaveProp.achName,
                   pErrorDesc->desc.PdiWatchdogDesc.SlaveProp.wStationAddress);
@@ -621,9 +810,6 @@ void notify(EC_T_DWORD dwCode, EC_T_NOTIFYPARMS* pParms) {
     
     //! Slave is in unexpected state
     case EC_NOTIFY_SLAVE_UNEXPECTED_STATE:
-      if (this->isValidState(pErrorDesc->desc.SlaveUnexpectedStateDesc.expState)) {
-        EC_FAULT;// Fault reaction
-      }
       perrMaster("%s (%d) in unexpected state, cur=%s, exp=%s\n",
                   pErrorDesc->desc.SlaveUnexpectedStateDesc.SlaveProp.achName,
                   pErrorDesc->desc.SlaveUnexpectedStateDesc.SlaveProp.wStationAddress,
@@ -634,7 +820,6 @@ void notify(EC_T_DWORD dwCode, EC_T_NOTIFYPARMS* pParms) {
     //! All slaves back in OPERATIONAL
     case EC_NOTIFY_ALL_DEVICES_OPERATIONAL:
       pmsgMaster("All slaves (back) in OPERATIONAL state.\n");
-      m_allDevsInOperationalState = true;
     break;
 
     //! EEPROM checksum error
@@ -646,7 +831,6 @@ void notify(EC_T_DWORD dwCode, EC_T_NOTIFYPARMS* pParms) {
       
     //! Cable swapping detected
     case EC_NOTIFY_LINE_CROSSED:
-      EC_FAULT; // fatal error
       perrMaster("Ethernet line crossed on %s (%d)! Port 0 must lead to the master!\n",
                   pDesc->desc.CrossedLineDesc.SlaveProp.achName,
                   pDesc->desc.CrossedLineDesc.SlaveProp.wStationAddress);
@@ -655,7 +839,6 @@ void notify(EC_T_DWORD dwCode, EC_T_NOTIFYPARMS* pParms) {
     
     //! Cabling error or junction redundancy
     case EC_NOTIFY_JUNCTION_RED_CHANGE:
-      EC_FAULT; // fatal error
       perrMaster("Cabling error or junction redundancy at %s (%d), line break=%d\n",
                   pErrorDesc->desc.JunctionRedChangeDesc.SlaveProp.achName,
                   pErrorDesc->desc.JunctionRedChangeDesc.SlaveProp.wStationAddress,
@@ -692,7 +875,7 @@ void notify(EC_T_DWORD dwCode, EC_T_NOTIFYPARMS* pParms) {
 
     default:
       EC_FAULT;// Fault reaction
-      perrMaster("Call to notify with unknown code %d\n", dwCode);
+      perrMaster("Call to notify with unknown code %d\n", n.code);
     
   }
 
@@ -11,23 +11,64 @@
 // =============
 // = init =
 // =============
-template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > void AcEcMaster<SlaveInstanceMapperPolicy, EcLinkLayerPolicy>::init(unsigned int busCycleTimeUs, bool enableDC, 
-                                                                                                                                        bool enableOnlineDiagnosis, bool logDCStatus) {
+template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > void AcEcMaster<SlaveInstanceMapperPolicy, EcLinkLayerPolicy>::init(unsigned int busCycleTimeUs, const ThreadTopology& topology,
+                                                                                                                                        bool enableDC, bool enableOnlineDiagnosis, bool logDCStatus) {
 
   if (m_initialized) {
     perrMaster("init() on EtherCAT stack already called!\n");
     return;
   }
+
+  // scheduling of the master threads
+  if (topology.validate()) {
+    perrMaster("Invalid thread topology!\n");
+    throw BusException("Invalid thread topology!");
+  }
+  m_topology = topology;
+  m_topology.report();
   
+  // the timer tick is shared by all instances of the process
+  unsigned int tickUs = AcEcInstanceRegistry::shareClockPeriod(busCycleTimeUs);
+  if (busCycleTimeUs % tickUs != 0) {
+    perrMaster("Cycle time %u us of instance %u is not a multiple of the timer tick %u us set by the first instance!\n",
+               busCycleTimeUs, m_instanceId, tickUs);
+    throw BusException("Cycle time incompatible with the other master instances!");
+  }
+  m_ticksPerCycle = busCycleTimeUs / tickUs;
+  pmsgMaster("Instance %u, cycle time %u us (%u timer ticks)\n", m_instanceId, busCycleTimeUs, m_ticksPerCycle);
+
   m_logDCStatus = logDCStatus;
-  if(m_logDCStatus)
-    m_logbuf.start_log();
+  if (m_logDCStatus && m_dcmLog.start(instanceName(HWL_EC_DCM_LOG_FILE).c_str(), busCycleTimeUs)) {
+    perrMaster("Cannot start DCM status log, logging disabled\n");
+    m_logDCStatus = false;
+  }
+
+#ifdef XSTDIO_DEFERRED
+  // messages from the timing and job task are written by a low-priority thread,
+  // stopped by the last instance in shutdown()
+  if (xlog_start(PRIO_LOG())) {
+    perrMaster("Cannot start deferred logging, messages are written directly\n");
+  } else if (!m_loggingAttached) {
+    AcEcInstanceRegistry::attachLogging();
+    m_loggingAttached = true;
+  }
+#endif
+
+  // job task trace events (trace_evt) if AM2B_DO_TRACE is set, see xtrace.h
+  if (trace_init() != 0) {
+    pwrnMaster("Cannot initialize tracing, trace events disabled\n");
+  }
 
   // Expands to an error message in case the fault reaction is disabled...
   EC_FAULT_WARN;
 
   // set bus cycle time
   m_busCycleTimeUs = busCycleTimeUs;
+
+  // statistics for monitoring tools (ec_stats)
+  if (m_stats.open(instanceName(HWL_EC_STATS_SHM_NAME).c_str(), busCycleTimeUs)) {
+    pwrnMaster("Cannot create statistics page %s\n", instanceName(HWL_EC_STATS_SHM_NAME).c_str());
+  }
   m_enableDC = enableDC;
 
   /* Init Remote API Server? */
@@ -37,7 +78,7 @@ template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > void AcEcMas
     OsMemset(&RasConfig, 0, sizeof(ATEMRAS_T_SRVPARMS));
 
     RasConfig.oAddr.dwAddr    = 0;    /* INADDR_ANY */
-    RasConfig.wPort           = 6000; // default port
+    RasConfig.wPort           = (EC_T_WORD) (6000 + m_instanceId); // default port, one per instance
     RasConfig.dwCycleTime     = HWL_EC_RAS_REMOTE_CYCLE_TIME;
     RasConfig.dwWDTOLimit     = 10 / HWL_EC_RAS_REMOTE_CYCLE_TIME;  // WD Timeout after 10 secs
     RasConfig.dwReConTOLimit  = 6000; // reconnect timeout after 6000 cycles + 10 secs
@@ -60,19 +101,10 @@ template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > void AcEcMas
   }
   
 
-#if HWL_EC_MAIN_THREAD_CPU != -1
   // Set thread affinity if enabled
   // This assures the QNX high resolution timer (CPU stamp)
   // doesn't jump because of cpu hopping. Furthermore, execution should be better-timed.
-  EC_T_CPUSET cpuSet;
-  EC_T_BOOL boolRes;
-  EC_CPUSET_ZERO(cpuSet);
-  EC_CPUSET_SET(cpuSet, HWL_EC_MAIN_THREAD_CPU);
-  boolRes = OsSetThreadAffinity(EC_NULL, cpuSet);
-  if (!boolRes) {
-    perrMaster("Error setting thread affinity in main thread, invalid CPU index!\n");
-  }
-#endif
+  setupThread(m_topology.main, "main thread");
 
   /* configuration of the master */
   EC_T_INIT_MASTER_PARMS masterConfig;
@@ -95,7 +127,7 @@ template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > void AcEcMas
   masterConfig.pfLogMsgCallBack           = hwlLogMsg;
 
   // Init Master
-  m_lastRes = ecatInitMaster(&masterConfig);
+  m_lastRes = emInitMaster(m_instanceId, &masterConfig);
   if (m_lastRes != EC_E_NOERROR) {
     LOG_EC_ERROR("Cannot initialize EtherCAT Master!", m_lastRes);
     throw BusException("Error initializing EtherCAT Master!");
@@ -115,8 +147,8 @@ template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > void AcEcMas
   // Create timing task thread
   m_timingThread = OsCreateThread((EC_T_CHAR*) "tEcTimingTask", 
                                       AcEcTimingTaskWrapper<SlaveInstanceMapperPolicy, EcLinkLayerPolicy>, 
-                                      HWL_EC_TIMING_THREAD_PRIO,
-                                      HWL_EC_JOB_THREAD_STACKSIZE, (void*) this);
+                                      m_topology.timing.priority,
+                                      m_topology.timing.stackSize, (void*) this);
 
   pmsgMaster("Started timing task thread\n");
 
@@ -153,15 +185,25 @@ template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > void AcEcMas
     return;
   }
 
+  // pause handshake for building the PDO layout
+  m_jobPausedEvent = OsCreateEvent();
+  m_jobResumeEvent = OsCreateEvent();
+  if (m_jobPausedEvent == NULL || m_jobResumeEvent == NULL) {
+    perrMaster("Could not create job task pause events!\n");
+    this->shutdown();
+    throw BusException("Error creating job task pause events!");
+    return;
+  }
+
   // create the jobtask thread
   m_jobThread = OsCreateThread((EC_T_CHAR*) "tEcJobTask", 
                                       AcEcJobTaskWrapper<SlaveInstanceMapperPolicy, EcLinkLayerPolicy>, 
   #if !(defined EC_VERSION_GO32)
-                                      HWL_EC_JOB_THREAD_PRIO,
+                                      m_topology.job.priority,
   #else
                                       masterConfig.dwBusCycleTimeUsec,
   #endif
-                                      HWL_EC_JOB_THREAD_STACKSIZE, (void*) this);
+                                      m_topology.job.stackSize, (void*) this);
 
   pmsgMaster("Started job task thread\n");
 
@@ -179,6 +221,66 @@ template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > void AcEcMas
   m_Timer.Stop();
   pmsgMaster("Job task thread running\n");
 
+  // companion thread for the master timer and the acyclic frames
+  if (m_topology.companionDivisor > 0) {
+
+    m_companionEvent = OsCreateEvent();
+    if (m_companionEvent == NULL) {
+      perrMaster("Could not create companion event!\n");
+      this->shutdown();
+      throw BusException("Error creating companion event for thread synchronization!");
+      return;
+    }
+
+    m_companionThreadShutdown = false;
+    m_companionThread = OsCreateThread((EC_T_CHAR*) "tEcCompanionTask",
+                                        AcEcCompanionTaskWrapper<SlaveInstanceMapperPolicy, EcLinkLayerPolicy>,
+                                        m_topology.companion.priority,
+                                        m_topology.companion.stackSize, (void*) this);
+
+    // wait for the thread to be started
+    m_Timer.Start(2000);  // 2s timeout
+    while(!m_Timer.IsElapsed() && !m_companionThreadRunning) {
+      OsSleep(10);
+    }
+    m_Timer.Stop();
+
+    if (!m_companionThreadRunning) {
+      // the acyclic jobs stay in the job task
+      pwrnMaster("Could not start companion thread!\n");
+    } else {
+      m_companionDivisor.store(m_topology.companionDivisor, std::memory_order_release);
+      pmsgMaster("Companion thread running, every %u cycles\n", m_topology.companionDivisor);
+    }
+  }
+
+  // create notification event
+  m_notifyEvent = OsCreateEvent();
+  if (m_notifyEvent == NULL) {
+    perrMaster("Could not create notification event!\n");
+    this->shutdown();
+    throw BusException("Error creating notification event for thread synchronization!");
+    return;
+  }
+
+  // create the notification thread
+  m_notifyThreadShutdown = false;
+  m_notifyThread = OsCreateThread((EC_T_CHAR*) "tEcNotifyTask", 
+                                      AcEcNotifyTaskWrapper<SlaveInstanceMapperPolicy, EcLinkLayerPolicy>, 
+                                      m_topology.notify.priority,
+                                      m_topology.notify.stackSize, (void*) this);
+
+  // wait for the thread to be started                            
+  m_Timer.Start(2000);  // 2s timeout
+  while(!m_Timer.IsElapsed() && !m_notifyThreadRunning) {
+    OsSleep(10);
+  }
+  if (!m_notifyThreadRunning) {
+    // notifications are handled within the callback instead
+    pwrnMaster("Could not start notification thread!\n");
+  }
+  m_Timer.Stop();
+
   m_initialized = true;
 
 }
@@ -192,7 +294,10 @@ template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > void AcEcMas
   pmsgMaster("Terminating...\n");
 
   //stop loggin
-  m_logbuf.stop_log();
+  m_dcmLog.stop();
+
+  // stop the process() workers
+  m_processPool.stop();
 
   // switch to init
   switchStateSync(eEcatState_INIT);
@@ -204,7 +309,7 @@ template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > void AcEcMas
     
 
     // unregister
-    m_lastRes = ecatUnregisterClient(m_client.dwClntId);
+    m_lastRes = emUnregisterClient(m_instanceId, m_client.dwClntId);
     if (m_lastRes != EC_E_NOERROR) {
       LOG_EC_ERROR("Cannot unregister EtherCAT Master", m_lastRes);
     }
@@ -216,9 +321,35 @@ template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > void AcEcMas
   // do not execute if the ECMaster has already been
   // deinitialized
   if (!m_initialized) {
+    stopLogging();
     return;
   }
   
+  // stop notification thread, remaining notifications are handled within the callback
+  m_notifyThreadShutdown = true;
+  if (m_notifyEvent != NULL) {
+    OsSetEvent(m_notifyEvent);
+  }
+
+  m_Timer.Start(2000);
+  while(!m_Timer.IsElapsed() && m_notifyThreadRunning) {
+    OsSleep(10);
+  }
+  if (m_notifyThread != NULL) {
+  
+    OsDeleteThreadHandle(m_notifyThread);
+    m_notifyThread = 0;
+  }
+  if (m_notifyEvent != NULL) {
+    OsDeleteEvent(m_notifyEvent);
+    m_notifyEvent = 0;
+  }
+
+  pmsgMaster("Stopped notification thread\n");
+
+  // the job task takes over the acyclic jobs until it is stopped
+  m_companionDivisor.store(0, std::memory_order_release);
+
   m_timingThreadShutdown = true;
   
   // wait for thread to stop
@@ -255,9 +386,50 @@ template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > void AcEcMas
   m_newRXDataEvent = 0;
   OsDeleteEvent(m_newTXDataEvent);
   m_newTXDataEvent = 0;
+  if (m_jobPausedEvent != NULL) {
+    OsDeleteEvent(m_jobPausedEvent);
+    m_jobPausedEvent = 0;
+  }
+  if (m_jobResumeEvent != NULL) {
+    OsDeleteEvent(m_jobResumeEvent);
+    m_jobResumeEvent = 0;
+  }
 
   pmsgMaster("Stopped job task thread\n");
 
+  // stop the companion thread, the job task no longer wakes it up
+  if (m_companionThread != NULL) {
+
+    m_companionThreadShutdown = true;
+    OsSetEvent(m_companionEvent);
+
+    m_Timer.Start(2000);
+    while(!m_Timer.IsElapsed() && m_companionThreadRunning) {
+      OsSleep(10);
+    }
+    OsDeleteThreadHandle(m_companionThread);
+    m_companionThread = 0;
+
+    // a thread which did not stop may still use the event
+    if (m_jobThreadRunning || m_companionThreadRunning) {
+      pwrnMaster("Companion thread did not stop, its event is not released\n");
+    } else {
+      OsDeleteEvent(m_companionEvent);
+      m_companionEvent = 0;
+    }
+
+    pmsgMaster("Stopped companion thread (%llu runs skipped)\n", (unsigned long long) m_companionSkipped.load());
+  }
+
+  if (m_tracer.isEnabled()) {
+    m_tracer.enable(false);
+    if (!m_tracer.dump(instanceName(HWL_EC_TRACE_FILE).c_str())) {
+      pmsgMaster("Wrote timeline to %s\n", instanceName(HWL_EC_TRACE_FILE).c_str());
+    }
+  }
+
+  m_stats.close();
+
   // Did we start the RaS Server?
   if (m_rasStarted) {
     printf("Stopping Remote API Server...\n");
@@ -277,7 +449,7 @@ template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > void AcEcMas
     
     // CoE emergency objects don't have a separate mailbox object
     if ((*it)->m_offset != BUSVAR_COE_EMERGENCY) {
-      ecatMbxTferDelete((*it)->m_tferObj);
+      emMbxTferDelete(m_instanceId, (*it)->m_tferObj);
     }
   }
   // clear list
@@ -286,7 +458,7 @@ template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > void AcEcMas
   pmsgMaster("Deleted Mailbox Transfer Objects\n");
 
   // deinit master
-  m_lastRes = ecatDeinitMaster();
+  m_lastRes = emDeinitMaster(m_instanceId);
   if (m_lastRes != EC_E_NOERROR) {
     LOG_EC_ERROR("Cannot deinitialize EtherCAT Master", m_lastRes);
   }
@@ -294,6 +466,26 @@ template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > void AcEcMas
   pmsgMaster("Deinitialized EtherCAT Master\n");
   m_initialized = false;
 
+  stopLogging();
+
+}
+
+// ===============
+// = stopLogging =
+// ===============
+template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > void AcEcMaster<SlaveInstanceMapperPolicy, EcLinkLayerPolicy>::stopLogging() {
+
+  if (!m_loggingAttached) {
+    return;
+  }
+  m_loggingAttached = false;
+
+#ifdef XSTDIO_DEFERRED
+  // writes the pending messages, later ones are written directly
+  if (AcEcInstanceRegistry::detachLogging() == 0) {
+    xlog_stop();
+  }
+#endif
 }
 
 
@@ -303,7 +495,7 @@ template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > void AcEcMas
 template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > EC_T_DWORD AcEcMaster<SlaveInstanceMapperPolicy, EcLinkLayerPolicy>::configure(const std::string& eniFile) {
 
   // configure the etherCAT Master with the given eni file
-  m_lastRes = ecatConfigureMaster(eCnfType_Filename, (unsigned char*) eniFile.c_str(), eniFile.length()+1);
+  m_lastRes = emConfigureMaster(m_instanceId, eCnfType_Filename, (unsigned char*) eniFile.c_str(), eniFile.length()+1);
   if (m_lastRes != EC_E_NOERROR) {
     LOG_EC_ERROR("Cannot configure EtherCAT Master!", m_lastRes);
     this->shutdown();
@@ -313,6 +505,14 @@ template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > EC_T_DWORD A
 
   pmsgMaster("Configuration successful\n");
 
+  // Parse the process variable table for linking without the stack
+  if (m_eniDirectory.load(eniFile)) {
+    pwrnMaster("Could not read ENI variable directory, linking via the stack\n");
+  } else {
+    pmsgMaster("ENI variable directory: %u slaves, %u process variables\n", 
+                (unsigned int) m_eniDirectory.getSlaves().size(), (unsigned int) m_eniDirectory.getVars().size());
+  }
+
   // (Re)Configure distributed clocks?
   if (m_enableDC) {
   
@@ -333,7 +533,7 @@ template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > EC_T_DWORD A
     }
   
     // configure DCs
-    m_lastRes = ecatDcConfigure(&DCconfig);
+    m_lastRes = emDcConfigure(m_instanceId, &DCconfig);
     if (m_lastRes != EC_E_NOERROR) {
       LOG_EC_ERROR("Cannot configure Distributed Clocks!", m_lastRes);
       return m_lastRes;
@@ -349,10 +549,11 @@ template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > EC_T_DWORD A
     DCMConfig.u.BusShift.nCtlSetVal = ((m_busCycleTimeUs*2)/3)*1000; // 66% of the bus cycle time
     DCMConfig.u.BusShift.dwInSyncLimit = (m_busCycleTimeUs*1000)/10; // 10% of the bus cycle time for InSync monitoring limit
     DCMConfig.u.BusShift.dwInSyncSettleTime = HWL_EC_DCM_SETTLE_TIME;
-    DCMConfig.u.BusShift.bLogEnabled = m_logDCStatus;  // Store logging information if true
+    DCMConfig.u.BusShift.bLogEnabled = EC_FALSE;  // text log not used, see m_dcmLog
+    m_dcmCtlSetVal = DCMConfig.u.BusShift.nCtlSetVal;
 
     // init DCM
-    m_lastRes = ecatDcmConfigure(&DCMConfig, 0);
+    m_lastRes = emDcmConfigure(m_instanceId, &DCMConfig, 0);
     if (m_lastRes != EC_E_NOERROR) {
     
       if (m_lastRes == EC_E_FEATURE_DISABLED) {
@@ -374,7 +575,7 @@ template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > EC_T_DWORD A
   }
 
   // register this client to the master
-  m_lastRes = ecatRegisterClient(AcEcNotifyWrapper<SlaveInstanceMapperPolicy, EcLinkLayerPolicy>, (void*) this, &m_client);
+  m_lastRes = emRegisterClient(m_instanceId, AcEcNotifyWrapper<SlaveInstanceMapperPolicy, EcLinkLayerPolicy>, (void*) this, &m_client);
   if (m_lastRes != EC_E_NOERROR) {
     LOG_EC_ERROR("Cannot register client!", m_lastRes);
     this->shutdown();
@@ -389,9 +590,10 @@ template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > EC_T_DWORD A
 
   // Link the BusTime variable
   EC_T_PROCESS_VAR_INFO varInfo;
-  m_lastRes = ecatFindInpVarByName((EC_T_CHAR*) "Inputs.BusTime", &varInfo);
+  m_lastRes = emFindInpVarByName(m_instanceId, (EC_T_CHAR*) "Inputs.BusTime", &varInfo);
   if (m_lastRes != EC_E_NOERROR) {
     LOG_EC_ERROR("\nError finding BusTime input variable! There may be no slave with DC-Support or just one slave?", m_lastRes);
+    pwrnMaster("Input stamps without bus time\n");
     return EC_E_NOERROR;
   }
   
@@ -412,6 +614,9 @@ template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > EC_T_DWORD A
   m_busTime.m_offset = varInfo.nBitOffs;
   m_variablesInputPDO.push_back(&m_busTime);
 
+  // the job task reads the bus time from now on
+  m_busTimeLinked.store(true, std::memory_order_release);
+
   pmsgMaster("Linked BusTime variable\n");
 
   return m_lastRes;
@@ -424,70 +629,55 @@ template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > EC_T_DWORD A
 template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > bool AcEcMaster<SlaveInstanceMapperPolicy, EcLinkLayerPolicy>::linkPDOVar(BusSlave<SlaveInstanceMapperPolicy>* const slave, const std::string& varName, 
                     BusVarType* ptr) {
   
-  EC_T_PROCESS_VAR_INFO varInfo;
+  EC_T_INT    bitSize = 0;
+  EC_T_INT    bitOffs = 0;
+  EC_T_WORD   dataType = 0;
 
-  /* Retrieve the full Identifier from the slave instance: */
-  std::string fullName = slave->getFullIdentifier(varName);
+  // the copy lists are fixed once the bus has been started
+  if (m_pdoLayout.load(std::memory_order_acquire) != NULL) {
+    perrMaster("Can not link %s after the first state change\n", slave->getFullIdentifier(varName).c_str());
+    return true;
+  }
 
   // check if PDO var
   if (!ptr->isPDO()) {
-    perrMaster("Can not link SDO var with linkPDOVar(), %s\n", fullName.c_str());
+    perrMaster("Can not link SDO var with linkPDOVar(), %s\n", slave->getFullIdentifier(varName).c_str());
     EC_FAULT; // fatal error
     return true;
   }
 
-  // get variable data from the master
-  if (ptr->isOutput()) {
-
-    // output var
-    m_lastRes = ecatFindOutpVarByName(const_cast<char*>(fullName.c_str()), &varInfo);
-    if (m_lastRes != EC_E_NOERROR) {
-      perrMaster("Error linking bus variable %s\n", fullName.c_str());
-      LOG_EC_ERROR("Error finding slave output variable in config!", m_lastRes);   
-      EC_FAULT; // fatal error
-      return true; 
-    }
-
-
-  } else {
-
-    // input var
-    m_lastRes = ecatFindInpVarByName(const_cast<char*>(fullName.c_str()), &varInfo);
-    if (m_lastRes != EC_E_NOERROR) {
-      perrMaster("Error linking bus variable %s\n", fullName.c_str());
-      LOG_EC_ERROR("Error finding slave input variable in config!", m_lastRes);   
-      EC_FAULT; // fatal error
-      return true; 
-    }
-
+  if (findPDOVar(slave, varName, ptr->isOutput(), bitSize, bitOffs, dataType)) {
+    return true;
   }
 
   // check configuration...
-  if (ptr->getSize() != (unsigned int) varInfo.nBitSize) {
-    perrMaster("Error linking bus variable %s\n", fullName.c_str());
+  if (ptr->getSize() != (unsigned int) bitSize) {
+    perrMaster("Error linking bus variable %s\n", slave->getFullIdentifier(varName).c_str());
     perrMaster("Variable size mismatch in linkPDOVar()!\n"
                  "size of bus variable instance: %d\n"
                  "size read from config file: %d\n",
-                 ptr->getSize(),varInfo.nBitSize);
+                 ptr->getSize(), bitSize);
     EC_FAULT; // fatal error
     return true;
   }
 
-  if (!isOfBusType(ptr, varInfo.wDataType)) {
-    perrMaster("Error linking bus variable %s\n", fullName.c_str());
+  if (!isOfBusType(ptr, dataType)) {
+    perrMaster("Error linking bus variable %s\n", slave->getFullIdentifier(varName).c_str());
     perrMaster("Variable type mismatch in linkPDOVar()!\n"
                  "Type of bus variable: %s\n"
                  "EcType from config file: %d\n",
-                 ptr->getTypeId()->name(), varInfo.wDataType);
+                 ptr->getTypeId()->name(), dataType);
     EC_FAULT; // fatal error
     return true;
   }
 
   // and store the offset in the PDO map
-  ptr->m_offset = varInfo.nBitOffs;
+  ptr->m_offset = bitOffs;
+
+  statsSlave(slave);
 
 #ifdef HWL_EC_VERBOSE
-  pdbgMaster("Linked PDO variable '%s'\n", fullName.c_str());
+  pdbgMaster("Linked PDO variable '%s'\n", slave->getFullIdentifier(varName).c_str());
 #endif
 
   // Statistics
@@ -499,6 +689,128 @@ template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > bool AcEcMas
 
 }
 
+// ==============
+// = findPDOVar =
+// ==============
+template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > bool AcEcMaster<SlaveInstanceMapperPolicy, EcLinkLayerPolicy>::findPDOVar(BusSlave<SlaveInstanceMapperPolicy>* const slave, const std::string& varName, 
+                    bool isOutput, EC_T_INT& bitSize, EC_T_INT& bitOffs, EC_T_WORD& dataType) {
+
+  // Look up the variable in the offline ENI directory
+  // (no string assembly, no stack call)
+  const EniVar* eniVar = m_eniDirectory.find(slave->getName(), varName, isOutput);
+
+  if (eniVar) {
+
+    bitSize = eniVar->bitSize;
+    bitOffs = eniVar->bitOffset;
+    dataType = eniVar->dataType;
+
+  } else {
+
+    // fall back to the lookup via the stack
+    EC_T_PROCESS_VAR_INFO varInfo;
+
+    /* Retrieve the full Identifier from the slave instance: */
+    std::string fullName = slave->getFullIdentifier(varName);
+
+#ifdef HWL_EC_VERBOSE
+    pdbgMaster("'%s' not in the ENI directory, asking the stack\n", fullName.c_str());
+#endif
+
+    // get variable data from the master
+    if (isOutput) {
+
+      // output var
+      m_lastRes = emFindOutpVarByName(m_instanceId, const_cast<char*>(fullName.c_str()), &varInfo);
+      if (m_lastRes != EC_E_NOERROR) {
+        perrMaster("Error linking bus variable %s\n", fullName.c_str());
+        LOG_EC_ERROR("Error finding slave output variable in config!", m_lastRes);   
+        EC_FAULT; // fatal error
+        return true; 
+      }
+
+    } else {
+
+      // input var
+      m_lastRes = emFindInpVarByName(m_instanceId, const_cast<char*>(fullName.c_str()), &varInfo);
+      if (m_lastRes != EC_E_NOERROR) {
+        perrMaster("Error linking bus variable %s\n", fullName.c_str());
+        LOG_EC_ERROR("Error finding slave input variable in config!", m_lastRes);   
+        EC_FAULT; // fatal error
+        return true; 
+      }
+
+    }
+
+    bitSize = varInfo.nBitSize;
+    bitOffs = varInfo.nBitOffs;
+    dataType = varInfo.wDataType;
+  }
+
+  return false;
+
+}
+
+// ===============
+// = linkPDOBits =
+// ===============
+template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > bool AcEcMaster<SlaveInstanceMapperPolicy, EcLinkLayerPolicy>::linkPDOBits(BusSlave<SlaveInstanceMapperPolicy>* const slave, const std::vector<std::string>& varNames, 
+                    BusVarType* ptr) {
+
+  EC_T_INT    bitSize = 0;
+  EC_T_INT    bitOffs = 0;
+  EC_T_WORD   dataType = 0;
+  EC_T_INT    firstOffs = 0;
+
+  if (varNames.empty() || varNames.size() != ptr->getSize()) {
+    perrMaster("linkPDOBits(): %u variable names for %u bits\n", (unsigned int) varNames.size(), ptr->getSize());
+    EC_FAULT; // fatal error
+    return true;
+  }
+
+  // the copy lists are fixed once the bus has been started
+  if (m_pdoLayout.load(std::memory_order_acquire) != NULL) {
+    perrMaster("Can not link %s after the first state change\n", slave->getFullIdentifier(varNames[0]).c_str());
+    return true;
+  }
+
+  // all entries must be single booleans, one after the other
+  for (size_t i = 0; i < varNames.size(); i++) {
+
+    if (findPDOVar(slave, varNames[i], ptr->isOutput(), bitSize, bitOffs, dataType)) {
+      return true;
+    }
+
+    if (i == 0) {
+      firstOffs = bitOffs;
+    }
+
+    if (bitSize != 1 || dataType != DEFTYPE_BOOLEAN || bitOffs != firstOffs + (EC_T_INT) i) {
+      perrMaster("Error linking bus variable %s\n", slave->getFullIdentifier(varNames[i]).c_str());
+      perrMaster("linkPDOBits() requires contiguous boolean entries (offset %d, expected %d, size %d)\n",
+                 bitOffs, firstOffs + (EC_T_INT) i, bitSize);
+      EC_FAULT; // fatal error
+      return true;
+    }
+  }
+
+  // and store the offset of the first entry in the PDO map
+  ptr->m_offset = firstOffs;
+
+  statsSlave(slave);
+
+#ifdef HWL_EC_VERBOSE
+  pdbgMaster("Linked %u PDO bits '%s'..\n", ptr->getSize(), slave->getFullIdentifier(varNames[0]).c_str());
+#endif
+
+  // Statistics
+  m_numLinkedPDOVars++;
+  m_byteSizePDOMap += (ptr->getSize() + 7) / 8;
+
+  // call parent
+  return BusMaster<SlaveInstanceMapperPolicy>::linkPDOVar(slave, varNames[0], ptr);
+}
+
 // ==============
 // = linkSDOVar =
 // ==============
@@ -537,6 +849,7 @@ template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > bool AcEcMas
 
     // store the slave's station address in the objId variable
     ptr->m_objId = slave->getStationAddress();
+    ptr->m_statsIdx = statsSlave(slave);
 
 #ifdef HWL_EC_VERBOSE
     pdbgMaster("Linked SDO CoE Emergency Object for '%s'\n", slave->getName().c_str());
@@ -553,7 +866,7 @@ template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > bool AcEcMas
   mbxDesc.dwMaxDataLen = (EC_T_DWORD) ptr->getSize();
   mbxDesc.pbyMbxTferDescData = (EC_T_BYTE*) ptr->getPointer();
 
-  ptr->m_tferObj = ecatMbxTferCreate(&mbxDesc);
+  ptr->m_tferObj = emMbxTferCreate(m_instanceId, &mbxDesc);
 
   if (ptr->m_tferObj == NULL) {
     perrMaster("Can not create Mailbox transfer object for %s, objIndex: 0x%x, subIdx: 0x%x\n", slave->getName().c_str(), objIndex, objSubIndex);
@@ -572,10 +885,11 @@ template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > bool AcEcMas
   ptr->m_objId = objIndex;
   ptr->m_subIdx = objSubIndex;
   ptr->m_slaveId = slave->getSlaveID();
+  ptr->m_statsIdx = statsSlave(slave);
 
   if (ptr->m_slaveId == INVALID_SLAVE_ID) {
     perrMaster("Error linking to SDO with objIndex 0x%x, subIdx 0x%x: Couldn't find slave %s\n", objIndex, objSubIndex, slave->getName().c_str());
-    ecatMbxTferDelete(ptr->m_tferObj);
+    emMbxTferDelete(m_instanceId, ptr->m_tferObj);
     ptr->m_tferObj = NULL;
     EC_FAULT; // fatal error
     return true;
@@ -621,20 +935,24 @@ template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > bool AcEcMas
   ptr->m_SDOTransferFailed = false;
   
   //! Set the transfer id
-  ptr->m_tferObj->dwTferId = AcEcGlobalUIDCounter++;
+  ptr->m_tferObj->dwTferId = m_tferIdCounter++;
 
   // reset the state of the transfer object
   ptr->m_tferObj->eTferStatus = eMbxTferStatus_Idle;
 
   // initiate the SDO download
-  res = ecatCoeSdoDownloadReq(ptr->m_tferObj, ptr->m_slaveId, ptr->m_objId, ptr->m_subIdx, HWL_EC_SYNC_COE_TIMEOUT_MS, 0);
+  ptr->m_SDORequestNs = busStatsNowNs();
+  m_stats.sdoStarted(ptr->m_statsIdx);
+  m_tracer.asyncBegin("sdo download", ptr->m_tferObj->dwTferId, ((uint64_t) ptr->m_objId << 8) | ptr->m_subIdx);
+  res = emCoeSdoDownloadReq(m_instanceId, ptr->m_tferObj, ptr->m_slaveId, ptr->m_objId, ptr->m_subIdx, HWL_EC_SYNC_COE_TIMEOUT_MS, 0);
 
 #ifdef HWL_EC_VERBOSE
   pdbgMaster("Requesting asynchronous SDO transfer (%d) to %s, objIndex=0x%x, subIdx=0x%x\n", ptr->m_tferObj->dwTferId, slave->getName().c_str(), ptr->m_objId, ptr->m_subIdx);
 #endif
 
   if (res != EC_E_NOERROR) {
-    LOG_EC_ERROR("Error during ecatCoeSdoDownloadReq", res);
+    LOG_EC_ERROR("Error during emCoeSdoDownloadReq", res);
+    m_stats.sdoCompleted(ptr->m_statsIdx, true, 0);
     EC_FAULT; // fatal error
     return true;
   }
@@ -672,20 +990,24 @@ template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > bool AcEcMas
   ptr->m_SDOTransferFailed = false;
 
   //! Set the transfer id
-  ptr->m_tferObj->dwTferId = AcEcGlobalUIDCounter++;
+  ptr->m_tferObj->dwTferId = m_tferIdCounter++;
 
   // reset the state of the transfer object
   ptr->m_tferObj->eTferStatus = eMbxTferStatus_Idle;
 
   // initiate the SDO upload
-  res = ecatCoeSdoUploadReq(ptr->m_tferObj, ptr->m_slaveId, ptr->m_objId, ptr->m_subIdx, HWL_EC_SYNC_COE_TIMEOUT_MS, 0);
+  ptr->m_SDORequestNs = busStatsNowNs();
+  m_stats.sdoStarted(ptr->m_statsIdx);
+  m_tracer.asyncBegin("sdo upload", ptr->m_tferObj->dwTferId, ((uint64_t) ptr->m_objId << 8) | ptr->m_subIdx);
+  res = emCoeSdoUploadReq(m_instanceId, ptr->m_tferObj, ptr->m_slaveId, ptr->m_objId, ptr->m_subIdx, HWL_EC_SYNC_COE_TIMEOUT_MS, 0);
 
 #ifdef HWL_EC_VERBOSE
   pdbgMaster("Requesting asynchronous SDO transfer (%d) from %s, objIndex=0x%x, subIdx=0x%x\n", ptr->m_tferObj->dwTferId, slave->getName().c_str(), ptr->m_objId, ptr->m_subIdx);
 #endif
 
   if (res != EC_E_NOERROR) {
-    LOG_EC_ERROR("Error during ecatCoeSdoUploadReq", res);
+    LOG_EC_ERROR("Error during emCoeSdoUploadReq", res);
+    m_stats.sdoCompleted(ptr->m_statsIdx, true, 0);
     EC_FAULT; // fatal error
     return true;
   }
@@ -710,7 +1032,7 @@ template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > bool AcEcMas
   pdbgMaster("Sending synchronous SDO to %s, objIndex=0x%x, subIdx=0x%x\n", slave->getName().c_str(), objIndex, objSubIndex);
 #endif
 
-  m_lastRes = ecatCoeSdoDownload(slave->getSlaveID(), objIndex, objSubIndex, (EC_T_BYTE*) data, dataLen, HWL_EC_SYNC_COE_TIMEOUT_MS, EC_NULL);
+  m_lastRes = emCoeSdoDownload(m_instanceId, slave->getSlaveID(), objIndex, objSubIndex, (EC_T_BYTE*) data, dataLen, HWL_EC_SYNC_COE_TIMEOUT_MS, EC_NULL);
   if (m_lastRes != EC_E_NOERROR) {
     LOG_EC_ERROR("Error during synchronous SDO Download!", m_lastRes);   
     EC_FAULT; // fatal error
@@ -739,7 +1061,7 @@ template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > bool AcEcMas
 
   EC_T_DWORD dataReceived;
 
-  m_lastRes = ecatCoeSdoUpload(slave->getSlaveID(), objIndex, objSubIndex, (EC_T_BYTE*) data, dataLen, &dataReceived, HWL_EC_SYNC_COE_TIMEOUT_MS, EC_NULL);
+  m_lastRes = emCoeSdoUpload(m_instanceId, slave->getSlaveID(), objIndex, objSubIndex, (EC_T_BYTE*) data, dataLen, &dataReceived, HWL_EC_SYNC_COE_TIMEOUT_MS, EC_NULL);
   if (m_lastRes != EC_E_NOERROR) {
     LOG_EC_ERROR("Error during synchronous SDO Upload!", m_lastRes);
     EC_FAULT; // fatal error
@@ -760,7 +1082,7 @@ template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > bool AcEcMas
 // ============
 template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > BusState AcEcMaster<SlaveInstanceMapperPolicy, EcLinkLayerPolicy>::getState() {
 
-  m_curState = ecatGetMasterState();
+  m_curState = emGetMasterState(m_instanceId);
   
   switch(m_curState) {
     
@@ -786,6 +1108,11 @@ template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > BusState AcE
 // =====================
 template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > void AcEcMaster<SlaveInstanceMapperPolicy, EcLinkLayerPolicy>::setRequestedState(const BusState& reqState, const bool& blocking) {
   
+  // all variables are linked now, without the layout they are copied one by one
+  if (requestPdoLayout()) {
+    pwrnMaster("PDO layout not available, retried with the next state request\n");
+  }
+
   m_reqState = eEcatState_UNKNOWN;
   
   switch(reqState) {
@@ -819,7 +1146,8 @@ template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > void AcEcMas
 // ==============
 template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > void AcEcMaster<SlaveInstanceMapperPolicy, EcLinkLayerPolicy>::resetFault() {
 
-  if (!m_busRecoveryActive) {
+  // slave recoveries continue in OP, the master state is left alone
+  if (!m_busRecoveryActive && m_slaveRecovery.empty()) {
     // Reset requested bus state
     switchStateASync(eEcatState_OP);
   }
@@ -829,70 +1157,129 @@ template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > void AcEcMas
   
 }
 
+// ================
+// = processSlave =
+// ================
+template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > void AcEcMaster<SlaveInstanceMapperPolicy, EcLinkLayerPolicy>::processSlave(size_t idx) {
+
+  BusSlave<SlaveInstanceMapperPolicy>* slave = m_slaves[idx];
+
+  uint64_t start = busStatsNowNs();
+  BusMaster<SlaveInstanceMapperPolicy>::processOnSlave(slave);
+  uint64_t end = busStatsNowNs();
+
+  SlaveProcessTiming& timing = m_processTiming[idx];
+  uint32_t us = (uint32_t) ((end - start) / 1000);
+  timing.lastUs.store(us, std::memory_order_relaxed);
+  if (us > timing.maxUs.load(std::memory_order_relaxed)) {
+    timing.maxUs.store(us, std::memory_order_relaxed);
+  }
+
+  if (m_tracer.isEnabled()) {
+    m_tracer.complete(slave->getName().c_str(), start, end, m_cycleCounter);
+  }
+}
+
 // ===========
 // = process =
 // ===========
 template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > void AcEcMaster<SlaveInstanceMapperPolicy, EcLinkLayerPolicy>::process() {
   
   typedef typename std::vector<BusSlave<SlaveInstanceMapperPolicy>*>::iterator SlaveIterator;
-  m_curState = ecatGetMasterState();
+  m_curState = emGetMasterState(m_instanceId);
+  uint64_t now = busStatsNowNs();
   
   
   if (m_busRecoveryActive) {
     
-    if (m_Timer.IsElapsed()) {
+    // bus-wide state change in progress, OP is reached once all slaves report it
+    // (otherwise runBusRecovery() would send the bus back to SAFEOP)
+    bool reached = (m_curState == m_busRecoveryTarget) &&
+                   (m_busRecoveryTarget != eEcatState_OP || m_allDevsInOperationalState);
+    if (reached || m_Timer.IsElapsed()) {
       m_Timer.Stop();
       m_busRecoveryActive = false;
     }
     
-  } else if (!m_allDevsInOperationalState) {
-    // Check the bus state and possible error recovery measures
-    
-    EC_T_DWORD connectedSlaves = ecatGetNumConnectedSlaves();
-    
-    // switch to SAFEOP in case a slave is missing
-    if (m_curState == eEcatState_OP) {
-      
-      // State change
-      switchStateASync(eEcatState_SAFEOP);
-      m_Timer.Start(3000);  // Start 3 Seconds timeout
-      m_busRecoveryActive = true;
-      
-    } else if (!m_fault && connectedSlaves == ecatGetNumConfiguredSlaves() && m_curState != eEcatState_INIT) {
-      
-      pwrnMaster("Bus Recovery - trying to set master into INIT state.\n");
-      switchStateASync(eEcatState_INIT);
-      m_Timer.Start(3000);  // Start 3 Seconds timeout
-      m_busRecoveryActive = true;
-      
-    } else if (!m_fault && connectedSlaves == ecatGetNumConfiguredSlaves() && m_curState == eEcatState_INIT && m_reqState == eEcatState_OP) {
-      
-      // blocking...
-      pwrnMaster("Bus Recovery - trying to set master into OP state.\n");
-      switchStateASync(eEcatState_OP);
-      m_Timer.Start(3000);  // Start 3 Seconds timeout
-      m_busRecoveryActive = true;
-      
+  } else if (m_incrementalRecovery && m_curState == eEcatState_OP && !m_busRecovery.isActive()
+             && (!m_allDevsInOperationalState || !m_slaveRecovery.empty())) {
+    // Recover the dropped slaves, the others stay in OP
+
+    if (runSlaveRecovery(now)) {
+
+      pwrnMaster("Bus Recovery - slave recovery failed, switching the bus to SAFEOP.\n");
+      abortSlaveRecovery(now);
+      runBusRecovery(now);
     }
     
+  } else if (!m_allDevsInOperationalState) {
+    // Check the bus state and possible error recovery measures
+    runBusRecovery(now);
+  }
+
+  // slave recoveries end with the bus leaving OP
+  if (!m_slaveRecovery.empty() && m_curState != eEcatState_OP) {
+    abortSlaveRecovery(now);
+  }
+
+  // bus-wide recovery finished
+  if (m_busRecovery.isActive() && !m_busRecoveryActive && m_allDevsInOperationalState && m_curState == eEcatState_OP) {
+    logRecovery(m_busRecovery.finish(true, now));
   }
   
   
   // process() and init() methods: trigger slaves only in SAFEOP and OP mode
   if (m_curState == eEcatState_OP || m_curState == eEcatState_SAFEOP) {
   
-    // Call process() and initOP() on the slaves
-    for (SlaveIterator it = m_slaves.begin(); it != m_slaves.end(); ++it) {
-      
-      if (m_curState != m_prevState && m_curState == eEcatState_OP) {
-        // trigger initOp
+    // Call initOP() on the slaves
+    if (m_curState != m_prevState && m_curState == eEcatState_OP) {
+      for (SlaveIterator it = m_slaves.begin(); it != m_slaves.end(); ++it) {
         BusMaster<SlaveInstanceMapperPolicy>::initOpOnSlave(*it);
       }
-      
-      // call process on slave
-      BusMaster<SlaveInstanceMapperPolicy>::processOnSlave(*it);
+    }
+
+    // split the slaves into serial and parallel ones (after registration of new slaves)
+    if (m_processSlavesSorted != m_slaves.size()) {
+
+      m_processTiming.resize(m_slaves.size());
+      m_serialSlaves.clear();
+      m_parallelSlaves.clear();
+      for (size_t i = 0; i < m_slaves.size(); i++) {
+        if (m_processPool.size() > 0 && !m_slaves[i]->requiresSerialProcess()) {
+          m_parallelSlaves.push_back(i);
+        } else {
+          m_serialSlaves.push_back(i);
+        }
+      }
+
+      // spread the slaves with reduced rate over the calls
+      std::vector<uint32_t> divisors;
+      std::vector<int32_t> phases;
+      for (size_t i = 0; i < m_slaves.size(); i++) {
+        divisors.push_back(m_slaves[i]->getProcessDivisor());
+        phases.push_back(m_slaves[i]->getProcessPhase());
+      }
+      slaveScheduleAssign(divisors, phases, m_processSlot);
 
+      m_processSlavesSorted = m_slaves.size();
     }
+
+    // Call process() on the slaves due in this call
+    for (size_t idx : m_serialSlaves) {
+      if (isSlaveDue(idx)) {
+        processSlave(idx);
+      }
+    }
+
+    m_dueSlaves.clear();
+    for (size_t idx : m_parallelSlaves) {
+      if (isSlaveDue(idx)) {
+        m_dueSlaves.push_back(idx);
+      }
+    }
+    m_processPool.run(&AcEcMaster::processParallelSlave, this, m_dueSlaves.size());
+
+    m_processCalls++;
   }
   
   // First initialization from UNKNOWN
@@ -912,29 +1299,413 @@ template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > void AcEcMas
 
 
 
+// ==================
+// = runBusRecovery =
+// ==================
+template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > void AcEcMaster<SlaveInstanceMapperPolicy, EcLinkLayerPolicy>::runBusRecovery(uint64_t nowNs) {
+
+  EC_T_DWORD connectedSlaves = emGetNumConnectedSlaves(m_instanceId);
+  bool allConnected = (connectedSlaves == emGetNumConfiguredSlaves(m_instanceId));
+
+  // switch to SAFEOP in case a slave is missing
+  if (m_curState == eEcatState_OP) {
+
+    if (!m_busRecovery.isActive()) {
+      m_busRecovery.start(0, true, nowNs);
+    }
+    m_busRecovery.enter(BUS_RECOVERY_SAFEOP, nowNs);
+
+    // State change
+    switchStateASync(eEcatState_SAFEOP);
+    m_busRecoveryTarget = eEcatState_SAFEOP;
+    m_Timer.Start(HWL_EC_RECOVERY_STATE_TIMEOUT_MS);
+    m_busRecoveryActive = true;
+
+  } else if (!m_fault && allConnected && m_curState != eEcatState_INIT) {
+
+    if (!m_busRecovery.isActive()) {
+      m_busRecovery.start(0, true, nowNs);
+    }
+    m_busRecovery.enter(BUS_RECOVERY_INIT, nowNs);
+
+    pwrnMaster("Bus Recovery - trying to set master into INIT state.\n");
+    switchStateASync(eEcatState_INIT);
+    m_busRecoveryTarget = eEcatState_INIT;
+    m_Timer.Start(HWL_EC_RECOVERY_STATE_TIMEOUT_MS);
+    m_busRecoveryActive = true;
+
+  } else if (!m_fault && allConnected && m_curState == eEcatState_INIT && m_reqState == eEcatState_OP) {
+
+    if (!m_busRecovery.isActive()) {
+      m_busRecovery.start(0, true, nowNs);
+    }
+    m_busRecovery.enter(BUS_RECOVERY_OP, nowNs);
+
+    pwrnMaster("Bus Recovery - trying to set master into OP state.\n");
+    switchStateASync(eEcatState_OP);
+    m_busRecoveryTarget = eEcatState_OP;
+    m_Timer.Start(HWL_EC_RECOVERY_STATE_TIMEOUT_MS);
+    m_busRecoveryActive = true;
+
+  } else if (m_busRecovery.isActive()) {
+
+    // waiting for the slaves or the application
+    BusRecoveryPhase phase = !allConnected ? BUS_RECOVERY_RECONNECT : BUS_RECOVERY_FAULT_RESET;
+    if (m_busRecovery.getPhase() != phase && (!allConnected || m_fault)) {
+      m_busRecovery.enter(phase, nowNs);
+    }
+  }
+}
+
+// ====================
+// = runSlaveRecovery =
+// ====================
+template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > bool AcEcMaster<SlaveInstanceMapperPolicy, EcLinkLayerPolicy>::runSlaveRecovery(uint64_t nowNs) {
+
+  // slaves to check: all of the ENI, the registered ones without ENI
+  if (m_recoveryStations.empty()) {
+    for (const EniSlave& slave : m_eniDirectory.getSlaves()) {
+      m_recoveryStations.push_back(slave.physAddr);
+    }
+    if (m_recoveryStations.empty()) {
+      for (size_t i = 0; i < m_slaves.size(); i++) {
+        m_recoveryStations.push_back(m_slaves[i]->getStationAddress());
+      }
+    }
+  }
+
+  // new drop-outs, the scan queries every slave and is rate-limited
+  if (!m_allDevsInOperationalState && nowNs - m_recoveryScanNs >= HWL_EC_RECOVERY_SCAN_INTERVAL_MS * 1000000ULL) {
+    m_recoveryScanNs = nowNs;
+    for (EC_T_WORD station : m_recoveryStations) {
+
+      bool known = false;
+      for (const SlaveRecovery& r : m_slaveRecovery) {
+        known = known || (r.stationAddress == station);
+      }
+      if (known) {
+        continue;
+      }
+
+      EC_T_DWORD slaveId = emGetSlaveId(m_instanceId, station);
+      if (slaveId == INVALID_SLAVE_ID) {
+        continue;
+      }
+
+      EC_T_WORD curState = 0, reqState = 0;
+      if (emGetSlaveState(m_instanceId, slaveId, &curState, &reqState) == EC_E_NOERROR && curState == DEVICE_STATE_OP) {
+        continue;
+      }
+
+      pwrnMaster("Bus Recovery - slave %d left OP, recovering it while the bus stays in OP.\n", station);
+
+      m_slaveRecovery.push_back(SlaveRecovery());
+      SlaveRecovery& r = m_slaveRecovery.back();
+      r.stationAddress = station;
+      r.slaveId = slaveId;
+      r.timeline.start(station, false, nowNs);
+    }
+  }
+
+  // advance the recovering slaves by one step each
+  for (typename std::vector<SlaveRecovery>::iterator it = m_slaveRecovery.begin(); it != m_slaveRecovery.end(); ) {
+
+    SlaveRecovery& r = *it;
+
+    EC_T_BOOL present = EC_FALSE;
+    EC_T_WORD curState = 0, reqState = 0;
+    if (emIsSlavePresent(m_instanceId, r.slaveId, &present) != EC_E_NOERROR) {
+      present = EC_FALSE;
+    }
+    if (!present || emGetSlaveState(m_instanceId, r.slaveId, &curState, &reqState) != EC_E_NOERROR) {
+      curState = 0;
+    }
+
+    // state reached without error flag
+    EC_T_WORD state = curState & DEVICE_STATE_MASK;
+    bool ok = !(curState & DEVICE_STATE_ERROR);
+    bool done = false;
+
+    BusRecoveryPhase phase = r.timeline.getPhase();
+    EC_T_WORD next = 0;
+
+    if (!present) {
+      // dropped (again), wait for the slave
+      if (phase != BUS_RECOVERY_RECONNECT) {
+        r.timeline.enter(BUS_RECOVERY_RECONNECT, nowNs);
+      } else if (r.timeline.getPhaseMs(nowNs) > HWL_EC_RECOVERY_RECONNECT_TIMEOUT_MS) {
+        perrMaster("Bus Recovery - slave %d did not reconnect within %u ms!\n", r.stationAddress,
+                   (unsigned int) HWL_EC_RECOVERY_RECONNECT_TIMEOUT_MS);
+        return true;
+      }
+    } else if (phase == BUS_RECOVERY_RECONNECT) {
+      // reset the slave and acknowledge its errors
+      next = DEVICE_STATE_INIT;
+      r.timeline.enter(BUS_RECOVERY_INIT, nowNs);
+    } else if (phase == BUS_RECOVERY_INIT && ok && state == DEVICE_STATE_INIT) {
+      next = DEVICE_STATE_PREOP;
+      r.timeline.enter(BUS_RECOVERY_PREOP, nowNs);
+    } else if (phase == BUS_RECOVERY_PREOP && ok && state == DEVICE_STATE_PREOP) {
+      next = DEVICE_STATE_SAFEOP;
+      r.timeline.enter(BUS_RECOVERY_SAFEOP, nowNs);
+    } else if (phase == BUS_RECOVERY_SAFEOP && ok && state == DEVICE_STATE_SAFEOP) {
+      // outputs of the slave stay in the safe state until the fault is reset
+      r.timeline.enter(BUS_RECOVERY_FAULT_RESET, nowNs);
+    } else if (phase == BUS_RECOVERY_FAULT_RESET && !m_fault) {
+      next = DEVICE_STATE_OP;
+      r.timeline.enter(BUS_RECOVERY_OP, nowNs);
+    } else if (phase == BUS_RECOVERY_OP && ok && state == DEVICE_STATE_OP) {
+      done = true;
+    } else if (phase != BUS_RECOVERY_FAULT_RESET && r.timeline.getPhaseMs(nowNs) > HWL_EC_RECOVERY_STATE_TIMEOUT_MS) {
+
+      // state not reached: restart from INIT, then give up
+      if (r.timeline.getRecord().retries >= HWL_EC_RECOVERY_MAX_RETRIES) {
+        perrMaster("Bus Recovery - slave %d did not reach %s (state 0x%x)!\n", r.stationAddress,
+                   busRecoveryPhaseName(phase), curState);
+        return true;
+      }
+      pwrnMaster("Bus Recovery - slave %d did not reach %s (state 0x%x), restarting.\n", r.stationAddress,
+                 busRecoveryPhaseName(phase), curState);
+      r.timeline.retry();
+      next = DEVICE_STATE_INIT;
+      r.timeline.enter(BUS_RECOVERY_INIT, nowNs);
+    }
+
+    if (next != 0) {
+      m_lastRes = emSetSlaveState(m_instanceId, r.slaveId, next, EC_NOWAIT);
+      if (m_lastRes != EC_E_NOERROR) {
+        LOG_EC_WARNING("Bus Recovery - cannot request slave state", m_lastRes);
+      }
+    }
+
+    if (done) {
+      logRecovery(r.timeline.finish(true, nowNs));
+      it = m_slaveRecovery.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  return false;
+}
+
+// ======================
+// = abortSlaveRecovery =
+// ======================
+template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > void AcEcMaster<SlaveInstanceMapperPolicy, EcLinkLayerPolicy>::abortSlaveRecovery(uint64_t nowNs) {
+
+  for (typename std::vector<SlaveRecovery>::iterator it = m_slaveRecovery.begin(); it != m_slaveRecovery.end(); ++it) {
+    logRecovery(it->timeline.finish(false, nowNs));
+  }
+  m_slaveRecovery.clear();
+}
+
+// ===============
+// = logRecovery =
+// ===============
+template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > void AcEcMaster<SlaveInstanceMapperPolicy, EcLinkLayerPolicy>::logRecovery(const BusRecoveryRecord& record) {
+
+  if (m_recoveryLog.size() >= HWL_EC_RECOVERY_LOG_SIZE) {
+    m_recoveryLog.erase(m_recoveryLog.begin());
+  }
+  m_recoveryLog.push_back(record);
+
+  const uint32_t* ms = record.phaseMs;
+  if (record.busWide) {
+    pmsgMaster("Bus recovery %s after %u ms (safeop %u, reconnect %u, faultreset %u, init %u, op %u ms)\n",
+               record.success ? "done" : "aborted", record.totalMs, ms[BUS_RECOVERY_SAFEOP], ms[BUS_RECOVERY_RECONNECT],
+               ms[BUS_RECOVERY_FAULT_RESET], ms[BUS_RECOVERY_INIT], ms[BUS_RECOVERY_OP]);
+  } else {
+    pmsgMaster("Recovery of slave %d %s after %u ms (reconnect %u, init %u, preop %u, safeop %u, faultreset %u, op %u ms, %u restarts)\n",
+               record.stationAddress, record.success ? "done" : "aborted", record.totalMs, ms[BUS_RECOVERY_RECONNECT],
+               ms[BUS_RECOVERY_INIT], ms[BUS_RECOVERY_PREOP], ms[BUS_RECOVERY_SAFEOP], ms[BUS_RECOVERY_FAULT_RESET],
+               ms[BUS_RECOVERY_OP], record.retries);
+  }
+
+  // phases in the timeline, restarts are merged into their phase
+  if (m_tracer.isEnabled()) {
+    static const BusRecoveryPhase slaveOrder[BUS_RECOVERY_NUM_PHASES] = {
+      BUS_RECOVERY_RECONNECT, BUS_RECOVERY_INIT, BUS_RECOVERY_PREOP, BUS_RECOVERY_SAFEOP, BUS_RECOVERY_FAULT_RESET, BUS_RECOVERY_OP
+    };
+    static const BusRecoveryPhase busOrder[BUS_RECOVERY_NUM_PHASES] = {
+      BUS_RECOVERY_SAFEOP, BUS_RECOVERY_RECONNECT, BUS_RECOVERY_FAULT_RESET, BUS_RECOVERY_INIT, BUS_RECOVERY_PREOP, BUS_RECOVERY_OP
+    };
+    const BusRecoveryPhase* order = record.busWide ? busOrder : slaveOrder;
+
+    uint64_t start = record.startNs;
+    for (int i = 0; i < BUS_RECOVERY_NUM_PHASES; i++) {
+      if (ms[order[i]] > 0) {
+        uint64_t end = start + (uint64_t) ms[order[i]] * 1000000;
+        m_tracer.complete(busRecoveryPhaseName(order[i]), start, end, record.stationAddress);
+        start = end;
+      }
+    }
+  }
+}
+
+// ===============
+// = setupThread =
+// ===============
+template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > bool AcEcMaster<SlaveInstanceMapperPolicy, EcLinkLayerPolicy>::setupThread(const ThreadConfig& cfg, const char* name) {
+
+  bool error = false;
+
+  if (!cfg.cpus.empty()) {
+    EC_T_CPUSET cpuSet;
+    EC_CPUSET_ZERO(cpuSet);
+    for (int cpu : cfg.cpus) {
+      EC_CPUSET_SET(cpuSet, cpu);
+    }
+    if (!OsSetThreadAffinity(EC_NULL, cpuSet)) {
+      perrMaster("Error setting thread affinity in %s, invalid CPU index!\n", name);
+      error = true;
+    }
+  }
+
+  if (ThreadTopology::applySched(cfg)) {
+    perrMaster("Error setting the scheduling of the %s\n", name);
+    error = true;
+  }
+
+  return error;
+}
+
+// =================
+// = setThreadName =
+// =================
+template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > void AcEcMaster<SlaveInstanceMapperPolicy, EcLinkLayerPolicy>::setThreadName(const char* name) {
+
+  // names are limited to 15 characters
+  char buf[32];
+  if (m_instanceId == 0) {
+    snprintf(buf, sizeof(buf), "%s", name);
+  } else {
+    snprintf(buf, sizeof(buf), "%s%u", name, m_instanceId);
+  }
+  buf[15] = '\0';
+  pthread_setname_np(pthread_self(), buf);
+}
+
+// ================
+// = instanceName =
+// ================
+template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > std::string AcEcMaster<SlaveInstanceMapperPolicy, EcLinkLayerPolicy>::instanceName(const char* name) const {
+
+  std::string str(name);
+  if (m_instanceId == 0) {
+    return str;
+  }
+
+  // before the extension of the file name, if any
+  size_t dot = str.rfind('.');
+  size_t slash = str.rfind('/');
+  if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+    dot = str.length();
+  }
+  return str.insert(dot, std::to_string(m_instanceId));
+}
+
+// ==================
+// = runAcyclicJobs =
+// ==================
+template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > void AcEcMaster<SlaveInstanceMapperPolicy, EcLinkLayerPolicy>::runAcyclicJobs() {
+
+  EC_T_DWORD res;
+  uint64_t start = busStatsNowNs();
+
+  // administrative stuff
+  res = emExecJob(m_instanceId, eUsrJob_MasterTimer, EC_NULL);
+  if (res != EC_E_NOERROR && res != EC_E_INVALIDSTATE) {
+    LOG_EC_ERROR("Error during MasterTimer!", res);
+  }
+
+  trace_evt("ecjt-timerdone",4,__LINE__);
+  uint64_t timerDone = busStatsNowNs();
+  m_stats.setPhase(BUSSTATS_PHASE_MASTER_TIMER, (uint32_t) ((timerDone - start) / 1000));
+  m_tracer.complete(busStatsPhaseName(BUSSTATS_PHASE_MASTER_TIMER), start, timerDone, m_cycleCounter);
+
+  // Log DCM data 
+  if (m_logDCStatus) {
+
+    DcmLogRecord rec;
+    EC_T_DWORD dwStatus = 0;
+    EC_T_INT   nDiffCur = 0, nDiffAvg = 0, nDiffMax = 0;
+
+    if (emDcmGetStatus(m_instanceId, &dwStatus, &nDiffCur, &nDiffAvg, &nDiffMax) == EC_E_NOERROR) {
+      rec.cycle = m_cycleCounter;
+      rec.busTime = m_busTime.getValue();
+      rec.ctlErrorCur = nDiffCur;
+      rec.ctlErrorAvg = nDiffAvg;
+      rec.ctlErrorMax = nDiffMax;
+      rec.ctlSetVal = m_dcmCtlSetVal;
+      rec.status = dwStatus;
+      rec.inSync = (dwStatus == EC_E_NOERROR);
+      memset(rec.reserved, 0, sizeof(rec.reserved));
+      m_dcmLog.push(rec);
+    }
+  }
+
+  // send acyclic frames
+  res = emExecJob(m_instanceId, eUsrJob_SendAcycFrames, EC_NULL);
+  if (res != EC_E_NOERROR && res != EC_E_INVALIDSTATE && res != EC_E_LINK_DISCONNECTED) {
+    LOG_EC_ERROR("Error during SendAcycFrames", res);
+  }
+
+  trace_evt("ecjt-acycldone",4,__LINE__);
+  uint64_t end = busStatsNowNs();
+  m_stats.setPhase(BUSSTATS_PHASE_SEND_ACYC, (uint32_t) ((end - timerDone) / 1000));
+  m_tracer.complete(busStatsPhaseName(BUSSTATS_PHASE_SEND_ACYC), timerDone, end, m_cycleCounter);
+}
+
+// ====================
+// = runCompanionTask =
+// ====================
+template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > void AcEcMaster<SlaveInstanceMapperPolicy, EcLinkLayerPolicy>::runCompanionTask() {
+
+  setThreadName("eccompanion");
+  setupThread(m_topology.companion, "companion thread");
+
+  m_companionThreadRunning = true;
+
+  while (!m_companionThreadShutdown) {
+
+    OsWaitForEvent(m_companionEvent, EC_WAITINFINITE);
+    if (m_companionThreadShutdown) {
+      break;
+    }
+
+    uint64_t start = busStatsNowNs();
+    runAcyclicJobs();
+    uint64_t end = busStatsNowNs();
+
+    m_stats.setPhase(BUSSTATS_PHASE_COMPANION, (uint32_t) ((end - start) / 1000));
+    m_tracer.complete(busStatsPhaseName(BUSSTATS_PHASE_COMPANION), start, end, m_cycleCounter);
+
+    m_companionBusy.store(false, std::memory_order_release);
+  }
+
+  // a run requested before the shutdown is dropped, the job task takes over
+  m_companionBusy.store(false, std::memory_order_release);
+
+  m_companionThreadRunning = false;
+}
+
 // =================
 // = runTimingTask =
 // =================
 template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > void AcEcMaster<SlaveInstanceMapperPolicy, EcLinkLayerPolicy>::runTimingTask() {
   
-  pthread_setname_np(pthread_self(),"ectimingtask");
+  setThreadName("ectimingtask");
   
   // Set thread affinity
   // This assures the QNX high resolution timer (CPU stamp)
   // doesn't jump because of cpu hopping. Furthermore, execution should be better-timed.
-   EC_T_CPUSET cpuSet;
-  EC_T_BOOL boolRes;
-  EC_CPUSET_ZERO(cpuSet);
-  EC_CPUSET_SET(cpuSet, HWL_EC_TIMING_THREAD_CPU);
-  boolRes = OsSetThreadAffinity(EC_NULL, cpuSet);
-  if (!boolRes) {
-    perrMaster("Error setting thread affinity in timing task, invalid CPU index!\n");
-  }
+  setupThread(m_topology.timing, "timing task");
   
   // init setClockPeriod to change the tick length of the
-  // scheduler
+  // scheduler (process-wide, the same for all instances)
   struct _clockperiod oClockPeriod = {0};
-  oClockPeriod.nsec = m_busCycleTimeUs * 1000;
+  oClockPeriod.nsec = m_busCycleTimeUs / m_ticksPerCycle * 1000;
   if(ClockPeriod(CLOCK_REALTIME, &oClockPeriod, EC_NULL, 0) == -1) {
       perrMaster("tEcTimingTask:: Cannot set the clock period! Error %i\n", errno);
       return;
@@ -947,7 +1718,9 @@ template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > void AcEcMas
   while (!m_timingThreadShutdown) {
     
     /* wait for next cycle - wait time defined by ClockPeriod */
-    OsSleep(1);
+    for (unsigned int i = 0; i < m_ticksPerCycle; i++) {
+      OsSleep(1);
+    }
     
     // Trigger the job task thread
     OsSetEvent(m_timingEvent);
@@ -958,6 +1731,175 @@ template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > void AcEcMas
   
 }
 
+// ====================
+// = requestPdoLayout =
+// ====================
+template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > bool AcEcMaster<SlaveInstanceMapperPolicy, EcLinkLayerPolicy>::requestPdoLayout() {
+
+  if (m_pdoLayout.load(std::memory_order_acquire) != NULL) {
+    return false;
+  }
+
+  // static blocks would overwrite outputs of the dynamic path
+  for (StaticPdoExchange* block : m_staticPdo) {
+    for (BusVarType* var : m_variablesOutputPDO) {
+      if (block->writesOutput((uint32_t) var->m_offset, var->getSize())) {
+        perrMaster("Output at bit offset %d is linked to a bus variable and written by a static PDO block\n", var->m_offset);
+      }
+    }
+  }
+
+  // the job task must not copy the variables while they are moved
+  if (m_jobThreadRunning) {
+    m_jobPauseRequest.store(true, std::memory_order_release);
+
+    if (OsWaitForEvent(m_jobPausedEvent, 2000) != EC_E_NOERROR) {
+
+      // withdraw the request, unless the job task has just taken it
+      if (m_jobPauseRequest.exchange(false, std::memory_order_acq_rel)) {
+        perrMaster("Job task did not pause for the PDO layout, is it running?\n");
+        return true;
+      }
+      OsWaitForEvent(m_jobPausedEvent, EC_WAITINFINITE);
+    }
+
+    buildPdoLayout();
+    OsSetEvent(m_jobResumeEvent);
+
+  } else {
+    buildPdoLayout();
+  }
+
+  return false;
+}
+
+// ==================
+// = buildPdoLayout =
+// ==================
+template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > void AcEcMaster<SlaveInstanceMapperPolicy, EcLinkLayerPolicy>::buildPdoLayout() {
+
+  // process image order
+  std::vector<BusVarType*> inputs(m_variablesInputPDO);
+  std::vector<BusVarType*> outputs(m_variablesOutputPDO);
+  auto byOffset = [](const BusVarType* a, const BusVarType* b) { return a->m_offset < b->m_offset; };
+  std::sort(inputs.begin(), inputs.end(), byOffset);
+  std::sort(outputs.begin(), outputs.end(), byOffset);
+
+  if (m_arena.build(inputs, outputs)) {
+    pwrnMaster("Can not allocate the bus variable arena, variables stay in place\n");
+  }
+
+  // the slots are final now (relocated or in place)
+  PdoLayout* layout = new PdoLayout();
+  for (BusVarType* var : inputs) {
+    if (!var->isGrouped()) {
+      layout->inputs.push_back({var, var->getPointer(), (uint32_t) var->m_offset, var->getSize(), getPdoCopyKind(var)});
+    }
+  }
+  for (BusVarType* var : outputs) {
+    if (!var->isGrouped()) {
+      layout->outputs.push_back({var, var->getPointer(), (uint32_t) var->m_offset, var->getSize(), getPdoCopyKind(var)});
+    }
+  }
+
+  // never replaced, the job task may keep its pointer
+  m_pdoLayoutStorage.reset(layout);
+  m_pdoLayout.store(layout, std::memory_order_release);
+}
+
+// ==================
+// = getPdoCopyKind =
+// ==================
+template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > typename AcEcMaster<SlaveInstanceMapperPolicy, EcLinkLayerPolicy>::PdoCopyKind AcEcMaster<SlaveInstanceMapperPolicy, EcLinkLayerPolicy>::getPdoCopyKind(BusVarType* const var) {
+
+  static_assert(sizeof(std::atomic<uint8_t>) == 1 && sizeof(std::atomic<uint16_t>) == 2 &&
+                sizeof(std::atomic<uint32_t>) == 4 && sizeof(std::atomic<uint64_t>) == 8,
+                "Lock-free slots are accessed as unsigned integers of the same size");
+
+  if (!var->isLockFree()) {
+    return PDO_COPY_LOCKED;
+  }
+
+  if (*var->getTypeId() == typeid(bool)) {
+    return PDO_COPY_BOOL;
+  }
+
+  // the slot holds std::atomic<T>, its bits are copied as unsigned integer
+  switch (var->getStorageSize()) {
+    case 1: return PDO_COPY_8;
+    case 2: return PDO_COPY_16;
+    case 4: return PDO_COPY_32;
+    case 8: return PDO_COPY_64;
+  }
+
+  return PDO_COPY_LOCKED;
+}
+
+// ================
+// = copyInputVar =
+// ================
+template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > void AcEcMaster<SlaveInstanceMapperPolicy, EcLinkLayerPolicy>::copyInputVar(BusVarType* const var) {
+
+  // lock-free scalar (BusVarAtomic): one atomic store, no mutex
+  if (var->isLockFree()) {
+    uint64_t tmp = 0;
+    EC_GETBITS(emGetProcessImageInputPtr(m_instanceId), (EC_T_BYTE*) &tmp, var->m_offset, var->getSize());
+    var->storeLockFree(&tmp);
+    return;
+  }
+
+  // try to lock the data area
+  if (var->getMutex().try_lock_for(std::chrono::microseconds(m_busCycleTimeUs/HWL_EC_TRY_LOCK_TIMEOUT_SCALE))) {
+
+    if (isOfBusType(var, DEFTYPE_BOOLEAN)) {
+      // special handling for boolean type
+      EC_T_BYTE tmp = 0;
+      bool* tmpPtr;
+      EC_GETBITS(emGetProcessImageInputPtr(m_instanceId), &tmp, var->m_offset, 1);
+      tmpPtr = (bool*)var->getPointer();
+
+      if (tmp) {
+        *tmpPtr = true;
+      } else {
+        *tmpPtr = false;
+      }
+
+    } else {
+
+      // copy input data to the memory area of the bus var
+      EC_GETBITS(emGetProcessImageInputPtr(m_instanceId), (EC_T_BYTE*) var->getPointer(), var->m_offset, var->getSize());
+
+    }
+
+    // unlock mutex
+    var->getMutex().unlock();
+  }
+}
+
+// =================
+// = copyOutputVar =
+// =================
+template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > void AcEcMaster<SlaveInstanceMapperPolicy, EcLinkLayerPolicy>::copyOutputVar(BusVarType* const var) {
+
+  // lock-free scalar (BusVarAtomic): one atomic load, no mutex
+  if (var->isLockFree()) {
+    uint64_t tmp = 0;
+    var->loadLockFree(&tmp);
+    EC_SETBITS(emGetProcessImageOutputPtr(m_instanceId), (EC_T_BYTE*) &tmp, var->m_offset, var->getSize());
+    return;
+  }
+
+  // try to lock the data area
+  if (var->getMutex().try_lock_for(std::chrono::microseconds(m_busCycleTimeUs/HWL_EC_TRY_LOCK_TIMEOUT_SCALE))) {
+
+    // copy the memory area
+    EC_SETBITS(emGetProcessImageOutputPtr(m_instanceId), (EC_T_BYTE*) var->getPointer(), var->m_offset, var->getSize());
+
+    // unlock mutex
+    var->getMutex().unlock();
+  }
+}
+
 // ==============
 // = runJobTask =
 // ==============
@@ -966,8 +1908,19 @@ template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > void AcEcMas
   EC_T_DWORD  res;
   EC_T_BOOL   lastFrameOK = EC_FALSE;
   EC_T_INT    overloadCounter = 0;
-
-  pthread_setname_np(pthread_self(),"ecjobtask");
+  uint64_t    lostFrames = 0;
+
+  // phase timing for the statistics page and the timeline
+  uint64_t    tCycle = 0, tPhase = 0;
+  auto phaseDone = [&](BusStatsPhase phase) {
+    uint64_t now = busStatsNowNs();
+    m_stats.setPhase(phase, (uint32_t) ((now - tPhase) / 1000));
+    m_tracer.complete(busStatsPhaseName(phase), tPhase, now, m_cycleCounter);
+    tPhase = now;
+  };
+
+  setThreadName("ecjobtask");
+  setupThread(m_topology.job, "job task");
   
   // thread started
   m_jobThreadRunning = true;
@@ -979,31 +1932,62 @@ template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > void AcEcMas
     // Synchronize with the timing thread
     OsWaitForEvent(m_timingEvent, EC_WAITINFINITE);
 
+    // the PDO layout is built in the thread requesting the first state, wait between two cycles
+    if (m_jobPauseRequest.exchange(false, std::memory_order_acq_rel)) {
+      OsSetEvent(m_jobPausedEvent);
+      OsWaitForEvent(m_jobResumeEvent, EC_WAITINFINITE);
+    }
+
     trace_evt("ecjt-timing",4,__LINE__);
+    tCycle = tPhase = busStatsNowNs();
 
     // Synchronize external thread calls to waitForBus()
     OsSetEvent(m_newTXDataEvent);
 
     // process all receive frames
-    res = ecatExecJob ( eUsrJob_ProcessAllRxFrames, &lastFrameOK);
+    res = emExecJob(m_instanceId, eUsrJob_ProcessAllRxFrames, &lastFrameOK);
     if (res != EC_E_NOERROR && res != EC_E_INVALIDSTATE && res != EC_E_LINK_DISCONNECTED) {
       LOG_EC_ERROR("Error during ProcessAllRxFrames!", res);
     }
     
     trace_evt("ecjt-procrx",4,__LINE__);
+    phaseDone(BUSSTATS_PHASE_RX);
+
+    // stamp of this input exchange, the bus time is read from the process image
+    // directly, m_busTime itself may be copied in another lock window
+    BusTimestamp inputStamp;
+    inputStamp.cycle = m_cycleCounter;
+    inputStamp.monotonicNs = tPhase;
+    inputStamp.busTimeNs = 0;
+    const EC_T_BYTE* busTimeImage = (m_enableDC && m_busTimeLinked.load(std::memory_order_acquire)) ?
+                                    emGetProcessImageInputPtr(m_instanceId) : NULL;
+
+    // bus time unavailable (not configured yet or no DC slave): the stamp keeps 0
+    if (busTimeImage != NULL) {
+      uint32_t busTime = 0;
+      EC_GETBITS(busTimeImage, (EC_T_BYTE*) &busTime, m_busTime.m_offset, m_busTime.getSize());
+
+      // the upper 32 bit from the stack, once
+      if (!m_busTimeExtender.isSeeded() && !m_busTimeSeedFailed) {
+        EC_T_UINT64 busTime64 = 0;
+        if (emGetBusTime(m_instanceId, &busTime64) == EC_E_NOERROR) {
+          m_busTimeExtender.seed(busTime64);
+        } else {
+          m_busTimeSeedFailed = true;
+          pwrnMaster("Cannot read the 64 bit bus time, input stamps start at the first 32 bit value\n");
+        }
+      }
+      inputStamp.busTimeNs = m_busTimeExtender.update(busTime);
+    }
 
     // overload check
     if (EC_E_NOERROR == res) {
       
       if (!lastFrameOK) {
         
+        lostFrames++;
         overloadCounter += 10;
-        m_overloadLogRateLimiter.count();
-
-        if (m_overloadLogRateLimiter.onLimit()) {
-          pwrnMaster("Reached maximum number of messages for system overload. Reducing report rate...\n");
-        }
-        if (m_overloadLogRateLimiter.log()) {
+        if (m_logLimiter.allow(HWL_EC_LOG_CODE_OVERLOAD, KEYED_LOG_NO_SLAVE, "system overload")) {
           pwrnMaster( "Warning: System overload: Cycle time too short or huge jitter!\n");
           trace_evt("ecjt-jitter",10,__LINE__);
         }
@@ -1018,50 +2002,112 @@ template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > void AcEcMas
         // Decrement overload counter in case the last frame was received successfully
         if (overloadCounter > 0) {
           overloadCounter--;
-      
-          m_overloadLogRateLimiter.reset();
         }
       }
     }
     
     
+    // copy lists, published once all variables are linked (see requestPdoLayout())
+    const PdoLayout* layout = m_pdoLayout.load(std::memory_order_acquire);
+
     // Copy PDO input data to Input-Type Bus Vars
 
     // iterate over all linked variables
     // try to lock their mutex and copy the data 
     // if the mutex has been acquired
-    for (std::vector<BusVarType*>::iterator it = m_variablesInputPDO.begin() ; it != m_variablesInputPDO.end(); ++it) {
-  
-      // try to lock the data area
-      if ((*it)->getMutex().try_lock_for(std::chrono::microseconds(m_busCycleTimeUs/HWL_EC_TRY_LOCK_TIMEOUT_SCALE))) {
-  
-        if (isOfBusType((*it), DEFTYPE_BOOLEAN)) {
-          // special handling for boolean type
-          EC_T_BYTE tmp = 0;
-          bool* tmpPtr;
-          EC_GETBITS(ecatGetProcessImageInputPtr(), &tmp, (*it)->m_offset, 1);
-          tmpPtr = (bool*)(*it)->getPointer();
-  
-          if (tmp) {
-            *tmpPtr = true;
-          } else {
-            *tmpPtr = false;
+    if (layout != NULL) {
+
+      // packed copy list, the lock-free values are contiguous in the arena
+      const EC_T_BYTE* inputImage = emGetProcessImageInputPtr(m_instanceId);
+      for (const PdoCopyEntry& e : layout->inputs) {
+        switch (e.kind) {
+          case PDO_COPY_BOOL: {
+            uint8_t tmp = 0;
+            EC_GETBITS(inputImage, &tmp, e.bitOffset, e.bitSize);
+            static_cast<std::atomic<bool>*>(e.slot)->store(tmp != 0, std::memory_order_release);
+            break;
           }
-  
-        } else {
-  
-          // copy input data to the memory area of the bus var
-          EC_GETBITS(ecatGetProcessImageInputPtr(), (EC_T_BYTE*) (*it)->getPointer(), (*it)->m_offset, (*it)->getSize());
-    
+          case PDO_COPY_8:  copyInputSlot<uint8_t>(inputImage, e);  break;
+          case PDO_COPY_16: copyInputSlot<uint16_t>(inputImage, e); break;
+          case PDO_COPY_32: copyInputSlot<uint32_t>(inputImage, e); break;
+          case PDO_COPY_64: copyInputSlot<uint64_t>(inputImage, e); break;
+          default:          copyInputVar(e.var);                    break;
+        }
+      }
+
+    } else {
+
+      for (std::vector<BusVarType*>::iterator it = m_variablesInputPDO.begin() ; it != m_variablesInputPDO.end(); ++it) {
+
+        // exchanged with its group below
+        if ((*it)->isGrouped()) {
+          continue;
         }
 
-        // unlock mutex
+        copyInputVar(*it);
+      }
+    }
+
+    // Copy PDO input data to the variable groups, all members or none
+    for (std::vector<BusVarGroup*>::iterator it = m_groups.begin() ; it != m_groups.end(); ++it) {
+      if ((*it)->getMutex().try_lock_for(std::chrono::microseconds(m_busCycleTimeUs/HWL_EC_TRY_LOCK_TIMEOUT_SCALE))) {
+        for (BusVarType* var : (*it)->getInputs()) {
+          copyInputVar(var);
+        }
+        (*it)->setInputStamp(inputStamp);
+        (*it)->getMutex().unlock();
+      }
+    }
+
+    // Copy PDO input data to the static PDO blocks
+    for (std::vector<StaticPdoExchange*>::iterator it = m_staticPdo.begin() ; it != m_staticPdo.end(); ++it) {
+      if ((*it)->getMutex().try_lock_for(std::chrono::microseconds(m_busCycleTimeUs/HWL_EC_TRY_LOCK_TIMEOUT_SCALE))) {
+        (*it)->exchangeInputs((const uint8_t*) emGetProcessImageInputPtr(m_instanceId));
         (*it)->getMutex().unlock();
       }
-  
     }
     
+    // all inputs of this cycle are in place
+    m_inputStamp.store(inputStamp);
+
     trace_evt("ecjt-busvarsrx",4,__LINE__);
+    phaseDone(BUSSTATS_PHASE_INPUTS);
+
+    // Cycle callbacks, with the inputs of this cycle
+    if (!m_cycleCallbacks.empty()) {
+
+      CycleContext ctx;
+      ctx.cycle = m_cycleCounter;
+      ctx.stamp = inputStamp;
+      ctx.inputsValid = (lastFrameOK == EC_TRUE);
+      ctx.inputImage = (const uint8_t*) emGetProcessImageInputPtr(m_instanceId);
+      ctx.outputImage = (uint8_t*) emGetProcessImageOutputPtr(m_instanceId);
+
+      for (size_t idx = 0; idx < m_cycleCallbacks.size(); idx++) {
+
+        CycleCallbackEntry& cb = m_cycleCallbacks[idx];
+        uint64_t start = busStatsNowNs();
+        cb.fn(cb.userData, ctx);
+        uint64_t end = busStatsNowNs();
+
+        uint32_t us = (uint32_t) ((end - start) / 1000);
+        cb.lastUs.store(us, std::memory_order_relaxed);
+        if (us > cb.maxUs.load(std::memory_order_relaxed)) {
+          cb.maxUs.store(us, std::memory_order_relaxed);
+        }
+        m_tracer.complete(cb.name, start, end, m_cycleCounter);
+
+        if (us > cb.budgetUs) {
+          cb.overruns.fetch_add(1, std::memory_order_relaxed);
+          // one limit per callback, keyed by its index
+          if (m_logLimiter.allow(HWL_EC_LOG_CODE_CALLBACK_BUDGET, (uint32_t) idx, cb.name)) {
+            pwrnMaster("Cycle callback %s took %u us, budget %u us\n", cb.name, us, cb.budgetUs);
+          }
+        }
+      }
+    }
+
+    phaseDone(BUSSTATS_PHASE_CALLBACK);
 
     // Readout the data from all clients and update the process data map
     //
@@ -1069,21 +2115,58 @@ template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > void AcEcMas
     // iterate over all linked variables
     // try to lock their mutex and copy the data 
     // if the mutex has been acquired
-    for (std::vector<BusVarType*>::iterator it = m_variablesOutputPDO.begin() ; it != m_variablesOutputPDO.end(); ++it) {
-  
-      // try to lock the data area
+    if (layout != NULL) {
+
+      EC_T_BYTE* outputImage = emGetProcessImageOutputPtr(m_instanceId);
+      for (const PdoCopyEntry& e : layout->outputs) {
+        switch (e.kind) {
+          case PDO_COPY_BOOL: {
+            uint8_t tmp = static_cast<const std::atomic<bool>*>(e.slot)->load(std::memory_order_acquire) ? 1 : 0;
+            EC_SETBITS(outputImage, &tmp, e.bitOffset, e.bitSize);
+            break;
+          }
+          case PDO_COPY_8:  copyOutputSlot<uint8_t>(outputImage, e);  break;
+          case PDO_COPY_16: copyOutputSlot<uint16_t>(outputImage, e); break;
+          case PDO_COPY_32: copyOutputSlot<uint32_t>(outputImage, e); break;
+          case PDO_COPY_64: copyOutputSlot<uint64_t>(outputImage, e); break;
+          default:          copyOutputVar(e.var);                     break;
+        }
+      }
+
+    } else {
+
+      for (std::vector<BusVarType*>::iterator it = m_variablesOutputPDO.begin() ; it != m_variablesOutputPDO.end(); ++it) {
+
+        // exchanged with its group below
+        if ((*it)->isGrouped()) {
+          continue;
+        }
+
+        copyOutputVar(*it);
+      }
+    }
+
+    // Copy the outputs of the variable groups. If the group is locked by the
+    // application, the process image keeps the outputs of the previous cycle
+    for (std::vector<BusVarGroup*>::iterator it = m_groups.begin() ; it != m_groups.end(); ++it) {
       if ((*it)->getMutex().try_lock_for(std::chrono::microseconds(m_busCycleTimeUs/HWL_EC_TRY_LOCK_TIMEOUT_SCALE))) {
-  
-        // copy the memory area
-        EC_SETBITS(ecatGetProcessImageOutputPtr(), (EC_T_BYTE*) (*it)->getPointer(), (*it)->m_offset, (*it)->getSize());
-      
-        // unlock mutex
+        for (BusVarType* var : (*it)->getOutputs()) {
+          copyOutputVar(var);
+        }
+        (*it)->getMutex().unlock();
+      }
+    }
+
+    // Copy the outputs of the static PDO blocks
+    for (std::vector<StaticPdoExchange*>::iterator it = m_staticPdo.begin() ; it != m_staticPdo.end(); ++it) {
+      if ((*it)->getMutex().try_lock_for(std::chrono::microseconds(m_busCycleTimeUs/HWL_EC_TRY_LOCK_TIMEOUT_SCALE))) {
+        (*it)->exchangeOutputs((uint8_t*) emGetProcessImageOutputPtr(m_instanceId));
         (*it)->getMutex().unlock();
       }
-  
     }
 
     trace_evt("ecjt-busvarstx",4,__LINE__);
+    phaseDone(BUSSTATS_PHASE_OUTPUTS);
 
     
     // Synchronize external thread calls to waitForBusRXData()
@@ -1094,47 +2177,43 @@ template<class SlaveInstanceMapperPolicy, class EcLinkLayerPolicy > void AcEcMas
    
   
     // send all cyclic frames
-    res = ecatExecJob(eUsrJob_SendAllCycFrames, EC_NULL);
+    res = emExecJob(m_instanceId, eUsrJob_SendAllCycFrames, EC_NULL);
     if (res != EC_E_NOERROR && res != EC_E_INVALIDSTATE && res != EC_E_LINK_DISCONNECTED) {
       LOG_EC_ERROR("Error during SendAllCycFrames!", res);
     }
 
     trace_evt("ecjt-cyclframessent",4,__LINE__);
+    phaseDone(BUSSTATS_PHASE_SEND_CYC);
 
-    // administrative stuff
-    res = ecatExecJob(eUsrJob_MasterTimer, EC_NULL);
-    if (res != EC_E_NOERROR && res != EC_E_INVALIDSTATE) {
-      LOG_EC_ERROR("Error during MasterTimer!", res);
-    }
+    // administrative stuff and acyclic frames
+    uint32_t companionDivisor = m_companionDivisor.load(std::memory_order_acquire);
+    if (companionDivisor == 0) {
 
-    trace_evt("ecjt-timerdone",4,__LINE__);
+      // not while a last run of a stopped companion thread is in progress
+      if (!m_companionBusy.load(std::memory_order_acquire)) {
+        runAcyclicJobs();
+      }
+      tPhase = busStatsNowNs();
 
-    // Log DCM data 
-    if (m_logDCStatus) {
-      //perr("before log dc status\n");
- 
-      char *logStr=0x0;
-      ecatDcmGetLog(&logStr);
+    } else if (m_cycleCounter % companionDivisor == 0) {
 
-      if (logStr != 0x0)
-        {
-          strncpy(m_logStr.buf,logStr,XSTDIO_LINE_SZ);
-          //pdbg(" DCMLog: %s\n", m_logStr.buf[0]);
-          m_logbuf.push(m_logStr);
+      // the companion thread has not finished the previous run
+      if (m_companionBusy.exchange(true, std::memory_order_acq_rel)) {
+        m_companionSkipped.fetch_add(1, std::memory_order_relaxed);
+        if (m_logLimiter.allow(HWL_EC_LOG_CODE_COMPANION_BUSY, KEYED_LOG_NO_SLAVE, "companion busy")) {
+          pwrnMaster("Companion thread busy, master timer and acyclic frames delayed\n");
         }
-
+      } else {
+        OsSetEvent(m_companionEvent);
+      }
     }
 
-    // send acyclic frames
-    res = ecatExecJob(eUsrJob_SendAcycFrames, EC_NULL);
-    if (res != EC_E_NOERROR && res != EC_E_INVALIDSTATE && res != EC_E_LINK_DISCONNECTED) {
-      LOG_EC_ERROR("Error during SendAcycFrames", res);
-    }
-  
-    trace_evt("ecjt-acycldone",4,__LINE__);
+    // publish the statistics of this cycle
+    m_stats.setPhase(BUSSTATS_PHASE_TOTAL, (uint32_t) ((tPhase - tCycle) / 1000));
+    m_stats.publish(m_cycleCounter, (uint32_t) m_curState, m_fault, (uint32_t) overloadCounter, lostFrames);
 
 #ifdef HWL_EC_DC_PRINT_STATUS
-    ecatDcmShowStatus();
+    emDcmShowStatus(m_instanceId);
 #endif
 
   }
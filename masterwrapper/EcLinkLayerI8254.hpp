@@ -10,7 +10,7 @@
 #ifndef ECLINKLAYERI8254_HPP_74676772
 #define ECLINKLAYERI8254_HPP_74676772
 
-#define HWL_EC_ETHERNET_CONTROLLER_ID   2     // network port
+#define HWL_EC_ETHERNET_CONTROLLER_ID   2     // default network port
 
 #include<EcLink.h>
 
@@ -50,13 +50,24 @@ namespace ec {
     
     }
   
+    /*! Select the network port (instance of the I8254x driver), has to be
+        set before the master is initialized. Each master instance needs its own port. */
+    void setControllerId(EC_T_DWORD controllerId) {
+      m_controllerId = controllerId;
+    }
+
+    /*! Returns the network port */
+    EC_T_DWORD getControllerId() const {
+      return m_controllerId;
+    }
+
     /*! Create and return LinkLayer Parameters for I8254X */
     EC_T_LINK_PARMS* getLinkParams() {
 
       m_paramsAdapter->linkParms.dwSignature = EC_LINK_PARMS_SIGNATURE_I8254X;
       m_paramsAdapter->linkParms.dwSize = sizeof(EC_T_LINK_PARMS_I8254X);
       OsStrncpy(m_paramsAdapter->linkParms.szDriverIdent, EC_LINK_PARMS_IDENT_I8254X, MAX_DRIVER_IDENT_LEN-1);
-      m_paramsAdapter->linkParms.dwInstance = HWL_EC_ETHERNET_CONTROLLER_ID;
+      m_paramsAdapter->linkParms.dwInstance = m_controllerId;
       m_paramsAdapter->linkParms.eLinkMode = EcLinkMode_POLLING;
       m_paramsAdapter->linkParms.dwIstPriority = PRIO_HWIO();
 
@@ -66,6 +77,9 @@ namespace ec {
   private:
   
     EC_T_LINK_PARMS_I8254X*   m_paramsAdapter;
+
+    //! network port
+    EC_T_DWORD                m_controllerId = HWL_EC_ETHERNET_CONTROLLER_ID;
   
   };
 
@@ -0,0 +1,531 @@
+//
+//  test_jitter.cpp
+//  am2b
+//
+//  Cycle jitter characterisation for deployment hosts.
+//
+//  Runs the timing task / job task thread structure of the AcEcMaster
+//  (same priorities and cpu affinities, see iface_ec_sched.hpp) against a
+//  simulated backend, optionally under synthetic CPU and memory load.
+//  Reports wake-up latency and cycle overrun histograms per cycle time.
+//  With --instances, several simulated masters (one per EtherCAT segment)
+//  run concurrently, each with its own threads, timing cpu and variables.
+//
+//  Copyright 2015 Chair of Applied Mechanics, TUM
+//  https://www.amm.mw.tum.de/
+//
+
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <mutex>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <cmath>
+
+#include <pthread.h>
+#include <semaphore.h>
+#include <sched.h>
+#include <time.h>
+#include <sys/mman.h>
+
+#include <iface_ec_sched.hpp>
+#include <xstdio.h>
+#include <progopt.hpp>
+
+//! Number of histogram bins (1us resolution), larger values go to the overflow bin
+#define JITTER_HIST_BINS 1000
+
+//! Stack size for the load threads
+#define JITTER_LOAD_STACKSIZE 0x10000
+
+using namespace std;
+using namespace am2b;
+
+// SIG handler
+// (ensure clean shutdown in SIG)
+volatile bool hwl_ec_abort = false;
+void handle_sigint(int) {
+  hwl_ec_abort = true;
+}
+
+//! Returns the monotonic time in nanoseconds
+static inline uint64_t nowNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/*! Simple latency histogram with 1us resolution */
+class JitterHistogram {
+
+public:
+
+  //! Reset all bins
+  void reset() {
+    memset(m_bins, 0, sizeof(m_bins));
+    m_count = 0;
+    m_sumNs = 0;
+    m_maxNs = 0;
+    m_minNs = UINT64_MAX;
+  }
+
+  //! add a sample (nanoseconds)
+  void add(uint64_t ns) {
+    uint64_t us = ns / 1000;
+    if (us >= JITTER_HIST_BINS) {
+      us = JITTER_HIST_BINS;
+    }
+    m_bins[us]++;
+    m_count++;
+    m_sumNs += ns;
+    if (ns > m_maxNs) m_maxNs = ns;
+    if (ns < m_minNs) m_minNs = ns;
+  }
+
+  //! Returns the given percentile in microseconds
+  unsigned int percentile(double p) const {
+    uint64_t limit = (uint64_t) std::ceil(p * m_count);
+    uint64_t sum = 0;
+    for (unsigned int i = 0; i <= JITTER_HIST_BINS; i++) {
+      sum += m_bins[i];
+      if (sum >= limit) {
+        return i;
+      }
+    }
+    return JITTER_HIST_BINS;
+  }
+
+  //! Print summary and all non-empty bins
+  void print(const char* name) const {
+
+    if (m_count == 0) {
+      printf("  %s: no samples\n", name);
+      return;
+    }
+
+    printf("  %s: n=%llu min=%.1fus avg=%.1fus max=%.1fus p99=%uus p99.9=%uus p99.99=%uus\n", name,
+           (unsigned long long) m_count, m_minNs/1000.0, (double) m_sumNs/m_count/1000.0, m_maxNs/1000.0,
+           percentile(0.99), percentile(0.999), percentile(0.9999));
+
+    for (unsigned int i = 0; i < JITTER_HIST_BINS; i++) {
+      if (m_bins[i]) {
+        printf("    %4u us: %llu\n", i, (unsigned long long) m_bins[i]);
+      }
+    }
+    if (m_bins[JITTER_HIST_BINS]) {
+      printf("  >=%4u us: %llu\n", JITTER_HIST_BINS, (unsigned long long) m_bins[JITTER_HIST_BINS]);
+    }
+  }
+
+private:
+
+  uint64_t  m_bins[JITTER_HIST_BINS+1];
+  uint64_t  m_count = 0;
+  uint64_t  m_sumNs = 0;
+  uint64_t  m_maxNs = 0;
+  uint64_t  m_minNs = UINT64_MAX;
+
+};
+
+/*! Simulated PDO variable. Mirrors the per-var locking
+    and copy done by AcEcMaster::runJobTask() */
+struct SimBusVar {
+  std::timed_mutex  mutex;
+  int32_t           data = 0;
+  unsigned int      offset = 0;
+};
+
+/*! Simulated master with timing task and job task */
+class JitterSimMaster {
+
+public:
+
+  JitterSimMaster(unsigned int numVars, unsigned int instance = 0, int timingCpu = HWL_EC_TIMING_THREAD_CPU)
+    : m_vars(numVars), m_processImage(numVars*sizeof(int32_t)*2), m_instance(instance), m_timingCpu(timingCpu) {
+    for (unsigned int i = 0; i < numVars; i++) {
+      m_vars[i].offset = i*sizeof(int32_t);
+    }
+    sem_init(&m_timingEvent, 0, 0);
+  }
+
+  ~JitterSimMaster() {
+    sem_destroy(&m_timingEvent);
+  }
+
+  //! Run the measurement for the given cycle time and duration
+  void run(unsigned int cycleTimeUs, unsigned int durationS) {
+    if (start(cycleTimeUs, durationS)) {
+      join();
+    }
+  }
+
+  //! Start the measurement threads, returns false if an error occurs
+  bool start(unsigned int cycleTimeUs, unsigned int durationS) {
+
+    m_cycleTimeNs = cycleTimeUs*1000;
+    m_numCycles = (uint64_t) durationS*1000000/cycleTimeUs;
+    m_timingLatency.reset();
+    m_jobLatency.reset();
+    m_jobBusy.reset();
+    m_overruns = 0;
+    m_missedTicks = 0;
+    m_shutdown = false;
+    m_jobDone = false;
+    m_jobCycles = 0;
+    for (std::vector<SimBusVar>::iterator it = m_vars.begin(); it != m_vars.end(); ++it) {
+      it->data = 0;
+    }
+    memset(&m_processImage[0], 0, m_processImage.size());
+
+    if (!startThread(&m_job, &JitterSimMaster::jobTaskWrapper, HWL_EC_JOB_THREAD_PRIO, -1, HWL_EC_JOB_THREAD_STACKSIZE, this)) {
+      return false;
+    }
+    if (!startThread(&m_timing, &JitterSimMaster::timingTaskWrapper, HWL_EC_TIMING_THREAD_PRIO, m_timingCpu, HWL_EC_JOB_THREAD_STACKSIZE, this)) {
+      m_shutdown = true;
+      sem_post(&m_timingEvent);
+      pthread_join(m_job, NULL);
+      return false;
+    }
+    return true;
+  }
+
+  //! Wait for the end of a started measurement
+  void join() {
+    pthread_join(m_timing, NULL);
+    m_shutdown = true;
+    sem_post(&m_timingEvent);
+    pthread_join(m_job, NULL);
+  }
+
+  //! Print the results of the last run
+  void report(unsigned int cycleTimeUs) {
+    printf("Instance %u, cycle time %u us (timing cpu %d):\n", m_instance, cycleTimeUs, m_timingCpu);
+    m_timingLatency.print("timing task wake-up latency");
+    m_jobLatency.print("job task wake-up latency (from tick)");
+    m_jobBusy.print("job task busy time");
+    printf("  overruns (job task not done before next tick): %llu\n", (unsigned long long) m_overruns);
+    printf("  missed ticks (timing task late by more than one cycle): %llu\n", (unsigned long long) m_missedTicks);
+    printf("  variables consistent with %llu job cycles: %s\n", (unsigned long long) m_jobCycles, isConsistent() ? "yes" : "NO");
+    printf("  verdict: %s\n", passed() ? "PASS" : "FAIL");
+  }
+
+  //! True if the last run had no timing violations and consistent variables
+  bool passed() {
+    return m_overruns == 0 && m_missedTicks == 0 && isConsistent();
+  }
+
+  /*! True if every variable has been exchanged once per job cycle, i.e.
+      no other instance has touched the variables or the process image */
+  bool isConsistent() {
+    const uint8_t* outputs = &m_processImage[m_vars.size()*sizeof(int32_t)];
+    for (std::vector<SimBusVar>::iterator it = m_vars.begin(); it != m_vars.end(); ++it) {
+      int32_t out;
+      memcpy(&out, outputs + it->offset, sizeof(int32_t));
+      if ((uint64_t) it->data != m_jobCycles || out != it->data) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  //! Start a thread with SCHED_FIFO prio and (optional) cpu affinity
+  static bool startThread(pthread_t* thread, void* (*fnc)(void*), int prio, int cpu, size_t stackSize, void* arg) {
+
+    pthread_attr_t attr;
+    struct sched_param param;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, stackSize < (size_t) PTHREAD_STACK_MIN ? (size_t) PTHREAD_STACK_MIN : stackSize);
+
+    if (prio >= 0) {
+      pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+      pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+      param.sched_priority = prio;
+      pthread_attr_setschedparam(&attr, &param);
+    }
+
+#ifndef QNX
+    if (cpu >= 0) {
+      cpu_set_t cpuSet;
+      CPU_ZERO(&cpuSet);
+      CPU_SET(cpu, &cpuSet);
+      pthread_attr_setaffinity_np(&attr, sizeof(cpu_set_t), &cpuSet);
+    }
+#endif
+
+    int res = pthread_create(thread, &attr, fnc, arg);
+    pthread_attr_destroy(&attr);
+
+    if (res != EOK) {
+      perr("Could not create thread (prio %d, cpu %d): %s\n", prio, cpu, strerror(res));
+      return false;
+    }
+    return true;
+  }
+
+private:
+
+  static void* timingTaskWrapper(void* instance) {
+    static_cast<JitterSimMaster*>(instance)->runTimingTask();
+    return NULL;
+  }
+
+  static void* jobTaskWrapper(void* instance) {
+    static_cast<JitterSimMaster*>(instance)->runJobTask();
+    return NULL;
+  }
+
+  //! Thread name with the instance appended (as in AcEcMaster)
+  void setThreadName(const char* name) {
+    // names are limited to 15 characters
+    char buf[32];
+    if (m_instance == 0) {
+      snprintf(buf, sizeof(buf), "%s", name);
+    } else {
+      snprintf(buf, sizeof(buf), "%s%u", name, m_instance);
+    }
+    buf[15] = '\0';
+    pthread_setname_np(pthread_self(), buf);
+  }
+
+  /*! Timing task. Wakes up with absolute deadlines and triggers the job task */
+  void runTimingTask() {
+
+    setThreadName("ectimingtask");
+
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+
+    for (uint64_t cycle = 0; cycle < m_numCycles && !hwl_ec_abort; cycle++) {
+
+      next.tv_nsec += m_cycleTimeNs;
+      while (next.tv_nsec >= 1000000000) {
+        next.tv_nsec -= 1000000000;
+        next.tv_sec++;
+      }
+
+      clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+
+      uint64_t deadline = (uint64_t) next.tv_sec * 1000000000ULL + next.tv_nsec;
+      uint64_t now = nowNs();
+      uint64_t latency = now > deadline ? now - deadline : 0;
+      m_timingLatency.add(latency);
+
+      if (latency > m_cycleTimeNs) {
+        m_missedTicks++;
+      }
+
+      // job task still running from the last tick?
+      if (cycle > 0 && !m_jobDone) {
+        m_overruns++;
+      }
+
+      m_jobDone = false;
+      m_tick = deadline;
+
+      // Trigger the job task thread
+      sem_post(&m_timingEvent);
+    }
+  }
+
+  /*! Job task. Copies the simulated process image into the vars
+      and back, as done by the master */
+  void runJobTask() {
+
+    setThreadName("ecjobtask");
+
+    while (true) {
+
+      sem_wait(&m_timingEvent);
+      if (m_shutdown) {
+        break;
+      }
+
+      uint64_t start = nowNs();
+      uint64_t tick = m_tick;
+      m_jobLatency.add(start > tick ? start - tick : 0);
+
+      uint8_t* inputs = &m_processImage[0];
+      uint8_t* outputs = &m_processImage[m_vars.size()*sizeof(int32_t)];
+
+      // simulated bus: the slaves echo the outputs of the last cycle
+      memcpy(inputs, outputs, m_vars.size()*sizeof(int32_t));
+
+      // copy "inputs"
+      for (std::vector<SimBusVar>::iterator it = m_vars.begin(); it != m_vars.end(); ++it) {
+        if (it->mutex.try_lock_for(std::chrono::nanoseconds(m_cycleTimeNs/100))) {
+          memcpy(&it->data, inputs + it->offset, sizeof(int32_t));
+          it->mutex.unlock();
+        }
+      }
+
+      // copy "outputs"
+      for (std::vector<SimBusVar>::iterator it = m_vars.begin(); it != m_vars.end(); ++it) {
+        if (it->mutex.try_lock_for(std::chrono::nanoseconds(m_cycleTimeNs/100))) {
+          it->data++;
+          memcpy(outputs + it->offset, &it->data, sizeof(int32_t));
+          it->mutex.unlock();
+        }
+      }
+
+      m_jobCycles++;
+      m_jobBusy.add(nowNs() - start);
+      m_jobDone = true;
+    }
+  }
+
+  std::vector<SimBusVar>    m_vars;
+  std::vector<uint8_t>      m_processImage;
+  sem_t                     m_timingEvent;
+
+  const unsigned int        m_instance;
+  const int                 m_timingCpu;
+  pthread_t                 m_timing;
+  pthread_t                 m_job;
+
+  uint64_t                  m_cycleTimeNs = 0;
+  uint64_t                  m_numCycles = 0;
+  volatile uint64_t         m_tick = 0;
+  volatile bool             m_jobDone = false;
+  volatile bool             m_shutdown = false;
+
+  JitterHistogram           m_timingLatency;
+  JitterHistogram           m_jobLatency;
+  JitterHistogram           m_jobBusy;
+  uint64_t                  m_overruns = 0;
+  uint64_t                  m_missedTicks = 0;
+  uint64_t                  m_jobCycles = 0;
+
+};
+
+/* Synthetic load */
+volatile bool jitter_load_shutdown = false;
+size_t jitter_mem_load_size = 0;
+
+//! CPU load: spin on floating point math
+void* runCpuLoad(void*) {
+  volatile double x = 1.0;
+  while (!jitter_load_shutdown) {
+    for (int i = 0; i < 10000; i++) {
+      x = std::sqrt(x + i);
+    }
+  }
+  return NULL;
+}
+
+//! Memory load: copy a buffer larger than the caches
+void* runMemLoad(void*) {
+  std::vector<uint8_t> a(jitter_mem_load_size, 1), b(jitter_mem_load_size, 2);
+  while (!jitter_load_shutdown) {
+    memcpy(&a[0], &b[0], jitter_mem_load_size);
+    memcpy(&b[0], &a[0], jitter_mem_load_size);
+  }
+  return NULL;
+}
+
+// jitter characterisation for the ethercat master threads
+int main (int argc, char *argv[]) {
+
+  // Load whole program into memory for performance reasons
+  if(-1 == mlockall(MCL_CURRENT|MCL_FUTURE)) {
+    cout << "mlockall(): Error loading program into memory!" << endl;
+    return EXIT_FAILURE;
+  }
+
+  ProgOpt opt(argv[0], "cycle jitter characterisation for the ethercat master threads.",
+              argc,argv);
+  opt.add(' ',"cycles", false, "comma-separated cycle times in us", "1000,500,250");
+  opt.add(' ',"duration", false, "measurement duration per cycle time in s", "60");
+  opt.add(' ',"vars", false, "number of simulated PDO variables", "500");
+  opt.add(' ',"cpu-load", false, "number of cpu load threads", "0");
+  opt.add(' ',"mem-load", false, "number of memory load threads", "0");
+  opt.add(' ',"mem-size", false, "buffer size per memory load thread in MB", "64");
+  opt.add(' ',"instances", false, "number of concurrently running simulated masters", "1");
+  opt.add(' ',"timing-cpus", false, "comma-separated timing task cpu of each instance, -1: no affinity", "");
+  opt.std_parse();
+
+  string cycles           = opt.val<string>("cycles");
+  unsigned int duration   = opt.val<unsigned int>("duration");
+  unsigned int numVars    = opt.val<unsigned int>("vars");
+  unsigned int cpuLoad    = opt.val<unsigned int>("cpu-load");
+  unsigned int memLoad    = opt.val<unsigned int>("mem-load");
+  jitter_mem_load_size    = (size_t) opt.val<unsigned int>("mem-size") * 1024 * 1024;
+  unsigned int instances  = opt.val<unsigned int>("instances");
+  string timingCpus       = opt.val<string>("timing-cpus");
+
+  if (instances == 0) {
+    perr("At least one instance is required\n");
+    return EXIT_FAILURE;
+  }
+
+  // timing cpu of each instance, the default one for missing entries
+  std::vector<int> cpus(instances, HWL_EC_TIMING_THREAD_CPU);
+  std::stringstream cs(timingCpus);
+  std::string cpu;
+  for (unsigned int i = 0; i < instances && std::getline(cs, cpu, ','); i++) {
+    cpus[i] = (int) strtol(cpu.c_str(), NULL, 10);
+  }
+
+  // Init the signal handler
+  std::signal(SIGINT, handle_sigint);
+
+  // start the load threads (normal scheduling, no affinity)
+  std::vector<pthread_t> loadThreads;
+  for (unsigned int i = 0; i < cpuLoad + memLoad; i++) {
+    pthread_t t;
+    if (JitterSimMaster::startThread(&t, i < cpuLoad ? runCpuLoad : runMemLoad, -1, -1, JITTER_LOAD_STACKSIZE, NULL)) {
+      loadThreads.push_back(t);
+    }
+  }
+
+  pmsg("Timing thread: prio %d. Job thread: prio %d. Instances: %u. Load: %u cpu, %u mem threads\n",
+       HWL_EC_TIMING_THREAD_PRIO, HWL_EC_JOB_THREAD_PRIO, instances, cpuLoad, memLoad);
+
+  std::vector<JitterSimMaster*> masters;
+  for (unsigned int i = 0; i < instances; i++) {
+    masters.push_back(new JitterSimMaster(numVars, i, cpus[i]));
+  }
+  bool pass = true;
+
+  // run the measurement for all cycle times
+  std::stringstream ss(cycles);
+  std::string item;
+  while (std::getline(ss, item, ',') && !hwl_ec_abort) {
+
+    unsigned int cycleTimeUs = (unsigned int) strtoul(item.c_str(), NULL, 10);
+    if (cycleTimeUs == 0) {
+      perr("Invalid cycle time '%s'\n", item.c_str());
+      continue;
+    }
+
+    pmsg("Measuring %u us cycle time for %u s...\n", cycleTimeUs, duration);
+
+    // all instances run concurrently
+    std::vector<bool> started(instances, false);
+    for (unsigned int i = 0; i < instances; i++) {
+      started[i] = masters[i]->start(cycleTimeUs, duration);
+      pass = pass && started[i];
+    }
+    for (unsigned int i = 0; i < instances; i++) {
+      if (started[i]) {
+        masters[i]->join();
+        masters[i]->report(cycleTimeUs);
+        pass = pass && masters[i]->passed();
+      }
+    }
+  }
+
+  for (std::vector<JitterSimMaster*>::iterator it = masters.begin(); it != masters.end(); ++it) {
+    delete *it;
+  }
+
+  jitter_load_shutdown = true;
+  for (std::vector<pthread_t>::iterator it = loadThreads.begin(); it != loadThreads.end(); ++it) {
+    pthread_join(*it, NULL);
+  }
+
+  return pass ? 0 : EXIT_FAILURE;
+}
@@ -0,0 +1,138 @@
+//
+//  test_recovery.cpp
+//  am2b
+//
+//  Unit test of the recovery timeline (BusRecovery.hpp). Replays slave
+//  recoveries with fixed timestamps and checks the phase durations, the
+//  retry count and the total time of the resulting records.
+//
+//  Copyright 2015 Chair of Applied Mechanics, TUM
+//  https://www.amm.mw.tum.de/
+//
+
+#include <cstdio>
+#include <cstdlib>
+#include <stdint.h>
+
+#include "BusRecovery.hpp"
+
+using namespace ec;
+
+//! Timestamps in ms relative to the detection
+#define MS(x) ((uint64_t) ((x) * 1000000.0))
+
+//! Detection time of the replayed recoveries
+static const uint64_t T0 = 5000000000ULL;
+
+static int failures = 0;
+
+//! Count and report a failed check
+#define CHECK(cond) \
+  do { \
+    if (!(cond)) { \
+      printf("  FAIL line %d: %s\n", __LINE__, #cond); \
+      failures++; \
+    } \
+  } while (0)
+
+//! Slave recovery with a timeout in PREOP and one restart through INIT
+static void testRetry() {
+
+  printf("retry accumulates into the phases\n");
+
+  BusRecoveryTimeline t;
+  CHECK(!t.isActive());
+
+  t.start(1002, false, T0);
+  CHECK(t.isActive());
+  CHECK(t.getPhase() == BUS_RECOVERY_RECONNECT);
+  CHECK(t.getPhaseStartNs() == T0);
+
+  t.enter(BUS_RECOVERY_INIT, T0 + MS(2));
+  t.enter(BUS_RECOVERY_PREOP, T0 + MS(5));
+  CHECK(t.getPhaseMs(T0 + MS(1005)) == 1000);
+
+  // PREOP timed out, restart through INIT
+  t.retry();
+  t.enter(BUS_RECOVERY_INIT, T0 + MS(3005));
+  t.enter(BUS_RECOVERY_PREOP, T0 + MS(3009));
+  t.enter(BUS_RECOVERY_SAFEOP, T0 + MS(3015));
+  t.enter(BUS_RECOVERY_OP, T0 + MS(3025));
+  CHECK(t.getRecord().retries == 1);
+
+  const BusRecoveryRecord& r = t.finish(true, T0 + MS(3026));
+  CHECK(!t.isActive());
+  CHECK(r.success);
+  CHECK(!r.busWide);
+  CHECK(r.stationAddress == 1002);
+  CHECK(r.startNs == T0);
+  CHECK(r.retries == 1);
+  CHECK(r.phaseMs[BUS_RECOVERY_RECONNECT] == 2);
+  CHECK(r.phaseMs[BUS_RECOVERY_INIT] == 3 + 4);
+  CHECK(r.phaseMs[BUS_RECOVERY_PREOP] == 3000 + 6);
+  CHECK(r.phaseMs[BUS_RECOVERY_SAFEOP] == 10);
+  CHECK(r.phaseMs[BUS_RECOVERY_FAULT_RESET] == 0);
+  CHECK(r.phaseMs[BUS_RECOVERY_OP] == 1);
+  CHECK(r.totalMs == 3026);
+}
+
+//! Phases shorter than 1 ms are summed in ns, not truncated per visit
+static void testSubMs() {
+
+  printf("short phases are accumulated in ns\n");
+
+  BusRecoveryTimeline t;
+  t.start(0, true, T0);
+  t.enter(BUS_RECOVERY_SAFEOP, T0 + MS(0.6));
+  t.enter(BUS_RECOVERY_RECONNECT, T0 + MS(1.2));
+  t.enter(BUS_RECOVERY_SAFEOP, T0 + MS(1.8));
+  t.enter(BUS_RECOVERY_OP, T0 + MS(2.4));
+
+  const BusRecoveryRecord& r = t.finish(true, T0 + MS(2.5));
+  CHECK(r.busWide);
+  CHECK(r.phaseMs[BUS_RECOVERY_RECONNECT] == 1);
+  CHECK(r.phaseMs[BUS_RECOVERY_SAFEOP] == 1);
+  CHECK(r.phaseMs[BUS_RECOVERY_OP] == 0);
+  CHECK(r.totalMs == 2);
+}
+
+//! An aborted recovery keeps its phases, a new start clears them
+static void testAbortAndRestart() {
+
+  printf("abort and restart\n");
+
+  BusRecoveryTimeline t;
+  t.start(1005, false, T0);
+  t.enter(BUS_RECOVERY_INIT, T0 + MS(10));
+  t.retry();
+  t.retry();
+
+  const BusRecoveryRecord& r = t.finish(false, T0 + MS(6010));
+  CHECK(!r.success);
+  CHECK(r.retries == 2);
+  CHECK(r.phaseMs[BUS_RECOVERY_RECONNECT] == 10);
+  CHECK(r.phaseMs[BUS_RECOVERY_INIT] == 6000);
+  CHECK(r.totalMs == 6010);
+
+  t.start(1006, false, T0 + MS(7000));
+  CHECK(t.isActive());
+  CHECK(t.getRecord().stationAddress == 1006);
+  CHECK(t.getRecord().retries == 0);
+
+  const BusRecoveryRecord& r2 = t.finish(true, T0 + MS(7003));
+  CHECK(r2.retries == 0);
+  CHECK(r2.phaseMs[BUS_RECOVERY_RECONNECT] == 3);
+  CHECK(r2.phaseMs[BUS_RECOVERY_INIT] == 0);
+  CHECK(r2.totalMs == 3);
+}
+
+// test program for the recovery timeline
+int main () {
+
+  testRetry();
+  testSubMs();
+  testAbortAndRestart();
+
+  printf("verdict: %s (%d failed checks)\n", failures == 0 ? "PASS" : "FAIL", failures);
+  return failures == 0 ? 0 : EXIT_FAILURE;
+}
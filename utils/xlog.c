@@ -0,0 +1,555 @@
+#include "xlog.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+
+//argument types stored in the ring
+enum {
+  XLOG_A_INT,
+  XLOG_A_LONG,
+  XLOG_A_LLONG,
+  XLOG_A_SIZE,
+  XLOG_A_INTMAX,
+  XLOG_A_PTRDIFF,
+  XLOG_A_DOUBLE,
+  XLOG_A_LDOUBLE,
+  XLOG_A_STR,
+  XLOG_A_PTR,
+  XLOG_A_PERCENT, //"%%", no argument
+  XLOG_A_INVALID  //unsupported conversion, stop parsing
+};
+
+typedef union {
+  long long   ll;
+  double      d;
+  const void* p;
+} xlog_arg;
+
+//one message
+typedef struct {
+  const char* fmt;
+  uint64_t    seq;
+  uint8_t     stream;
+  uint8_t     nargs;
+  uint8_t     types[XLOG_MAX_ARGS];
+  xlog_arg    args[XLOG_MAX_ARGS];
+  char        str[XLOG_STR_SZ];
+} xlog_entry;
+
+//single-producer/single-consumer ring of one thread
+typedef struct {
+  uint32_t    head;   //written by the owning thread
+  char        pad0[64 - sizeof(uint32_t)];
+  uint32_t    tail;   //written by the drain thread
+  char        pad1[64 - sizeof(uint32_t)];
+  uint64_t    lost;
+  int         used;   //XLOG_RING_FREE, XLOG_RING_OWNED or XLOG_RING_ORPHANED
+  xlog_entry  entries[XLOG_RING_SZ];
+} xlog_ring;
+
+//ring states
+enum {
+  XLOG_RING_FREE = 0,
+  XLOG_RING_OWNED,    //in use by a thread
+  XLOG_RING_ORPHANED  //thread exited, freed once drained
+};
+
+//one parsed conversion specification
+typedef struct {
+  const char* end;        //one past the conversion character
+  int         width_star; //width given as '*' argument
+  int         prec_star;  //precision given as '*' argument
+  int         type;
+} xlog_conv;
+
+static xlog_ring   xlog_rings[XLOG_MAX_THREADS];
+static int         xlog_nrings = 0;
+static uint64_t    xlog_seq = 0;
+static int         xlog_running = 0;
+static int         xlog_writers = 0;   //threads in xlog_vprintf, see xlog_thread_fn
+static uint32_t    xlog_ring_gen = 0;  //incremented when a ring is freed
+static pthread_t   xlog_thread;
+
+static __thread xlog_ring* xlog_tls_ring = NULL;
+static __thread int        xlog_tls_noring = 0;
+static __thread uint32_t   xlog_tls_noring_gen = 0;
+
+//releases the ring of an exiting thread
+static pthread_key_t       xlog_key;
+static pthread_once_t      xlog_key_once = PTHREAD_ONCE_INIT;
+
+//thread exit: hand the ring to the drain thread
+static void xlog_ring_release(void* ring)
+{
+  __atomic_store_n(&((xlog_ring*) ring)->used, XLOG_RING_ORPHANED, __ATOMIC_RELEASE);
+}
+
+static void xlog_key_create()
+{
+  pthread_key_create(&xlog_key, xlog_ring_release);
+}
+
+//parse the conversion starting at p ('%')
+static void xlog_parse(const char* p, xlog_conv* c)
+{
+  const char* q = p + 1;
+  int len = 0; //0: none, 1: l, 2: ll, 3: z, 4: j, 5: t, 6: L
+
+  c->width_star = 0;
+  c->prec_star = 0;
+
+  if(*q == '%')
+    {
+      c->type = XLOG_A_PERCENT;
+      c->end = q + 1;
+      return;
+    }
+
+  while(*q && strchr("-+ #0'", *q))
+    q++;
+
+  if(*q == '*')
+    {
+      c->width_star = 1;
+      q++;
+    }
+  else
+    while(*q >= '0' && *q <= '9')
+      q++;
+
+  if(*q == '.')
+    {
+      q++;
+      if(*q == '*')
+        {
+          c->prec_star = 1;
+          q++;
+        }
+      else
+        while(*q >= '0' && *q <= '9')
+          q++;
+    }
+
+  switch(*q)
+    {
+    case 'h':
+      q++;
+      if(*q == 'h') q++;
+      break;
+    case 'l':
+      q++;
+      len = 1;
+      if(*q == 'l') { q++; len = 2; }
+      break;
+    case 'q': q++; len = 2; break;
+    case 'z': case 'Z': q++; len = 3; break;
+    case 'j': q++; len = 4; break;
+    case 't': q++; len = 5; break;
+    case 'L': q++; len = 6; break;
+    }
+
+  switch(*q)
+    {
+    case 'd': case 'i': case 'o': case 'u': case 'x': case 'X':
+      switch(len)
+        {
+        case 1:  c->type = XLOG_A_LONG; break;
+        case 2:  c->type = XLOG_A_LLONG; break;
+        case 3:  c->type = XLOG_A_SIZE; break;
+        case 4:  c->type = XLOG_A_INTMAX; break;
+        case 5:  c->type = XLOG_A_PTRDIFF; break;
+        default: c->type = XLOG_A_INT; break;
+        }
+      break;
+    case 'c':
+      c->type = XLOG_A_INT;
+      break;
+    case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+      c->type = (len == 6) ? XLOG_A_LDOUBLE : XLOG_A_DOUBLE;
+      break;
+    case 's':
+      c->type = XLOG_A_STR;
+      break;
+    case 'p':
+      c->type = XLOG_A_PTR;
+      break;
+    default:
+      c->type = XLOG_A_INVALID;
+      c->end = *q ? q + 1 : q;
+      return;
+    }
+  c->end = q + 1;
+}
+
+//returns the ring of the calling thread, NULL if none is available
+static xlog_ring* xlog_ring_get()
+{
+  uint32_t gen;
+  int i;
+
+  if(xlog_tls_ring)
+    return xlog_tls_ring;
+
+  //retry once a ring has been freed
+  gen = __atomic_load_n(&xlog_ring_gen, __ATOMIC_ACQUIRE);
+  if(xlog_tls_noring && gen == xlog_tls_noring_gen)
+    return NULL;
+  xlog_tls_noring = 0;
+
+  pthread_once(&xlog_key_once, xlog_key_create);
+
+  for(i = 0; i < XLOG_MAX_THREADS; i++)
+    {
+      int expected = XLOG_RING_FREE;
+      if(__atomic_compare_exchange_n(&xlog_rings[i].used, &expected, XLOG_RING_OWNED, 0,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+        {
+          int n = __atomic_load_n(&xlog_nrings, __ATOMIC_RELAXED);
+          while(n < i + 1 &&
+                !__atomic_compare_exchange_n(&xlog_nrings, &n, i + 1, 0,
+                                             __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+            ;
+          xlog_tls_ring = &xlog_rings[i];
+          pthread_setspecific(xlog_key, xlog_tls_ring);
+          return xlog_tls_ring;
+        }
+    }
+  xlog_tls_noring = 1;
+  xlog_tls_noring_gen = gen;
+  return NULL;
+}
+
+//store one message in the ring of the calling thread
+static void xlog_push(xlog_ring* r, int stream, const char *format, va_list ap)
+{
+  xlog_entry* e;
+  xlog_conv c;
+  uint32_t head, tail;
+  const char* p;
+  size_t pos = 0;
+
+  head = r->head;
+  tail = __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+  if(head - tail >= XLOG_RING_SZ)
+    {
+      __atomic_fetch_add(&r->lost, 1, __ATOMIC_RELAXED);
+      return;
+    }
+
+  e = &r->entries[head & (XLOG_RING_SZ - 1)];
+  e->fmt = format;
+  e->stream = (uint8_t) stream;
+  e->nargs = 0;
+  e->str[XLOG_STR_SZ - 1] = '\0';
+
+  //collect the raw arguments
+  for(p = strchr(format, '%'); p; p = strchr(c.end, '%'))
+    {
+      xlog_parse(p, &c);
+      if(c.type == XLOG_A_PERCENT)
+        continue;
+      if(c.type == XLOG_A_INVALID ||
+         e->nargs + c.width_star + c.prec_star + 1 > XLOG_MAX_ARGS)
+        break;
+
+      if(c.width_star)
+        {
+          e->types[e->nargs] = XLOG_A_INT;
+          e->args[e->nargs++].ll = va_arg(ap, int);
+        }
+      if(c.prec_star)
+        {
+          e->types[e->nargs] = XLOG_A_INT;
+          e->args[e->nargs++].ll = va_arg(ap, int);
+        }
+
+      e->types[e->nargs] = (uint8_t) c.type;
+      switch(c.type)
+        {
+        case XLOG_A_INT:     e->args[e->nargs].ll = va_arg(ap, int); break;
+        case XLOG_A_LONG:    e->args[e->nargs].ll = va_arg(ap, long); break;
+        case XLOG_A_LLONG:   e->args[e->nargs].ll = va_arg(ap, long long); break;
+        case XLOG_A_SIZE:    e->args[e->nargs].ll = (long long) va_arg(ap, size_t); break;
+        case XLOG_A_INTMAX:  e->args[e->nargs].ll = (long long) va_arg(ap, intmax_t); break;
+        case XLOG_A_PTRDIFF: e->args[e->nargs].ll = (long long) va_arg(ap, ptrdiff_t); break;
+        case XLOG_A_DOUBLE:  e->args[e->nargs].d = va_arg(ap, double); break;
+        case XLOG_A_LDOUBLE: e->args[e->nargs].d = (double) va_arg(ap, long double); break;
+        case XLOG_A_PTR:     e->args[e->nargs].p = va_arg(ap, void*); break;
+        case XLOG_A_STR:
+          {
+            //copy the string, the pointer may not be valid later
+            const char* s = va_arg(ap, const char*);
+            size_t n = 0;
+            if(!s)
+              s = "(null)";
+            if(pos >= XLOG_STR_SZ - 1)
+              {
+                e->args[e->nargs].ll = XLOG_STR_SZ - 1;
+                break;
+              }
+            while(n < XLOG_STR_SZ - 1 - pos && s[n])
+              n++;
+            memcpy(e->str + pos, s, n);
+            e->str[pos + n] = '\0';
+            e->args[e->nargs].ll = (long long) pos;
+            pos += n + 1;
+          }
+          break;
+        }
+      e->nargs++;
+    }
+
+  e->seq = __atomic_fetch_add(&xlog_seq, 1, __ATOMIC_RELAXED);
+  __atomic_store_n(&r->head, head + 1, __ATOMIC_RELEASE);
+}
+
+void xlog_vprintf(int stream, const char *format, va_list ap)
+{
+  xlog_ring* r = NULL;
+
+  //announce the writer before checking xlog_running, the final drain waits for it
+  __atomic_fetch_add(&xlog_writers, 1, __ATOMIC_SEQ_CST);
+
+  if(__atomic_load_n(&xlog_running, __ATOMIC_SEQ_CST))
+    {
+      r = xlog_ring_get();
+      if(r)
+        xlog_push(r, stream, format, ap);
+      else
+        {
+          //all rings in use
+          __atomic_fetch_add(&xlog_rings[0].lost, 1, __ATOMIC_RELAXED);
+        }
+      __atomic_fetch_sub(&xlog_writers, 1, __ATOMIC_RELEASE);
+      return;
+    }
+
+  //not started or stopped
+  __atomic_fetch_sub(&xlog_writers, 1, __ATOMIC_RELEASE);
+  vfprintf(stream == XLOG_STDERR ? stderr : stdout, format, ap);
+}
+
+void xlog_printf(const char *format, ...)
+{
+  va_list ap;
+  va_start(ap, format);
+  xlog_vprintf(XLOG_STDOUT, format, ap);
+  va_end(ap);
+}
+
+void xlog_eprintf(const char *format, ...)
+{
+  va_list ap;
+  va_start(ap, format);
+  xlog_vprintf(XLOG_STDERR, format, ap);
+  va_end(ap);
+}
+
+uint64_t xlog_lost()
+{
+  uint64_t lost = 0;
+  int i;
+  for(i = 0; i < XLOG_MAX_THREADS; i++)
+    lost += __atomic_load_n(&xlog_rings[i].lost, __ATOMIC_RELAXED);
+  return lost;
+}
+
+//format one message (drain thread only)
+static void xlog_format(const xlog_entry* e)
+{
+  FILE* f = (e->stream == XLOG_STDERR) ? stderr : stdout;
+  const char* p = e->fmt;
+  int ai = 0;
+
+  while(*p)
+    {
+      const char* pct = strchr(p, '%');
+      xlog_conv c;
+      char spec[48];
+      size_t n = 0;
+      const char* q;
+      int star_val[2];
+      int nstar = 0;
+
+      if(!pct)
+        {
+          fputs(p, f);
+          break;
+        }
+      fwrite(p, 1, pct - p, f);
+      xlog_parse(pct, &c);
+      p = c.end;
+
+      if(c.type == XLOG_A_PERCENT)
+        {
+          fputc('%', f);
+          continue;
+        }
+      if(c.type == XLOG_A_INVALID ||
+         ai + c.width_star + c.prec_star + 1 > e->nargs)
+        {
+          //arguments not stored, print the rest of the format as is
+          fputs(pct, f);
+          break;
+        }
+
+      if(c.width_star)
+        star_val[nstar++] = (int) e->args[ai++].ll;
+      if(c.prec_star)
+        star_val[nstar++] = (int) e->args[ai++].ll;
+
+      //copy the specification, replace '*' by the stored values
+      nstar = 0;
+      for(q = pct; q < c.end && n < sizeof(spec) - 12; q++)
+        {
+          if(*q == '*')
+            n += snprintf(spec + n, sizeof(spec) - n, "%d", star_val[nstar++]);
+          else if(*q != 'L')
+            spec[n++] = *q;
+        }
+      spec[n] = '\0';
+
+      switch(e->types[ai])
+        {
+        case XLOG_A_INT:     fprintf(f, spec, (int) e->args[ai].ll); break;
+        case XLOG_A_LONG:    fprintf(f, spec, (long) e->args[ai].ll); break;
+        case XLOG_A_LLONG:   fprintf(f, spec, e->args[ai].ll); break;
+        case XLOG_A_SIZE:    fprintf(f, spec, (size_t) e->args[ai].ll); break;
+        case XLOG_A_INTMAX:  fprintf(f, spec, (intmax_t) e->args[ai].ll); break;
+        case XLOG_A_PTRDIFF: fprintf(f, spec, (ptrdiff_t) e->args[ai].ll); break;
+        case XLOG_A_DOUBLE:
+        case XLOG_A_LDOUBLE: fprintf(f, spec, e->args[ai].d); break;
+        case XLOG_A_PTR:     fprintf(f, spec, e->args[ai].p); break;
+        case XLOG_A_STR:     fprintf(f, spec, e->str + e->args[ai].ll); break;
+        }
+      ai++;
+    }
+}
+
+//write all pending messages in order of their sequence numbers
+static void xlog_drain()
+{
+  static uint64_t reported_lost = 0;
+  uint64_t lost;
+  int nrings = __atomic_load_n(&xlog_nrings, __ATOMIC_ACQUIRE);
+  int i;
+
+  for(;;)
+    {
+      xlog_ring* next = NULL;
+      uint64_t next_seq = 0;
+
+      for(i = 0; i < nrings; i++)
+        {
+          xlog_ring* r = &xlog_rings[i];
+          uint32_t tail = r->tail;
+          if(tail != __atomic_load_n(&r->head, __ATOMIC_ACQUIRE))
+            {
+              uint64_t seq = r->entries[tail & (XLOG_RING_SZ - 1)].seq;
+              if(!next || seq < next_seq)
+                {
+                  next = r;
+                  next_seq = seq;
+                }
+            }
+        }
+      if(!next)
+        break;
+
+      xlog_format(&next->entries[next->tail & (XLOG_RING_SZ - 1)]);
+      __atomic_store_n(&next->tail, next->tail + 1, __ATOMIC_RELEASE);
+    }
+
+  //free the drained rings of exited threads
+  for(i = 0; i < nrings; i++)
+    {
+      xlog_ring* r = &xlog_rings[i];
+      if(__atomic_load_n(&r->used, __ATOMIC_ACQUIRE) == XLOG_RING_ORPHANED &&
+         r->tail == __atomic_load_n(&r->head, __ATOMIC_ACQUIRE))
+        {
+          __atomic_store_n(&r->used, XLOG_RING_FREE, __ATOMIC_RELEASE);
+          __atomic_fetch_add(&xlog_ring_gen, 1, __ATOMIC_RELEASE);
+        }
+    }
+
+  lost = xlog_lost();
+  if(lost != reported_lost)
+    {
+      fprintf(stderr, "(W) xlog: %llu messages lost\n",
+              (unsigned long long) (lost - reported_lost));
+      reported_lost = lost;
+    }
+
+  fflush(stdout);
+  fflush(stderr);
+}
+
+static void* xlog_thread_fn(void* arg)
+{
+  struct timespec period;
+  (void) arg;
+
+  period.tv_sec = 0;
+  period.tv_nsec = XLOG_DRAIN_PERIOD_MS * 1000000L;
+
+  while(__atomic_load_n(&xlog_running, __ATOMIC_ACQUIRE))
+    {
+      xlog_drain();
+      nanosleep(&period, NULL);
+    }
+
+  //writers which have seen xlog_running set finish their message first,
+  //later ones write directly
+  while(__atomic_load_n(&xlog_writers, __ATOMIC_SEQ_CST))
+    sched_yield();
+  xlog_drain();
+  return NULL;
+}
+
+int xlog_start(int prio)
+{
+  pthread_attr_t attr;
+  struct sched_param param;
+  int res;
+
+  if(__atomic_load_n(&xlog_running, __ATOMIC_ACQUIRE))
+    return 0;
+
+  __atomic_store_n(&xlog_running, 1, __ATOMIC_RELEASE);
+
+  pthread_attr_init(&attr);
+  pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+  pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+  param.sched_priority = prio;
+  pthread_attr_setschedparam(&attr, &param);
+
+  res = pthread_create(&xlog_thread, &attr, xlog_thread_fn, NULL);
+  pthread_attr_destroy(&attr);
+
+  if(res != 0)
+    {
+      //e.g. no permission for SCHED_FIFO, use default scheduling
+      res = pthread_create(&xlog_thread, NULL, xlog_thread_fn, NULL);
+    }
+  if(res != 0)
+    {
+      __atomic_store_n(&xlog_running, 0, __ATOMIC_RELEASE);
+      fprintf(stderr, "(E) xlog: cannot create drain thread: %s\n", strerror(res));
+      return -1;
+    }
+  return 0;
+}
+
+void xlog_stop()
+{
+  if(!__atomic_load_n(&xlog_running, __ATOMIC_ACQUIRE))
+    return;
+
+  __atomic_store_n(&xlog_running, 0, __ATOMIC_SEQ_CST);
+  pthread_join(xlog_thread, NULL);
+}
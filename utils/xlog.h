@@ -0,0 +1,83 @@
+//emacs -*-Mode: C++;-*-
+/*!
+  @file xlog.h
+
+  Deferred, lock-free output for real-time threads.
+
+  The calling thread only stores the format string pointer and the raw
+  arguments in its own single-producer/single-consumer ring. A low
+  priority drain thread formats the messages and writes them to
+  stdout/stderr. No locks, no allocation and no I/O on the caller side.
+
+  Compile with -DXSTDIO_DEFERRED to route the xstdio.h macros
+  (perr, pwrn, pmsg, pdbg, ...) through this backend.
+
+  Restrictions:
+  - the format string must have static storage (string literal), which
+    is always the case for the xstdio.h macros
+  - %s arguments are copied, up to XLOG_STR_SZ bytes per message
+  - at most XLOG_MAX_ARGS arguments per message, %n is not supported
+
+  If a ring is full, the message is dropped and counted (xlog_lost()),
+  as are the messages of threads beyond XLOG_MAX_THREADS until a ring
+  becomes free. Before xlog_start() and after xlog_stop(), messages are
+  written directly, xlog_stop() writes all messages stored before. The
+  ring of a thread is reused by new threads once the thread has exited
+  and its messages are written.
+
+  Copyright (C) Chair of Applied Mechanics, TUM
+  https://www.amm.mw.tum.de/
+
+*/
+#ifndef __XLOG_H__
+#define __XLOG_H__
+#include <stdint.h>
+#include <stdarg.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif //__cplusplus
+
+//!maximum number of arguments per message (including '*' width/precision)
+#define XLOG_MAX_ARGS 12
+//!bytes for copied %s arguments per message
+#define XLOG_STR_SZ 96
+//!messages per thread ring (power of 2)
+#define XLOG_RING_SZ 128
+//!maximum number of threads with their own ring
+#define XLOG_MAX_THREADS 32
+//!drain period in ms
+#define XLOG_DRAIN_PERIOD_MS 10
+
+//!output streams
+#define XLOG_STDOUT 1
+#define XLOG_STDERR 2
+
+  /*!
+    start the drain thread
+    @param prio : SCHED_FIFO priority of the drain thread (e.g. PRIO_LOG())
+    @return 0 on success (also if already running), -1 on error
+  */
+  int xlog_start(int prio);
+
+  //!write all pending messages and stop the drain thread
+  void xlog_stop();
+
+  //!deferred printf to stdout
+  void xlog_printf(const char *format, ...);
+
+  //!deferred printf to stderr
+  void xlog_eprintf(const char *format, ...);
+
+  //!deferred vprintf to stream XLOG_STDOUT or XLOG_STDERR
+  void xlog_vprintf(int stream, const char *format, va_list ap);
+
+  //!total number of dropped messages
+  uint64_t xlog_lost();
+
+#ifdef __cplusplus
+}
+#endif//__cplusplus
+
+#endif//__XLOG_H__
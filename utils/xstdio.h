@@ -35,7 +35,11 @@ extern "C"
   //!non-blocking output using low-priority IO thread
   void xprintf(const char *format, ...);
 
-#ifdef QNX
+#if defined(XSTDIO_DEFERRED)
+  //use the lock-free deferred backend, see xlog.h
+# include <xlog.h>
+# define msg_printf__ xlog_printf
+#elif defined(QNX)
   //use xprintf
 # define msg_printf__ xprintf
 #else//QNX
@@ -68,8 +72,13 @@ extern "C"
   const char* xstdio_tname();
 
   //!Display error message (allways directly output to stdout)
+#ifdef XSTDIO_DEFERRED
+#define perr(format, ...)                                               \
+  xlog_eprintf(PERR_BEGIN "(E) " format MSG_END, ##__VA_ARGS__)
+#else//XSTDIO_DEFERRED
 #define perr(format, ...)                                               \
   fprintf(stderr,PERR_BEGIN "(E) " format MSG_END, ##__VA_ARGS__)
+#endif//XSTDIO_DEFERRED
   //  msg_printf__(PERR_BEGIN "(E) " format ERRMSG_END, ##__VA_ARGS__)
   //!Display warning message
 #define pwrn(format, ...)                                       \
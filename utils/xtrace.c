@@ -1,20 +1,131 @@
 #include "xtrace.h"
 
+#if defined(QNX) || defined(__linux__)
+#include <stdio.h>
+#include <string.h>
+
+#ifdef QNX
+//event number is passed to trace_logf separately
+#define XTRACE_EVT_FMT "%s-L%d"
+#define XTRACE_EVT_ARGS(pfx,event,line) pfx,line
+#else
+#define XTRACE_EVT_FMT "E%d %s-L%d"
+#define XTRACE_EVT_ARGS(pfx,event,line) event,pfx,line
+#endif
+
+//interned event strings, indexed by event id
+#define XTRACE_MAX_EVENTS 256
+#define XTRACE_STR_SZ     64
+
+//slot states
+enum { XTRACE_FREE=0, XTRACE_BUSY, XTRACE_READY };
+
+typedef struct {
+  int         state;
+  const char* pfx;
+  int         event;
+  int         line;
+  int         len;
+  char        str[XTRACE_STR_SZ];
+} trace_event_t;
+
+static trace_event_t trace_events[XTRACE_MAX_EVENTS];
+
+/*
+  Returns the id of the interned event string for (pfx, line).
+  The string is formatted once on the first call for each
+  instrumentation point, afterwards this is a lookup without
+  locks or allocation.
+*/
+int trace_evt_register(const char*pfx, const int event, const int line)
+{
+  unsigned int h= ((unsigned int)(uintptr_t)pfx * 2654435761u) ^ ((unsigned int)line * 40503u);
+  unsigned int n;
+
+  for(n= 0; n < XTRACE_MAX_EVENTS; n++)
+    {
+      int id= (h + n) % XTRACE_MAX_EVENTS;
+      trace_event_t* e= &trace_events[id];
+      int state= __atomic_load_n(&e->state,__ATOMIC_ACQUIRE);
+
+      //wait for a concurrent registration of this slot
+      while(state == XTRACE_BUSY)
+        state= __atomic_load_n(&e->state,__ATOMIC_ACQUIRE);
+
+      if(state == XTRACE_READY)
+        {
+          if(e->pfx == pfx && e->line == line)
+            return id;
+          continue;
+        }
+
+      //free slot, claim it
+      if(__atomic_compare_exchange_n(&e->state,&state,XTRACE_BUSY,0,__ATOMIC_ACQ_REL,__ATOMIC_ACQUIRE))
+        {
+          e->pfx= pfx;
+          e->line= line;
+          e->event= event;
+          e->len= snprintf(e->str,XTRACE_STR_SZ,XTRACE_EVT_FMT,XTRACE_EVT_ARGS(pfx,event,line));
+          if(e->len >= XTRACE_STR_SZ)
+            e->len= XTRACE_STR_SZ - 1;
+          __atomic_store_n(&e->state,XTRACE_READY,__ATOMIC_RELEASE);
+          return id;
+        }
+      n--;  //lost the race, check this slot again
+    }
+
+  return -1;
+}
+
+//copies the interned string of id with "-S<stamp>" appended to str
+//(XTRACE_STR_SZ + 24 bytes), returns the length without the terminating 0
+static int trace_evt_format_stamp(const int id, const uint64_t stamp, char* str)
+{
+  char digits[21];
+  int len, n= 0;
+  uint64_t v= stamp;
+
+  do
+    {
+      digits[n++]= '0' + (char)(v % 10);
+      v/= 10;
+    }
+  while(v);
+
+  len= trace_events[id].len;
+  memcpy(str,trace_events[id].str,len);
+  str[len++]= '-';
+  str[len++]= 'S';
+  while(n)
+    str[len++]= digits[--n];
+  str[len]= '\0';
+  return len;
+}
+
+#endif
+
 #ifdef QNX
 #include <sys/trace.h>
 #include <stdlib.h>
+#include <errno.h>
+#include <pthread.h>
 #include <xstdio.h>
 
 static int do_trace=0;
+static int trace_init_res=0;
+static pthread_once_t trace_init_once= PTHREAD_ONCE_INIT;
+
 //setup tracing mode and start gathering data
 //tracelogger should be running:
 //eg:  tracelogger -d1  -n 0  -f /dev/shmem/devr_hwl.kev
-int trace_init()
+static int trace_setup()
 {
   char *DO_TRACE= getenv("AM2B_DO_TRACE");
   if(DO_TRACE)
     {
-      int val= strtol(DO_TRACE,(char **) NULL, 10);
+      int val;
+      errno= 0;
+      val= strtol(DO_TRACE,(char **) NULL, 10);
       if(errno == ERANGE)
         {
           perr_ffl(" : got AM2B_DO_TRACE= %s: cannot convert to integer\n",DO_TRACE);
@@ -39,15 +150,6 @@ int trace_init()
     pdbg("init_trace(): do_trace= %d DO_TRACE= 0x0\n",
          do_trace);
 
-  static int call=0;
-
-  if(0!=call)
-    {
-      perr_ffl("call= %d\n",call);
-      return -1;
-    }
-
-  call++;
   if(do_trace)
     {
 #define TRACE_EVENT(trace_event)                \
@@ -117,6 +219,18 @@ int trace_init()
   return 0;
 }
 
+static void trace_setup_once()
+{
+  trace_init_res= trace_setup();
+}
+
+//sets up tracing once per process, later calls return the first result
+int trace_init()
+{
+  pthread_once(&trace_init_once,trace_setup_once);
+  return trace_init_res;
+}
+
 int trace_start()
 {
   if(do_trace)
@@ -139,33 +253,171 @@ int trace_stop()
   return 0;
 }
 
-int trace_evt(const char*pfx, const int event, const int line)
+//insert a string user event, the string is not formatted again
+static int trace_insert(const int event, const char* str)
 {
-  char str[128];
-  if(do_trace)
+  if(-1 == TraceEvent(_NTO_TRACE_INSERTUSRSTREVENT,_NTO_TRACE_USERFIRST+event,str))
     {
-      snprintf(str,128,"%s-L%d",pfx,line);
-      if(-1 == trace_logf(_NTO_TRACE_USERFIRST+event,str))
-        {
-          perr_ffl("trace_logf\n");
-          return -1;
-        }
+      perr_ffl("TraceEvent\n");
+      return -1;
     }
   return 0;
 }
 
+int trace_evt_id(const int id)
+{
+  if(!do_trace || id < 0)
+    return 0;
+  return trace_insert(trace_events[id].event,trace_events[id].str);
+}
+
+int trace_evt(const char*pfx, const int event, const int line)
+{
+  if(!do_trace)
+    return 0;
+  return trace_evt_id(trace_evt_register(pfx,event,line));
+}
+
 int trace_evt_stamp(const char*pfx, const int event, const int line, const uint64_t stamp)
 {
-  char str[128];
-  if(do_trace)
+  char str[XTRACE_STR_SZ + 24];
+  int id;
+
+  if(!do_trace)
+    return 0;
+
+  id= trace_evt_register(pfx,event,line);
+  if(id < 0)
+    return 0;
+
+  //precomputed token + "-S<stamp>"
+  trace_evt_format_stamp(id,stamp,str);
+  return trace_insert(trace_events[id].event,str);
+}
+
+#elif defined(__linux__)
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <xstdio.h>
+
+//Linux: user events are written to the ftrace marker (trace_marker),
+//they show up as print events in trace-cmd/kernelshark.
+//  trace-cmd record -e sched_switch -e ftrace:print ./app
+
+//tracefs mount points, tried in this order
+static const char* trace_dirs[]= {"/sys/kernel/tracing","/sys/kernel/debug/tracing"};
+
+static int do_trace=0;
+static int marker_fd=-1;
+static char trace_dir[64]= "";
+
+static int trace_write_file(const char* name, const char* val)
+{
+  char path[128];
+  int fd, res;
+  snprintf(path,sizeof(path),"%s/%s",trace_dir,name);
+  fd= open(path,O_WRONLY);
+  if(fd < 0)
+    return -1;
+  res= write(fd,val,strlen(val));
+  close(fd);
+  return res < 0 ? -1 : 0;
+}
+
+//open the marker, does nothing if already called
+int trace_init()
+{
+  char *DO_TRACE= getenv("AM2B_DO_TRACE");
+  unsigned int i;
+
+  if(marker_fd >= 0 || !DO_TRACE)
+    return 0;
+
+  errno= 0;
+  do_trace= strtol(DO_TRACE,(char **) NULL, 10);
+  if(errno == ERANGE || errno == EINVAL)
+    {
+      perr_ffl(" : got AM2B_DO_TRACE= %s: cannot convert to integer\n",DO_TRACE);
+      do_trace= 0;
+      return -1;
+    }
+  if(!do_trace)
+    return 0;
+
+  for(i= 0; i < sizeof(trace_dirs)/sizeof(trace_dirs[0]); i++)
     {
-      snprintf(str,128,"%s-L%d-S%llu",pfx,line,(long long unsigned)stamp);
-      if(-1 == trace_logf(_NTO_TRACE_USERFIRST+event,str))
+      char path[128];
+      snprintf(path,sizeof(path),"%s/trace_marker",trace_dirs[i]);
+      marker_fd= open(path,O_WRONLY);
+      if(marker_fd >= 0)
         {
-          perr_ffl("trace_logf\n");
-          return -1;
+          snprintf(trace_dir,sizeof(trace_dir),"%s",trace_dirs[i]);
+          pdbg("init_trace(): writing user events to %s\n",path);
+          return 0;
         }
     }
+
+  perr_errno_ffl("cannot open trace_marker (tracefs mounted? permissions?)\n");
+  do_trace= 0;
+  return -1;
+}
+
+int trace_start()
+{
+  if(do_trace && marker_fd >= 0)
+    {
+      pdbg("start_trace()\n");
+      return trace_write_file("tracing_on","1");
+    }
+  return 0;
+}
+
+int trace_stop()
+{
+  if(do_trace && marker_fd >= 0)
+    {
+      pdbg("stop_trace()\n");
+      return trace_write_file("tracing_on","0");
+    }
+  return 0;
+}
+
+int trace_evt_id(const int id)
+{
+  if(!do_trace || id < 0)
+    return 0;
+  if(write(marker_fd,trace_events[id].str,trace_events[id].len) < 0)
+    return -1;
+  return 0;
+}
+
+int trace_evt(const char*pfx, const int event, const int line)
+{
+  if(!do_trace)
+    return 0;
+  return trace_evt_id(trace_evt_register(pfx,event,line));
+}
+
+int trace_evt_stamp(const char*pfx, const int event, const int line, const uint64_t stamp)
+{
+  char str[XTRACE_STR_SZ + 24];
+  int id, len;
+
+  if(!do_trace)
+    return 0;
+
+  id= trace_evt_register(pfx,event,line);
+  if(id < 0)
+    return 0;
+
+  //precomputed token + "-S<stamp>", one write
+  len= trace_evt_format_stamp(id,stamp,str);
+  if(write(marker_fd,str,len) < 0)
+    return -1;
   return 0;
 }
 
@@ -197,5 +449,15 @@ int trace_evt_stamp(const char*pfx, const int event, const int line, const uint6
   return 0;
 }
 
+int trace_evt_register(const char*pfx, const int event, const int line)
+{
+  return -1;
+}
+
+int trace_evt_id(const int id)
+{
+  return 0;
+}
+
 
 #endif//QNX
@@ -6,6 +6,14 @@
 
   set environment variable AM2B_DO_TRACE=1 to enable tracing.
 
+  QNX: user events are logged with trace_logf (tracelogger).
+  Linux: user events are written to the ftrace marker
+  (/sys/kernel/tracing/trace_marker), record with
+  trace-cmd record -e ftrace:print and view in kernelshark.
+  Event strings are formatted once per instrumentation point
+  (pfx, line), each event is a single write (Linux) or string
+  event (QNX) of the stored string.
+
   Copyright (C) Thomas Buschmann, Institute of Applied Mechanics, TU-Muenchen
   All rights reserved.
   Contact: buschmann@amm.mw.tum.de
@@ -18,7 +26,7 @@
 #ifdef __cplusplus
 extern "C" {
 #endif //__cplusplus
-  //!initialize system tracing
+  //!initialize system tracing (once per process, later calls return the first result)
   int trace_init();
   //!start system tracing
   int trace_start();
@@ -40,6 +48,21 @@ extern "C" {
   */
   int trace_evt_stamp(const char*pfx, const int event, const int line, const uint64_t stamp);
 
+  /*!
+    register an event string once, e.g. before a cyclic loop
+    @param pfx : prefix, must be a string literal (the pointer is the key)
+    @param event: event number
+    @param line : line number (__LINE__)
+    @return event id for trace_evt_id(), -1 if the table is full
+  */
+  int trace_evt_register(const char*pfx, const int event, const int line);
+
+  /*!
+    add user event registered with trace_evt_register()
+    @param id : event id, ignored if negative
+  */
+  int trace_evt_id(const int id);
+
 
 
 